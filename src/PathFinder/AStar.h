@@ -19,6 +19,18 @@ public:
 	int visualTimeRate;
 	bool drawOpenSet;
 	bool drawClosedSet;
+	bool multiTarget;
+	vector<char> targetMask;
+	int targetBoxMinX, targetBoxMaxX;
+	int targetBoxMinY, targetBoxMaxY;
+	int remainingTargets;
+	mSearchLimits limits;
+	mHeuristic heuristic;
+	int status;
+	long expansions;
+	mNode *bestNode;
+	double searchTime;
+	bool verbose;
 	
 
 	AStar(int _x, int _y) :  startNode(NULL), 
@@ -28,7 +40,14 @@ public:
 							 drawOpenSet(true),
 							 drawClosedSet(true),
 							 visualize(false),
-							 visualTimeRate(0)
+							 visualTimeRate(0),
+							 multiTarget(false),
+							 remainingTargets(1),
+							 status(SEARCH_NO_PATH),
+							 expansions(0),
+							 bestNode(NULL),
+							 searchTime(0.0),
+							 verbose(true)
 	{		
 		this->canvas = new Canvas(_x, _y);
 		map<mNode*, int> closedSet();
@@ -43,7 +62,14 @@ public:
 							 drawOpenSet(true),
 							 drawClosedSet(true),
 							 visualize(false),
-							 visualTimeRate(0)
+							 visualTimeRate(0),
+							 multiTarget(false),
+							 remainingTargets(1),
+							 status(SEARCH_NO_PATH),
+							 expansions(0),
+							 bestNode(NULL),
+							 searchTime(0.0),
+							 verbose(true)
 	{		
 		map<mNode*, int> closedSet();
 		(*this).drawGridNodes();
@@ -56,7 +82,14 @@ public:
 						  drawOpenSet(true),
 						  drawClosedSet(true),
 						  visualize(false),
-						  visualTimeRate(0)
+						  visualTimeRate(0),
+						  multiTarget(false),
+						  remainingTargets(1),
+						  status(SEARCH_NO_PATH),
+						  expansions(0),
+						  bestNode(NULL),
+						  searchTime(0.0),
+						  verbose(true)
 	{		
 		this->canvas = new Canvas(_grid);
 		map<mNode*, int> closedSet();
@@ -75,6 +108,20 @@ public:
 		this->visualTimeRate = _other.visualTimeRate;
 		this->drawOpenSet = _other.drawOpenSet;
 		this->drawClosedSet = _other.drawClosedSet;
+		this->multiTarget = _other.multiTarget;
+		this->targetMask = _other.targetMask;
+		this->targetBoxMinX = _other.targetBoxMinX;
+		this->targetBoxMaxX = _other.targetBoxMaxX;
+		this->targetBoxMinY = _other.targetBoxMinY;
+		this->targetBoxMaxY = _other.targetBoxMaxY;
+		this->remainingTargets = _other.remainingTargets;
+		this->limits = _other.limits;
+		this->heuristic = _other.heuristic;
+		this->status = _other.status;
+		this->expansions = _other.expansions;
+		this->bestNode = _other.bestNode;
+		this->searchTime = _other.searchTime;
+		this->verbose = _other.verbose;
 	}
 
 	virtual ~AStar()
@@ -117,6 +164,29 @@ public:
 		this->drawClosedSet = _b;
 	}
 
+	void setSearchLimits(mSearchLimits &_limits)
+	{
+		this->limits = _limits;
+	}
+
+	// one of the HEURISTIC_* kinds (HEURISTIC_AUTO matches the grid connectivity)
+	void setHeuristic(int kind)
+	{
+		this->heuristic.setKind(kind);
+	}
+
+	// COST_EUCLIDEAN or COST_OCTILE_INT (fixed-point costs, deterministic g-values)
+	void setCostMode(int mode)
+	{
+		this->heuristic.setCostMode(mode);
+	}
+
+	// quiet searches (benchmarks, servers) print nothing and skip the final rendering
+	void setVerbose(bool _b)
+	{
+		this->verbose = _b;
+	}
+
 	void setVisualization(bool b=true, int time=0)
 	{
 		this->visualize = b;
@@ -262,36 +332,168 @@ public:
 		}
 
 		double stime = omp_get_wtime();
-		cout << "starting findPath() method..." << endl;
+		if(this->verbose) cout << "starting findPath() method..." << endl;
+		(*this).resetSearch();
+		this->remainingTargets = 1;
 		
 		this->startNode->setGValue(0.0);
 		(*this).applyHeuristic(this->startNode); //->setHValue(this->endNode);
-		this->openSet = new mHeap(this->canvas->grid->gridSize);
 		this->openSet->add(this->startNode);
-		mNode *currentNode = this->startNode;
-		this->path = currentNode;
+		this->path = this->startNode;
+		(*this).searchLoop();
+
+		stime = omp_get_wtime() - stime;
+		this->searchTime = stime;
+		if(!this->verbose) return;
+		cout << endl << "search time: " << stime << " secs" << endl; 
+
+		if(this->status == SEARCH_FOUND) 
+			cout << "path from start to end node was found :)" << endl << "length: " << (*this).getPathCost() << endl;
+		else 
+			(*this).printStopReason();
+		
+		// draw last stage
+		(*this).draw();
+		(*this).show();
+	}
+
+	/*
+		Multi-source / multi-target search: every source is seeded with g = 0 and
+		the heuristic is the distance to the bounding box of the targets (e.g. the
+		outlet face). Stops at the first target reached, which gives the shortest
+		path from any source to any target. On return startNode and endNode are
+		the endpoints of that path.
+	*/
+	void findPath(vector<mNode*> &sources, vector<mNode*> &targets)
+	{
+		double stime = omp_get_wtime();
+		cout << "starting multi-source findPath() method..." << endl;
+		if(!(*this).seedSearch(sources, targets)) return;
+		this->remainingTargets = 1;
+		(*this).searchLoop();
+
+		stime = omp_get_wtime() - stime;
+		cout << endl << "search time: " << stime << " secs" << endl;
+
+		if(this->status == SEARCH_FOUND)
+		{
+			this->endNode = this->path;
+			mNode *currentNode = this->path;
+			while(currentNode->getPrevious() != NULL) currentNode = currentNode->getPrevious();
+			this->startNode = currentNode;
+			cout << "path from sources to targets was found :)" << endl << "length: " << (*this).getPathCost() << endl;
+		}
+		else
+			(*this).printStopReason();
+	}
+
+	/*
+		Tortuosity of every inlet: shortest path length from the inlet to any
+		outlet divided by its straight distance to the outlet face. Runs a single
+		sweep seeded from all outlets that stops once every inlet is settled
+		(closed nodes have exact g-values since the heuristic is consistent).
+		Unreachable inlets get -1.
+	*/
+	void computeTortuosity(vector<mNode*> &inlets, vector<mNode*> &outlets, vector<double> &tortuosity)
+	{
+		double stime = omp_get_wtime();
+		cout << "starting computeTortuosity() method..." << endl;
+		tortuosity.assign(inlets.size(), -1.0);
+		if(!(*this).seedSearch(outlets, inlets)) return;
+		this->remainingTargets = inlets.size();
+		(*this).searchLoop();
+
+		// straight distances are measured to the outlet face
+		(*this).setTargetBox(outlets);
+
+		int connected = 0;
+		double meanTortuosity = 0.0;
+		for(int inlet = 0; inlet < inlets.size(); inlet++)
+		{
+			if(this->closedSet.find(inlets[inlet]) == this->closedSet.end()) continue;
+			double straight = (*this).distanceToTargetBox(inlets[inlet]);
+			if(straight > 0.0) tortuosity[inlet] = this->heuristic.toLength(inlets[inlet]->getGValue()) / straight;
+			else tortuosity[inlet] = 1.0;
+			meanTortuosity += tortuosity[inlet];
+			connected++;
+		}
+
+		stime = omp_get_wtime() - stime;
+		cout << endl << "sweep time: " << stime << " secs" << endl;
+		cout << "connected inlets: " << connected << " of " << inlets.size();
+		if(connected > 0) cout << ", mean tortuosity: " << meanTortuosity / connected;
+		cout << endl;
+	}
+
+	bool seedSearch(vector<mNode*> &sources, vector<mNode*> &targets)
+	{
+		if(sources.size() == 0 or targets.size() == 0)
+		{
+			cout << "sources and/or targets not set." << endl;
+			return false;
+		}
+
+		(*this).resetSearch();
+		this->targetMask.assign(this->canvas->grid->gridSize, 0);
+		for(int node = 0; node < targets.size(); node++)
+		{
+			this->targetMask[this->canvas->grid->getNodeIdx(targets[node]->x, targets[node]->y)] = 1;
+		}
+		(*this).setTargetBox(targets);
+		this->multiTarget = true;
+
+		for(int node = 0; node < sources.size(); node++)
+		{
+			if(!sources[node]->walkable or this->openSet->contains(sources[node])) continue;
+			sources[node]->setGValue(0.0);
+			(*this).applyHeuristic(sources[node]);
+			this->openSet->add(sources[node]);
+		}
+		this->path = sources[0];
+		return true;
+	}
+
+	void searchLoop()
+	{
+		mNode *currentNode;
 		int iter = 0;
+		double startTime = omp_get_wtime();
+		bool boxRejected = false;
+		this->status = SEARCH_NO_PATH;
+		this->bestNode = NULL;
 
 		while(this->openSet->size() > 0)
 		{
+			// Stop as soon as a query limit is hit
+			int limitStatus = this->limits.check(iter, this->heuristic.toLength(this->openSet->heapNodes[0]->getFValue()), startTime);
+			if(limitStatus != SEARCH_IN_PROGRESS)
+			{
+				this->status = limitStatus;
+				break;
+			}
+
 			iter++;
-			if(iter % 100 == 0) cout << "iter: " << iter << endl;			
+			if(this->verbose and iter % 100 == 0) cout << "iter: " << iter << endl;			
 			currentNode = this->openSet->remove();
 			this->closedSet.insert(pair<mNode*, int>(currentNode, iter-1));
 			this->path = currentNode;
+			if(this->bestNode == NULL or currentNode->getHValue() < this->bestNode->getHValue())
+				this->bestNode = currentNode;
 
 			// Stop if destination node is reached
-			if(currentNode->compare(this->endNode))
+			if((*this).isTarget(currentNode))
 			{
-				this->path = this->endNode;
-				break;
+				this->remainingTargets--;
+				if(this->remainingTargets <= 0)
+				{
+					this->status = SEARCH_FOUND;
+					break;
+				}
 			}
 
 			// Get connected neighbors of current node and compare them 
 			vector<mNode*> neighbors = this->canvas->grid->getConnectedNeighbors(currentNode->x, currentNode->y);
 			double currentGValue = currentNode->getGValue();
-			double currentHValue = currentNode->getHValue();
-			double currentFValue = currentNode->getFValue();			
 			for (int node = 0; node < neighbors.size(); node++)
 			{
 				// Check if neighbors is already in closed set
@@ -302,17 +504,24 @@ public:
 				} else 
 					closedSetContainsNode = false;
 				
+				// cells outside the query bounding box are never entered
+				if(!this->limits.insideBox(neighbors[node]->x, neighbors[node]->y))
+				{
+					boxRejected = true;
+					continue;
+				}
+
 				// if neighbor is not closed, evaluate new path to neighbor 
 				if(!closedSetContainsNode) 
 				{
-					double distanceToCurrent = (*this).EuclideanDistance(currentNode, neighbors[node]);
-					double newPath = currentFValue + distanceToCurrent;
+					double distanceToCurrent = this->heuristic.getStepCost(neighbors[node]->x - currentNode->x, neighbors[node]->y - currentNode->y);
+					double newPath = currentGValue + distanceToCurrent;
 					
 					bool openSetContainsNode = this->openSet->contains(neighbors[node]);					
-					if(newPath < neighbors[node]->getFValue() or !openSetContainsNode)
+					if(newPath < neighbors[node]->getGValue() or !openSetContainsNode)
 					{	
 						neighbors[node]->setPrevious(currentNode);
-						neighbors[node]->setGValue(currentGValue + distanceToCurrent);
+						neighbors[node]->setGValue(newPath);
 												
 						if(!openSetContainsNode) 
 						{
@@ -333,27 +542,120 @@ public:
 			}
 		}
 
-		stime = omp_get_wtime() - stime;
-		cout << endl << "search time: " << stime << " secs" << endl; 
+		this->expansions = iter;
+		if(this->status == SEARCH_NO_PATH and boxRejected) this->status = SEARCH_BOX_LIMIT;
 
-		if(this->path->compare(this->endNode)) 
-			cout << "path from start to end node was found :)" << endl << "length: " << this->path->getFValue() << endl;
-		else 
+		// a stopped search keeps the best partial path (closest node to the target)
+		if(this->status != SEARCH_FOUND and this->bestNode != NULL) this->path = this->bestNode;
+	}
+
+	void printStopReason()
+	{
+		if(this->status == SEARCH_NO_PATH or this->bestNode == NULL)
+		{
 			cout << "no path found :(" << endl;
-		
-		// draw last stage
-		(*this).draw();
-		(*this).show();
+			return;
+		}
+		cout << "search stopped by " << mSearchLimits::statusName(this->status) << " after " << this->expansions << " expansions." << endl;
+		cout << "best node: (" << this->bestNode->x << ", " << this->bestNode->y << "), ";
+		cout << "g = " << this->bestNode->getGValue() << ", h = " << this->bestNode->getHValue() << endl;
+	}
+
+	bool isTarget(mNode *node)
+	{
+		if(this->multiTarget)
+			return this->targetMask[this->canvas->grid->getNodeIdx(node->x, node->y)] != 0;
+		return node->compare(this->endNode);
+	}
+
+	void setTargetBox(vector<mNode*> &targets)
+	{
+		this->targetBoxMinX = INT_MAX; this->targetBoxMaxX = INT_MIN;
+		this->targetBoxMinY = INT_MAX; this->targetBoxMaxY = INT_MIN;
+		for(int node = 0; node < targets.size(); node++)
+		{
+			this->targetBoxMinX = min(this->targetBoxMinX, targets[node]->x);
+			this->targetBoxMaxX = max(this->targetBoxMaxX, targets[node]->x);
+			this->targetBoxMinY = min(this->targetBoxMinY, targets[node]->y);
+			this->targetBoxMaxY = max(this->targetBoxMaxY, targets[node]->y);
+		}
+	}
+
+	double distanceToTargetBox(mNode *node)
+	{
+		double dx = max(0, max(this->targetBoxMinX - node->x, node->x - this->targetBoxMaxX));
+		double dy = max(0, max(this->targetBoxMinY - node->y, node->y - this->targetBoxMaxY));
+		return (*this).EuclideanDistance(dx, dy);
+	}
+
+	// clear the search state left in the grid nodes by the previous query
+	void resetSearch()
+	{
+		map<mNode*, int>::const_iterator it;
+		for(it = this->closedSet.begin(); it != this->closedSet.end(); it++)
+		{
+			(*this).resetNode(it->first);
+		}
+		this->closedSet.clear();
+
+		if(this->openSet == NULL)
+		{
+			this->openSet = new mHeap(this->canvas->grid->gridSize);
+		}
+		for(int node = 0; node < this->openSet->size(); node++)
+		{
+			(*this).resetNode(this->openSet->heapNodes[node]);
+		}
+		this->openSet->currentSize = 0;
+		this->path = NULL;
+		this->multiTarget = false;
+	}
+
+	void resetNode(mNode *node)
+	{
+		node->setGValue(DBL_MAX);
+		node->setHValue(DBL_MAX);
+		node->setPrevious(NULL);
+		node->setHeapIndex(-1);
+	}
+
+	// copy the current path into a caller-owned buffer (see mPathResult);
+	// a search stopped by a limit gives the partial path to its best node
+	int extractPath(mPathResult &result)
+	{
+		result.setCostMode(this->heuristic.costMode);
+		if(this->path == NULL or this->status == SEARCH_NO_PATH)
+		{
+			result.clear();
+			return 0;
+		}
+		int entries = result.extract(this->canvas->grid, this->path);
+		result.partial = (this->status != SEARCH_FOUND);
+		return entries;
 	}
 
 	void applyHeuristic(mNode *current)
 	{
-		current->setHValue(heuristicFunction(current, this->endNode));
+		if(this->multiTarget)
+		{
+			int dx = max(0, max(this->targetBoxMinX - current->x, current->x - this->targetBoxMaxX));
+			int dy = max(0, max(this->targetBoxMinY - current->y, current->y - this->targetBoxMaxY));
+			current->setHValue(this->heuristic.estimate(dx, dy, this->canvas->grid->connectivity));
+		}
+		else
+			current->setHValue(heuristicFunction(current, this->endNode));
 	}
 
 	double heuristicFunction(mNode *nodeA, mNode *nodeB)
 	{
-		return EuclideanDistance(nodeA, nodeB);
+		return this->heuristic.estimate(nodeA->x - nodeB->x, nodeA->y - nodeB->y, this->canvas->grid->connectivity);
+	}
+
+	// length of the current path in grid units
+	double getPathCost()
+	{
+		if(this->path == NULL) return -1.0;
+		return this->heuristic.toLength(this->path->getGValue());
 	}
 
 	double EuclideanDistance(mNode *nodeA, mNode *nodeB)
@@ -372,15 +674,15 @@ public:
 
 	double ManhatannDistance(mNode *nodeA, mNode *nodeB)
 	{
-		double dx = nodeA->x - nodeB->x;
-		double dy = nodeA->y - nodeB->y;
+		double dx = abs(nodeA->x - nodeB->x);
+		double dy = abs(nodeA->y - nodeB->y);
 
 		return (dx + dy);	
 	}
 
 	double ManhatannDistance(double dx, double dy)
 	{
-		return (dx + dy);		
+		return (fabs(dx) + fabs(dy));		
 	}
 };
 
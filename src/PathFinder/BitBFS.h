@@ -0,0 +1,340 @@
+#ifndef BIT_BFS_H
+#define BIT_BFS_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Breadth-first search for 4-connected grids with unit step costs, run as a
+	wavefront over the packed rows of a mBitGrid: one layer is
+	  next = (frontier shifted left, right, up and down) & walkable & ~visited
+	so a 64-bit word advances 64 cells at once. Rows of a layer are split
+	among OpenMP threads; only rows near the frontier are scanned. The layer
+	index of every reached cell is recorded, which gives distances and
+	reachability, and a path is rebuilt by walking down the layers from the
+	goal. The grid connectivity is ignored: moves are always 4-connected.
+*/
+class BitBFS
+{
+public:
+	mGrid *grid;
+	mBitGrid *bitGrid;
+	vector<uint64_t> visited;
+	vector<uint64_t> frontier;
+	vector<uint64_t> next;
+	vector<int> frontierWords;
+	vector<int> nextWords;
+	vector<int> distances;
+	vector<int> path;
+	int startIdx;
+	int endIdx;
+	int status;
+	int layers;
+	long reachedCells;
+	long wordOperations;
+	double searchTime;
+	bool verbose;
+
+	BitBFS(mGrid *_grid) : grid(_grid),
+						   startIdx(-1),
+						   endIdx(-1),
+						   status(SEARCH_NO_PATH),
+						   layers(0),
+						   reachedCells(0),
+						   wordOperations(0),
+						   searchTime(0.0),
+						   verbose(true)
+	{
+		this->bitGrid = new mBitGrid(_grid);
+		this->distances.assign(this->grid->gridSize, -1);
+	}
+
+	BitBFS(const BitBFS &_other)
+	{
+		this->grid = _other.grid;
+		this->bitGrid = new mBitGrid(*_other.bitGrid);
+		this->visited = _other.visited;
+		this->frontier = _other.frontier;
+		this->next = _other.next;
+		this->frontierWords = _other.frontierWords;
+		this->nextWords = _other.nextWords;
+		this->distances = _other.distances;
+		this->path = _other.path;
+		this->startIdx = _other.startIdx;
+		this->endIdx = _other.endIdx;
+		this->status = _other.status;
+		this->layers = _other.layers;
+		this->reachedCells = _other.reachedCells;
+		this->wordOperations = _other.wordOperations;
+		this->searchTime = _other.searchTime;
+		this->verbose = _other.verbose;
+	}
+
+	virtual ~BitBFS()
+	{
+		if(this->bitGrid != NULL)
+		{
+			delete this->bitGrid;
+			this->bitGrid = NULL;
+		}
+	}
+
+	void setVerbose(bool _b)
+	{
+		this->verbose = _b;
+	}
+
+	// reload walkability after the grid was edited
+	void rebuild()
+	{
+		this->bitGrid->build(this->grid);
+	}
+
+	bool findPath(int startX, int startY, int endX, int endY)
+	{
+		this->path.clear();
+		(*this).search(startX, startY, endX, endY);
+		if(this->status == SEARCH_FOUND) (*this).buildPath(endX, endY);
+
+		if(this->verbose)
+		{
+			cout << endl << "search time: " << this->searchTime << " secs, " << this->layers << " layers, ";
+			cout << this->reachedCells << " reached cells, " << this->wordOperations << " word operations" << endl;
+			if(this->status == SEARCH_FOUND)
+				cout << "path from start to end node was found :)" << endl << "length: " << this->layers << endl;
+			else
+				cout << "no path found :(" << endl;
+		}
+		return (this->status == SEARCH_FOUND);
+	}
+
+	// distances from (startX, startY) to every reachable cell, returns the number of reached cells
+	long computeDistances(int startX, int startY)
+	{
+		(*this).search(startX, startY, -1, -1);
+		return this->reachedCells;
+	}
+
+	// layers from the start of the last search (-1: not reached)
+	int getDistance(int x, int y)
+	{
+		if(!(*this).isReached(x, y)) return -1;
+		return this->distances[(long) y * this->grid->gridDimX + x];
+	}
+
+	bool isReached(int x, int y)
+	{
+		if(x < 0 or x >= this->grid->gridDimX or y < 0 or y >= this->grid->gridDimY or this->visited.size() == 0) return false;
+		return (this->visited[(long) y * this->bitGrid->rowWords + (x >> 6)] >> (x & 63)) & 1ULL;
+	}
+
+	/*
+		Wavefront from the start until the goal is reached ('endX' < 0: until
+		the frontier is empty). Only rows next to [firstRow, lastRow] of the
+		frontier are scanned, and in each row only the words next to the
+		frontier words of the row and its two neighbors ('frontierWords' holds
+		the first and last word per row, first > last if none). 'next' is all
+		zero at the start of every layer.
+	*/
+	void search(int startX, int startY, int endX, int endY)
+	{
+		double stime = omp_get_wtime();
+		int dimX = this->grid->gridDimX;
+		int dimY = this->grid->gridDimY;
+		int rowWords = this->bitGrid->rowWords;
+		long words = (long) rowWords * dimY;
+		this->visited.assign(words, 0);
+		this->frontier.assign(words, 0);
+		this->next.assign(words, 0);
+		this->frontierWords.assign(2 * dimY, 0);
+		this->nextWords.assign(2 * dimY, 0);
+		for(int y = 0; y < dimY; y++)
+		{
+			this->frontierWords[2*y] = this->nextWords[2*y] = rowWords;
+			this->frontierWords[2*y + 1] = this->nextWords[2*y + 1] = -1;
+		}
+		this->layers = 0;
+		this->reachedCells = 0;
+		this->wordOperations = 0;
+		this->status = SEARCH_NO_PATH;
+		this->startIdx = -1;
+		this->endIdx = -1;
+
+		if(!this->bitGrid->isWalkable(startX, startY) or (endX >= 0 and !this->bitGrid->isWalkable(endX, endY)))
+		{
+			if(this->verbose) cout << "start and/or end nodes are not walkable." << endl;
+			this->searchTime = omp_get_wtime() - stime;
+			return;
+		}
+		this->startIdx = this->grid->getNodeIdx(startX, startY);
+		if(endX >= 0) this->endIdx = this->grid->getNodeIdx(endX, endY);
+
+		uint64_t startBit = 1ULL << (startX & 63);
+		this->visited[(long) startY * rowWords + (startX >> 6)] = startBit;
+		this->frontier[(long) startY * rowWords + (startX >> 6)] = startBit;
+		this->frontierWords[2*startY] = this->frontierWords[2*startY + 1] = startX >> 6;
+		this->distances[(long) startY * dimX + startX] = 0;
+		this->reachedCells = 1;
+		if(startX == endX and startY == endY)
+		{
+			this->status = SEARCH_FOUND;
+			this->searchTime = omp_get_wtime() - stime;
+			return;
+		}
+
+		uint64_t *walkable = this->bitGrid->rowBits.data();
+		int firstRow = startY;
+		int lastRow = startY;
+		while(firstRow <= lastRow)
+		{
+			int layer = this->layers + 1;
+			int scanFirst = max(0, firstRow - 1);
+			int scanLast = min(dimY - 1, lastRow + 1);
+			int newFirst = INT_MAX;
+			int newLast = -1;
+			long reached = 0;
+			long scanned = 0;
+			uint64_t *current = this->frontier.data();
+			uint64_t *grown = this->next.data();
+			uint64_t *seen = this->visited.data();
+			int *layerOf = this->distances.data();
+			int *currentWords = this->frontierWords.data();
+			int *grownWords = this->nextWords.data();
+
+			#pragma omp parallel for schedule(static) reduction(min:newFirst) reduction(max:newLast) reduction(+:reached,scanned) if((long) (scanLast - scanFirst + 1) * rowWords >= BFS_PARALLEL_MIN_WORDS)
+			for(int y = scanFirst; y <= scanLast; y++)
+			{
+				uint64_t *row = current + (long) y * rowWords;
+				uint64_t *above = (y > 0) ? row - rowWords : NULL;
+				uint64_t *below = (y + 1 < dimY) ? row + rowWords : NULL;
+				int firstWord = currentWords[2*y] - 1;
+				int lastWord = currentWords[2*y + 1] + 1;
+				if(above != NULL)
+				{
+					firstWord = min(firstWord, currentWords[2*y - 2]);
+					lastWord = max(lastWord, currentWords[2*y - 1]);
+				}
+				if(below != NULL)
+				{
+					firstWord = min(firstWord, currentWords[2*y + 2]);
+					lastWord = max(lastWord, currentWords[2*y + 3]);
+				}
+				firstWord = max(0, firstWord);
+				lastWord = min(rowWords - 1, lastWord);
+				bool active = false;
+				for(int word = firstWord; word <= lastWord; word++)
+				{
+					// left and right neighbors, with the bits carried across word borders
+					uint64_t bits = row[word];
+					uint64_t spread = bits | (bits << 1) | (bits >> 1);
+					if(word > 0) spread |= row[word - 1] >> 63;
+					if(word + 1 < rowWords) spread |= row[word + 1] << 63;
+					if(above != NULL) spread |= above[word];
+					if(below != NULL) spread |= below[word];
+
+					long offset = (long) y * rowWords + word;
+					uint64_t added = spread & walkable[offset] & ~seen[offset];
+					if(added == 0) continue;
+
+					grown[offset] = added;
+					seen[offset] |= added;
+					if(!active) grownWords[2*y] = word;
+					grownWords[2*y + 1] = word;
+					active = true;
+					reached += __builtin_popcountll(added);
+					while(added != 0)
+					{
+						int bit = __builtin_ctzll(added);
+						layerOf[(long) y * dimX + (word << 6) + bit] = layer;
+						added &= added - 1;
+					}
+				}
+				if(active)
+				{
+					newFirst = min(newFirst, y);
+					newLast = max(newLast, y);
+				}
+				scanned += max(0, lastWord - firstWord + 1);
+			}
+			this->wordOperations += scanned;
+
+			// the old frontier becomes the (zeroed) buffer of the next layer
+			for(int y = firstRow; y <= lastRow; y++)
+			{
+				if(currentWords[2*y] <= currentWords[2*y + 1])
+					memset(current + (long) y * rowWords + currentWords[2*y], 0, (currentWords[2*y + 1] - currentWords[2*y] + 1) * sizeof(uint64_t));
+				currentWords[2*y] = rowWords;
+				currentWords[2*y + 1] = -1;
+			}
+			this->frontier.swap(this->next);
+			this->frontierWords.swap(this->nextWords);
+			firstRow = newFirst;
+			lastRow = newLast;
+			if(reached == 0) break;
+
+			this->layers = layer;
+			this->reachedCells += reached;
+			if(endX >= 0 and (*this).isReached(endX, endY))
+			{
+				this->status = SEARCH_FOUND;
+				break;
+			}
+		}
+		if(endX < 0 and this->reachedCells > 0) this->status = SEARCH_FOUND;
+		this->searchTime = omp_get_wtime() - stime;
+	}
+
+	// cell one layer closer to the start (-1 at the start)
+	int getPrevious(int cell)
+	{
+		static const int offsetX[4] = {-1, 1, 0, 0};
+		static const int offsetY[4] = {0, 0, -1, 1};
+		int x = this->grid->nodes[cell].x;
+		int y = this->grid->nodes[cell].y;
+		int distance = (*this).getDistance(x, y);
+		if(distance <= 0) return -1;
+		for(int dir = 0; dir < 4; dir++)
+		{
+			if((*this).getDistance(x + offsetX[dir], y + offsetY[dir]) == distance - 1)
+				return this->grid->getNodeIdx(x + offsetX[dir], y + offsetY[dir]);
+		}
+		return -1;
+	}
+
+	// walk down the distance layers from the goal to the start
+	void buildPath(int endX, int endY)
+	{
+		int distance = (*this).getDistance(endX, endY);
+		this->path.assign(distance + 1, -1);
+		int cell = this->grid->getNodeIdx(endX, endY);
+		for(int position = distance; position >= 0; position--)
+		{
+			this->path[position] = cell;
+			cell = (*this).getPrevious(cell);
+		}
+	}
+
+	int extractPath(mPathResult &result)
+	{
+		if(this->path.size() == 0)
+		{
+			result.clear();
+			return 0;
+		}
+		return result.extractChain(this->grid, this->path.back(), [this](int index) -> int
+		{
+			return (*this).getPrevious(index);
+		});
+	}
+
+	long memoryUsage()
+	{
+		return (long) ((this->visited.size() + this->frontier.size() + this->next.size()) * sizeof(uint64_t) +
+					   this->distances.size() * sizeof(int) +
+					   (this->bitGrid->rowBits.size() + this->bitGrid->colBits.size()) * sizeof(uint64_t));
+	}
+};
+
+#endif
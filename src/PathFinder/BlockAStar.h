@@ -0,0 +1,513 @@
+#ifndef BLOCK_ASTAR_H
+#define BLOCK_ASTAR_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Block A*: the open set holds blocks of a mLocalDistanceDB instead of
+	cells. A block keeps g-values for its boundary cells; expanding it takes
+	the boundary cells whose g-value dropped since its last expansion, relaxes
+	every other boundary cell of the block through the database in one pass,
+	then crosses to the boundary cells of the neighboring blocks with single
+	steps. A block is keyed by the lowest f-value of its pending cells and
+	may be expanded again when one of them improves. The start and goal cells
+	are connected to the boundary of their blocks by a local search, and the
+	search stops once no open block can beat the best start-to-goal length,
+	so paths are optimal. Paths are rebuilt cell by cell with local searches
+	between consecutive boundary cells. Search filters and bounding boxes
+	are not supported: they would change the in-block distances. The
+	database may be shared by several searches, so it is never updated by
+	findPath: its owner calls update() after grid edits, before searching,
+	and a search against an out-of-date database finds no path.
+*/
+class BlockAStar
+{
+public:
+	struct BlockState
+	{
+		int block;
+		int heapIndex;
+		double key;
+		uint32_t pending;
+		int slot;
+	};
+
+	mGrid *grid;
+	mLocalDistanceDB *database;
+	vector<BlockState> states;
+	unordered_map<int, int> stateOf;
+	vector<double> gValues;
+	vector<int> parents;
+	vector<int> openSet;
+	vector<double> startCosts;
+	vector<double> goalCosts;
+	vector<int> path;
+	int startIdx;
+	int endIdx;
+	int startBlock;
+	int goalBlock;
+	int goalParent;
+	double bestLength;
+	int status;
+	mSearchLimits limits;
+	mHeuristic heuristic;
+	long expansions;
+	long heapOperations;
+	long peakMemory;
+	double searchTime;
+	bool verbose;
+
+	BlockAStar(mGrid *_grid, mLocalDistanceDB *_database) : grid(_grid),
+															database(_database),
+															startIdx(-1),
+															endIdx(-1),
+															startBlock(-1),
+															goalBlock(-1),
+															goalParent(-1),
+															bestLength(DBL_MAX),
+															status(SEARCH_NO_PATH),
+															expansions(0),
+															heapOperations(0),
+															peakMemory(0),
+															searchTime(0.0),
+															verbose(true)
+	{}
+
+	BlockAStar(const BlockAStar &_other)
+	{
+		this->grid = _other.grid;
+		this->database = _other.database;
+		this->states = _other.states;
+		this->stateOf = _other.stateOf;
+		this->gValues = _other.gValues;
+		this->parents = _other.parents;
+		this->openSet = _other.openSet;
+		this->startCosts = _other.startCosts;
+		this->goalCosts = _other.goalCosts;
+		this->path = _other.path;
+		this->startIdx = _other.startIdx;
+		this->endIdx = _other.endIdx;
+		this->startBlock = _other.startBlock;
+		this->goalBlock = _other.goalBlock;
+		this->goalParent = _other.goalParent;
+		this->bestLength = _other.bestLength;
+		this->status = _other.status;
+		this->limits = _other.limits;
+		this->heuristic = _other.heuristic;
+		this->expansions = _other.expansions;
+		this->heapOperations = _other.heapOperations;
+		this->peakMemory = _other.peakMemory;
+		this->searchTime = _other.searchTime;
+		this->verbose = _other.verbose;
+	}
+
+	virtual ~BlockAStar(){}
+
+	void setVerbose(bool _b)
+	{
+		this->verbose = _b;
+	}
+
+	// expansion limits count blocks; the bounding box is ignored
+	void setSearchLimits(mSearchLimits &_limits)
+	{
+		this->limits = _limits;
+	}
+
+	void setHeuristic(int kind)
+	{
+		this->heuristic.setKind(kind);
+	}
+
+	void setCostMode(int mode)
+	{
+		this->heuristic.setCostMode(mode);
+	}
+
+	int getBlock(int x, int y)
+	{
+		return (y / this->database->blockSize) * this->database->blocksX + x / this->database->blockSize;
+	}
+
+	// grid cell of boundary cell 'index' of a block
+	int getBoundaryCell(int block, int index)
+	{
+		int local = this->database->boundary[index];
+		int x = (block % this->database->blocksX) * this->database->blockSize + local % this->database->blockSize;
+		int y = (block / this->database->blocksX) * this->database->blockSize + local / this->database->blockSize;
+		if(x >= this->grid->gridDimX or y >= this->grid->gridDimY) return -1;
+		return this->grid->getNodeIdx(x, y);
+	}
+
+	int getLocalCell(int cell)
+	{
+		int size = this->database->blockSize;
+		return (this->grid->nodes[cell].y % size) * size + this->grid->nodes[cell].x % size;
+	}
+
+	double getCost(uint16_t packed)
+	{
+		return (packed >> 8) * this->heuristic.straightCost + (packed & 0xFF) * this->heuristic.diagonalCost;
+	}
+
+	bool findPath(int startX, int startY, int endX, int endY)
+	{
+		double stime = omp_get_wtime();
+		this->startIdx = this->grid->getNodeIdx(startX, startY);
+		this->endIdx = this->grid->getNodeIdx(endX, endY);
+		this->states.clear();
+		this->stateOf.clear();
+		this->gValues.clear();
+		this->parents.clear();
+		this->openSet.clear();
+		this->path.clear();
+		this->goalParent = -1;
+		this->bestLength = DBL_MAX;
+		this->expansions = 0;
+		this->heapOperations = 0;
+		this->status = SEARCH_NO_PATH;
+		if(!this->grid->nodes[this->startIdx].walkable or !this->grid->nodes[this->endIdx].walkable)
+		{
+			if(this->verbose) cout << "start and/or end nodes are not walkable." << endl;
+			this->searchTime = omp_get_wtime() - stime;
+			return false;
+		}
+		if(this->database->gridVersion != this->grid->version or this->database->connectivity != this->grid->connectivity)
+		{
+			if(this->verbose) cout << "local distance database is out of date (call update() before searching)." << endl;
+			this->searchTime = omp_get_wtime() - stime;
+			return false;
+		}
+
+		this->startBlock = (*this).getBlock(startX, startY);
+		this->goalBlock = (*this).getBlock(endX, endY);
+		(*this).connectEndpoint(this->startBlock, this->startIdx, this->startCosts);
+		(*this).connectEndpoint(this->goalBlock, this->endIdx, this->goalCosts);
+
+		// the goal may be reachable without leaving the block
+		if(this->startBlock == this->goalBlock)
+		{
+			double direct = (*this).localPathCost(this->startBlock, this->startIdx, this->endIdx);
+			if(direct >= 0.0)
+			{
+				this->bestLength = direct;
+				this->goalParent = this->startIdx;
+			}
+		}
+
+		// start state: its boundary cells, reached by the local search
+		int first = (*this).getState(this->startBlock);
+		for(int index = 0; index < this->database->getBoundarySize(); index++)
+		{
+			if(this->startCosts[index] < 0.0) continue;
+			int cell = (*this).getBoundaryCell(this->startBlock, index);
+			(*this).relax(first, index, this->startCosts[index], (cell == this->startIdx) ? -1 : this->startIdx);
+		}
+
+		while(this->openSet.size() > 0)
+		{
+			double key = this->states[this->openSet[0]].key;
+			if(key >= this->bestLength - 1.0e-9 * max(1.0, this->bestLength)) break;
+			int limitStatus = this->limits.check(this->expansions, this->heuristic.toLength(key), stime);
+			if(limitStatus != SEARCH_IN_PROGRESS)
+			{
+				this->status = limitStatus;
+				break;
+			}
+			(*this).expand((*this).heapRemove());
+		}
+		if(this->status == SEARCH_NO_PATH and this->goalParent >= 0)
+		{
+			this->status = SEARCH_FOUND;
+			(*this).buildPath();
+		}
+		this->searchTime = omp_get_wtime() - stime;
+		this->peakMemory = (*this).memoryUsage();
+
+		if(this->verbose)
+		{
+			cout << endl << "search time: " << this->searchTime << " secs" << endl;
+			cout << "expanded blocks: " << this->expansions << ", heap operations: " << this->heapOperations;
+			cout << ", touched blocks: " << this->states.size() << ", peak memory: " << this->peakMemory << " bytes" << endl;
+			if(this->status == SEARCH_FOUND)
+				cout << "path from start to end node was found :)" << endl << "length: " << (*this).getPathCost() << endl;
+			else if(this->status == SEARCH_NO_PATH)
+				cout << "no path found :(" << endl;
+			else
+				cout << "search stopped by " << mSearchLimits::statusName(this->status) << endl;
+		}
+		return (this->status == SEARCH_FOUND);
+	}
+
+	// costs from a cell to the boundary cells of its block, inside the block (-1: unreachable)
+	void connectEndpoint(int block, int cell, vector<double> &costs)
+	{
+		vector<int> straight, diagonal, previous;
+		this->database->localSearch(this->database->getMask(block), (*this).getLocalCell(cell), this->heuristic.straightCost,
+									this->heuristic.diagonalCost, straight, diagonal, previous);
+		costs.assign(this->database->getBoundarySize(), -1.0);
+		for(int index = 0; index < costs.size(); index++)
+		{
+			int local = this->database->boundary[index];
+			if(straight[local] >= 0) costs[index] = straight[local] * this->heuristic.straightCost + diagonal[local] * this->heuristic.diagonalCost;
+		}
+	}
+
+	double localPathCost(int block, int from, int to)
+	{
+		vector<int> straight, diagonal, previous;
+		this->database->localSearch(this->database->getMask(block), (*this).getLocalCell(from), this->heuristic.straightCost,
+									this->heuristic.diagonalCost, straight, diagonal, previous);
+		int local = (*this).getLocalCell(to);
+		if(straight[local] < 0) return -1.0;
+		return straight[local] * this->heuristic.straightCost + diagonal[local] * this->heuristic.diagonalCost;
+	}
+
+	// state of a block, created on first touch with every boundary cell unreached
+	int getState(int block)
+	{
+		unordered_map<int, int>::iterator entry = this->stateOf.find(block);
+		if(entry != this->stateOf.end()) return entry->second;
+
+		BlockState state = {block, -1, DBL_MAX, 0, (int) this->gValues.size()};
+		this->gValues.resize(this->gValues.size() + this->database->getBoundarySize(), DBL_MAX);
+		this->parents.resize(this->parents.size() + this->database->getBoundarySize(), -1);
+		this->states.push_back(state);
+		this->stateOf[block] = this->states.size() - 1;
+		return this->states.size() - 1;
+	}
+
+	// lower the g-value of a boundary cell and queue it on its block
+	bool relax(int state, int index, double gValue, int parent)
+	{
+		int slot = this->states[state].slot + index;
+		if(gValue >= this->gValues[slot]) return false;
+		this->gValues[slot] = gValue;
+		this->parents[slot] = parent;
+		this->states[state].pending |= 1u << index;
+
+		double fValue = gValue + (*this).heuristicFunction((*this).getBoundaryCell(this->states[state].block, index));
+		if(this->states[state].heapIndex < 0)
+		{
+			this->states[state].key = fValue;
+			(*this).heapAdd(state);
+		}
+		else if(fValue < this->states[state].key)
+		{
+			this->states[state].key = fValue;
+			(*this).heapSortUp(this->states[state].heapIndex);
+		}
+		return true;
+	}
+
+	void expand(int state)
+	{
+		static const int offsetX[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+		static const int offsetY[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+		this->expansions++;
+		int block = this->states[state].block;
+		int slot = this->states[state].slot;
+		int boundarySize = this->database->getBoundarySize();
+		uint32_t pending = this->states[state].pending;
+		this->states[state].pending = 0;
+
+		// every boundary cell through the pending ones, in one pass over the database rows
+		uint32_t improved = pending;
+		for(int from = 0; from < boundarySize; from++)
+		{
+			if(!((pending >> from) & 1)) continue;
+			int fromCell = (*this).getBoundaryCell(block, from);
+			for(int to = 0; to < boundarySize; to++)
+			{
+				uint16_t packed = this->database->getDistance(block, from, to);
+				if(packed == LDDB_UNREACHABLE or to == from) continue;
+				double gValue = this->gValues[slot + from] + (*this).getCost(packed);
+				if(gValue < this->gValues[slot + to])
+				{
+					this->gValues[slot + to] = gValue;
+					this->parents[slot + to] = fromCell;
+					improved |= 1u << to;
+				}
+			}
+		}
+
+		if(block == this->goalBlock)
+		{
+			for(int index = 0; index < boundarySize; index++)
+			{
+				if(this->goalCosts[index] < 0.0 or this->gValues[slot + index] == DBL_MAX) continue;
+				double length = this->gValues[slot + index] + this->goalCosts[index];
+				if(length < this->bestLength)
+				{
+					this->bestLength = length;
+					this->goalParent = (*this).getBoundaryCell(block, index);
+				}
+			}
+		}
+
+		// single steps into the neighboring blocks
+		for(int index = 0; index < boundarySize; index++)
+		{
+			if(!((improved >> index) & 1)) continue;
+			int cell = (*this).getBoundaryCell(block, index);
+			int x = this->grid->nodes[cell].x;
+			int y = this->grid->nodes[cell].y;
+			for(int dir = 0; dir < this->grid->connectivity; dir++)
+			{
+				int nx = x + offsetX[dir];
+				int ny = y + offsetY[dir];
+				if(nx < 0 or nx >= this->grid->gridDimX or ny < 0 or ny >= this->grid->gridDimY) continue;
+				int neighborBlock = (*this).getBlock(nx, ny);
+				if(neighborBlock == block) continue;
+				int neighbor = this->grid->getNodeIdx(nx, ny);
+				if(!this->grid->nodes[neighbor].walkable) continue;
+
+				int neighborState = (*this).getState(neighborBlock);
+				int neighborIndex = this->database->boundaryIndex[(*this).getLocalCell(neighbor)];
+				(*this).relax(neighborState, neighborIndex, this->gValues[this->states[state].slot + index] + this->heuristic.getStepCost(offsetX[dir], offsetY[dir]), cell);
+			}
+		}
+	}
+
+	int getParent(int cell)
+	{
+		int state = this->stateOf[(*this).getBlock(this->grid->nodes[cell].x, this->grid->nodes[cell].y)];
+		return this->parents[this->states[state].slot + this->database->boundaryIndex[(*this).getLocalCell(cell)]];
+	}
+
+	// boundary cells from the goal back to the start, with the in-block segments filled in by local searches
+	void buildPath()
+	{
+		vector<int> waypoints(1, this->endIdx);
+		int cell = this->goalParent;
+		while(cell >= 0 and cell != this->startIdx)
+		{
+			waypoints.push_back(cell);
+			cell = (*this).getParent(cell);
+		}
+		waypoints.push_back(this->startIdx);
+		reverse(waypoints.begin(), waypoints.end());
+
+		vector<int> straight, diagonal, previous, segment;
+		this->path.assign(1, this->startIdx);
+		for(int entry = 1; entry < waypoints.size(); entry++)
+		{
+			int from = waypoints[entry - 1];
+			int to = waypoints[entry];
+			int block = (*this).getBlock(this->grid->nodes[from].x, this->grid->nodes[from].y);
+			if(from == to) continue;
+			if(block != (*this).getBlock(this->grid->nodes[to].x, this->grid->nodes[to].y))
+			{
+				this->path.push_back(to);
+				continue;
+			}
+
+			this->database->localSearch(this->database->getMask(block), (*this).getLocalCell(from), this->heuristic.straightCost,
+										this->heuristic.diagonalCost, straight, diagonal, previous);
+			int x0 = (block % this->database->blocksX) * this->database->blockSize;
+			int y0 = (block / this->database->blocksX) * this->database->blockSize;
+			segment.clear();
+			for(int local = (*this).getLocalCell(to); local != (*this).getLocalCell(from); local = previous[local])
+				segment.push_back(this->grid->getNodeIdx(x0 + local % this->database->blockSize, y0 + local / this->database->blockSize));
+			this->path.insert(this->path.end(), segment.rbegin(), segment.rend());
+		}
+	}
+
+	double getPathCost()
+	{
+		if(this->status != SEARCH_FOUND) return -1.0;
+		return this->heuristic.toLength(this->bestLength);
+	}
+
+	// the path holds every cell once, so the chain is walked with a cursor that restarts at the end
+	int extractPath(mPathResult &result)
+	{
+		result.setCostMode(this->heuristic.costMode);
+		if(this->path.size() == 0)
+		{
+			result.clear();
+			return 0;
+		}
+		int cursor = this->path.size() - 1;
+		return result.extractChain(this->grid, this->path.back(), [this, cursor](int index) mutable -> int
+		{
+			if(index == this->path.back()) cursor = this->path.size() - 1;
+			return (cursor > 0) ? this->path[--cursor] : -1;
+		});
+	}
+
+	// search state of the last query (the database is shared and not counted)
+	long memoryUsage()
+	{
+		return (long) (this->states.size() * (sizeof(BlockState) + 2 * sizeof(int)) +
+					   this->gValues.size() * sizeof(double) + this->parents.size() * sizeof(int) +
+					   this->openSet.capacity() * sizeof(int));
+	}
+
+	double heuristicFunction(int cell)
+	{
+		return this->heuristic.estimate(this->grid->nodes[cell].x - this->grid->nodes[this->endIdx].x,
+										this->grid->nodes[cell].y - this->grid->nodes[this->endIdx].y, this->grid->connectivity);
+	}
+
+	// heap over block states, ordered by their key (lowest pending f-value)
+	void heapSwap(int idxA, int idxB)
+	{
+		int temp = this->openSet[idxA];
+		this->openSet[idxA] = this->openSet[idxB];
+		this->openSet[idxB] = temp;
+		this->states[this->openSet[idxA]].heapIndex = idxA;
+		this->states[this->openSet[idxB]].heapIndex = idxB;
+	}
+
+	void heapAdd(int state)
+	{
+		this->heapOperations++;
+		this->states[state].heapIndex = this->openSet.size();
+		this->openSet.push_back(state);
+		(*this).heapSortUp(this->openSet.size() - 1);
+	}
+
+	int heapRemove()
+	{
+		this->heapOperations++;
+		int first = this->openSet[0];
+		(*this).heapSwap(0, this->openSet.size() - 1);
+		this->openSet.pop_back();
+		(*this).heapSortDown(0);
+		this->states[first].heapIndex = -1;
+		return first;
+	}
+
+	void heapSortUp(int idx)
+	{
+		while(idx > 0)
+		{
+			int parentIdx = (idx - 1) / 2;
+			if(this->states[this->openSet[idx]].key >= this->states[this->openSet[parentIdx]].key) return;
+			(*this).heapSwap(idx, parentIdx);
+			idx = parentIdx;
+		}
+	}
+
+	void heapSortDown(int idx)
+	{
+		int size = this->openSet.size();
+		while(true)
+		{
+			int bestIdx = idx;
+			int leftIdx = 2*idx + 1;
+			int rightIdx = 2*idx + 2;
+			if(leftIdx < size and this->states[this->openSet[leftIdx]].key < this->states[this->openSet[bestIdx]].key) bestIdx = leftIdx;
+			if(rightIdx < size and this->states[this->openSet[rightIdx]].key < this->states[this->openSet[bestIdx]].key) bestIdx = rightIdx;
+			if(bestIdx == idx) return;
+			(*this).heapSwap(idx, bestIdx);
+			idx = bestIdx;
+		}
+	}
+};
+
+#endif
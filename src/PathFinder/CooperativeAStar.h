@@ -0,0 +1,584 @@
+#ifndef COOPERATIVE_ASTAR_H
+#define COOPERATIVE_ASTAR_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Windowed Hierarchical Cooperative A* (WHCA*) for many agents on one mGrid.
+	Each agent searches (cell, timestep) space for 'window' steps against a
+	shared mReservationTable, then reserves the cells of its plan, so agents
+	planned later route around it. A move is blocked if the target cell is
+	reserved at the arrival step or if it swaps places with another agent;
+	waiting costs WHCA_WAIT_COST, except on the goal.
+	The heuristic is the true distance to the goal, from a Reverse Resumable
+	A* (RRA*) per goal: a backward A* from the goal toward the first agent's
+	start that is only resumed when a cell it has not closed yet is queried,
+	so it holds the cells the agents actually ask about instead of the whole
+	grid. The searches are kept between windows and shared by agents with
+	the same goal; once they hold more than 'maxHeuristicCells' cells, the
+	least recently used ones are restarted from their goal. An agent that
+	finds no plan around the agents before it is planned again at the lowest
+	priority; if that fails too it holds its cell for the window, and the
+	agents planned through that cell are planned again around it, so the
+	executed steps never collide. After planning, all agents execute
+	'stepsPerWindow' steps and the next window is planned with rotated
+	priorities.
+*/
+class CooperativeAStar
+{
+public:
+	struct Agent
+	{
+		int position;
+		int goal;
+		int heuristic;
+		vector<int> plan;
+		int planStart;
+		vector<int> trajectory;
+		long moves;
+		bool failed;
+	};
+
+	struct SpaceTimeState
+	{
+		int cell;
+		int time;
+		double gValue;
+		double hValue;
+		int parent;
+		bool closed;
+	};
+
+	struct ReverseNode
+	{
+		float gValue;
+		bool closed;
+	};
+
+	struct ReverseSearch
+	{
+		int goal;
+		int origin;
+		int users;
+		long lastUsed;
+		unordered_map<int, ReverseNode> nodes;
+		vector<pair<float, int> > openSet;
+	};
+
+	struct OpenEntry
+	{
+		double fValue;
+		double hValue;
+		int state;
+
+		// same ordering as mNode::isGreater (lower f first, then lower h)
+		bool operator<(const OpenEntry &other) const
+		{
+			if(this->fValue != other.fValue) return this->fValue > other.fValue;
+			return this->hValue > other.hValue;
+		}
+	};
+
+	mGrid *grid;
+	mReservationTable reservations;
+	vector<Agent> agents;
+	vector<ReverseSearch> heuristics;
+	map<int, int> heuristicIndex;
+	long maxHeuristicCells;
+	long heuristicQueries;
+	int window;
+	int stepsPerWindow;
+	int currentTime;
+	int windowCount;
+	vector<SpaceTimeState> states;
+	unordered_map<uint64_t, int> stateIndex;
+	vector<OpenEntry> openSet;
+	long expansions;
+	long failedPlans;
+	double planningTime;
+	bool verbose;
+
+	CooperativeAStar(mGrid *_grid, int _window=WHCA_WINDOW) : grid(_grid),
+															  window(_window),
+															  stepsPerWindow(max(1, _window / 2)),
+															  currentTime(0),
+															  windowCount(0),
+															  maxHeuristicCells(WHCA_HEURISTIC_CELLS),
+															  heuristicQueries(0),
+															  expansions(0),
+															  failedPlans(0),
+															  planningTime(0.0),
+															  verbose(true)
+	{}
+
+	CooperativeAStar(const CooperativeAStar &_other)
+	{
+		this->grid = _other.grid;
+		this->reservations = _other.reservations;
+		this->agents = _other.agents;
+		this->heuristics = _other.heuristics;
+		this->heuristicIndex = _other.heuristicIndex;
+		this->maxHeuristicCells = _other.maxHeuristicCells;
+		this->heuristicQueries = _other.heuristicQueries;
+		this->window = _other.window;
+		this->stepsPerWindow = _other.stepsPerWindow;
+		this->currentTime = _other.currentTime;
+		this->windowCount = _other.windowCount;
+		this->expansions = _other.expansions;
+		this->failedPlans = _other.failedPlans;
+		this->planningTime = _other.planningTime;
+		this->verbose = _other.verbose;
+	}
+
+	virtual ~CooperativeAStar(){}
+
+	void setVerbose(bool _b)
+	{
+		this->verbose = _b;
+	}
+
+	void setStepsPerWindow(int _steps)
+	{
+		this->stepsPerWindow = max(1, min(_steps, this->window));
+	}
+
+	// returns the agent id, or -1 if the goal cannot be reached or the start is taken
+	int addAgent(int startX, int startY, int goalX, int goalY)
+	{
+		int start = this->grid->getNodeIdx(startX, startY);
+		int goal = this->grid->getNodeIdx(goalX, goalY);
+		if(!this->grid->nodes[start].walkable or !this->grid->nodes[goal].walkable) return -1;
+
+		int heuristic = (*this).getHeuristic(goal, start);
+		if((*this).getDistance(heuristic, start) == FLT_MAX)
+		{
+			// the search of an unused goal covered the whole component of the goal, free it
+			if(this->heuristics[heuristic].users == 0) (*this).restartSearch(this->heuristics[heuristic]);
+			return -1;
+		}
+
+		// hold the start cell until the agent's first plan
+		int id = this->agents.size();
+		for(int time = this->currentTime; time <= this->currentTime + this->window; time++)
+		{
+			if(!this->reservations.reserve(start, time, id))
+			{
+				for(int reserved = this->currentTime; reserved < time; reserved++) this->reservations.release(start, reserved, id);
+				return -1;
+			}
+		}
+		this->heuristics[heuristic].users++;
+
+		Agent agent;
+		agent.position = start;
+		agent.goal = goal;
+		agent.heuristic = heuristic;
+		agent.plan.assign(this->window + 1, start);
+		agent.planStart = this->currentTime;
+		agent.trajectory.assign(1, start);
+		agent.moves = 0;
+		agent.failed = false;
+		this->agents.push_back(agent);
+		return id;
+	}
+
+	// reverse search toward 'goal', shared by agents with the same goal ('origin' guides a new one)
+	int getHeuristic(int goal, int origin)
+	{
+		map<int, int>::iterator found = this->heuristicIndex.find(goal);
+		if(found != this->heuristicIndex.end()) return found->second;
+
+		this->heuristics.push_back(ReverseSearch());
+		ReverseSearch &search = this->heuristics.back();
+		search.goal = goal;
+		search.origin = origin;
+		search.users = 0;
+		search.lastUsed = 0;
+		(*this).restartSearch(search);
+		this->heuristicIndex[goal] = this->heuristics.size() - 1;
+		return this->heuristics.size() - 1;
+	}
+
+	// drop every cell of a search (and its memory) and start it again from the goal
+	void restartSearch(ReverseSearch &search)
+	{
+		unordered_map<int, ReverseNode>().swap(search.nodes);
+		vector<pair<float, int> >().swap(search.openSet);
+		ReverseNode node = {0.0f, false};
+		search.nodes[search.goal] = node;
+		search.openSet.push_back(make_pair(-(*this).estimate(search.goal, search.origin), search.goal));
+	}
+
+	// true distance from 'cell' to the goal of a reverse search (FLT_MAX if unreachable)
+	float getDistance(int heuristic, int cell)
+	{
+		ReverseSearch &search = this->heuristics[heuristic];
+		unordered_map<int, ReverseNode>::iterator found = search.nodes.find(cell);
+		if(found != search.nodes.end() and found->second.closed) return found->second.gValue;
+		this->heuristicQueries++;
+		return (*this).resumeSearch(search, cell) ? search.nodes[cell].gValue : FLT_MAX;
+	}
+
+	// continue the backward A* until 'target' is closed; false if it can not be reached
+	bool resumeSearch(ReverseSearch &search, int target)
+	{
+		int neighbors[8];
+		while(search.openSet.size() > 0)
+		{
+			pop_heap(search.openSet.begin(), search.openSet.end());
+			int cell = search.openSet.back().second;
+			search.openSet.pop_back();
+			ReverseNode &node = search.nodes[cell];
+			if(node.closed) continue;
+			node.closed = true;
+
+			// moves are symmetric, so the forward neighbors are the backward ones
+			float gValue = node.gValue;
+			int count = (*this).getConnectedNeighbors(cell, neighbors);
+			for(int neighbor = 0; neighbor < count; neighbor++)
+			{
+				float distance = gValue + (float) (*this).getStepCost(cell, neighbors[neighbor]);
+				unordered_map<int, ReverseNode>::iterator next = search.nodes.find(neighbors[neighbor]);
+				if(next != search.nodes.end() and (next->second.closed or distance >= next->second.gValue)) continue;
+
+				ReverseNode open = {distance, false};
+				search.nodes[neighbors[neighbor]] = open;
+				search.openSet.push_back(make_pair(-(distance + (*this).estimate(neighbors[neighbor], search.origin)), neighbors[neighbor]));
+				push_heap(search.openSet.begin(), search.openSet.end());
+			}
+			if(cell == target) return true;
+		}
+		return false;
+	}
+
+	// octile (or Manhattan) distance, consistent with the step costs
+	float estimate(int cellA, int cellB)
+	{
+		int dx = abs(this->grid->nodes[cellA].x - this->grid->nodes[cellB].x);
+		int dy = abs(this->grid->nodes[cellA].y - this->grid->nodes[cellB].y);
+		if(this->grid->connectivity == 8) return (float) (abs(dx - dy) + M_SQRT2 * min(dx, dy));
+		return (float) (dx + dy);
+	}
+
+	// restart the least recently used searches (except 'keep') until they fit in maxHeuristicCells
+	void trimHeuristics(int keep)
+	{
+		long cells = (*this).heuristicCells();
+		while(cells > this->maxHeuristicCells)
+		{
+			int oldest = -1;
+			for(int heuristic = 0; heuristic < this->heuristics.size(); heuristic++)
+			{
+				if(heuristic == keep or this->heuristics[heuristic].nodes.size() <= 1) continue;
+				if(oldest < 0 or this->heuristics[heuristic].lastUsed < this->heuristics[oldest].lastUsed) oldest = heuristic;
+			}
+			if(oldest < 0) break;
+			cells -= this->heuristics[oldest].nodes.size() - 1;
+			(*this).restartSearch(this->heuristics[oldest]);
+		}
+	}
+
+	long heuristicCells()
+	{
+		long cells = 0;
+		for(int heuristic = 0; heuristic < this->heuristics.size(); heuristic++) cells += this->heuristics[heuristic].nodes.size();
+		return cells;
+	}
+
+	// plan every agent for the next window, then execute 'stepsPerWindow' steps
+	void planWindow()
+	{
+		double stime = omp_get_wtime();
+		this->reservations.advance(this->currentTime);
+
+		// rotate priorities so that no agent is always planned last
+		int count = this->agents.size();
+		vector<int> deferred;
+		for(int order = 0; order < count; order++)
+		{
+			int agent = (order + this->windowCount) % count;
+			(*this).releasePlan(agent);
+			this->agents[agent].failed = false;
+			if(!(*this).planAgent(agent) or !(*this).reservePlan(agent))
+			{
+				(*this).releasePlan(agent);
+				deferred.push_back(agent);
+			}
+		}
+
+		// blocked agents retry around every plan of this window, and hold their cell if they still can not move
+		for(int agent = 0; agent < deferred.size(); agent++)
+		{
+			if(!(*this).planAgent(deferred[agent]) or !(*this).reservePlan(deferred[agent]))
+			{
+				(*this).releasePlan(deferred[agent]);
+				(*this).holdAgent(deferred[agent]);
+			}
+		}
+		this->planningTime += omp_get_wtime() - stime;
+
+		for(int agent = 0; agent < count; agent++)
+		{
+			Agent &current = this->agents[agent];
+			for(int step = 1; step <= this->stepsPerWindow; step++)
+			{
+				if(current.plan[step] != current.plan[step - 1]) current.moves++;
+				current.trajectory.push_back(current.plan[step]);
+			}
+			current.position = current.plan[this->stepsPerWindow];
+		}
+		this->currentTime += this->stepsPerWindow;
+		this->windowCount++;
+	}
+
+	// plan windows until every agent is on its goal (or 'maxWindows' is reached)
+	int run(int maxWindows)
+	{
+		int windows = 0;
+		while(windows < maxWindows and (*this).countArrived() < this->agents.size())
+		{
+			(*this).planWindow();
+			windows++;
+		}
+		if(this->verbose) (*this).print();
+		return windows;
+	}
+
+	void releasePlan(int agent)
+	{
+		Agent &current = this->agents[agent];
+		for(int step = 0; step < current.plan.size(); step++)
+		{
+			int time = current.planStart + step;
+			if(time >= this->currentTime) this->reservations.release(current.plan[step], time, agent);
+		}
+	}
+
+	/*
+		Keeps the agent on its cell for the whole window. The cell is taken
+		from any agent planned through it, which is planned again around the
+		hold (and holds in turn if it can not). Agents start on distinct cells,
+		so two holds never meet and every agent holds at most once per window.
+	*/
+	void holdAgent(int agent)
+	{
+		Agent &current = this->agents[agent];
+		current.plan.assign(this->window + 1, current.position);
+		current.planStart = this->currentTime;
+		current.failed = true;
+		this->failedPlans++;
+
+		vector<int> bumped;
+		for(int step = 0; step <= this->window; step++)
+		{
+			int other = this->reservations.getOwner(current.position, this->currentTime + step);
+			if(other >= 0 and other != agent)
+			{
+				(*this).releasePlan(other);
+				bumped.push_back(other);
+			}
+			this->reservations.reserve(current.position, this->currentTime + step, agent);
+		}
+
+		for(int other = 0; other < bumped.size(); other++)
+		{
+			if(!(*this).planAgent(bumped[other]) or !(*this).reservePlan(bumped[other]))
+			{
+				(*this).releasePlan(bumped[other]);
+				(*this).holdAgent(bumped[other]);
+			}
+		}
+	}
+
+	// reserves every free step of the plan; false if another agent holds one of them
+	bool reservePlan(int agent)
+	{
+		Agent &current = this->agents[agent];
+		bool reserved = true;
+		for(int step = 0; step < current.plan.size(); step++)
+		{
+			if(!this->reservations.reserve(current.plan[step], current.planStart + step, agent)) reserved = false;
+		}
+		return reserved;
+	}
+
+	/*
+		Space-time A* from the agent's position at currentTime. Stops at the
+		first state popped at the end of the window; its f-value already holds
+		the true distance left to the goal. If no state reaches the end of the
+		window the plan waits in place and false is returned; planWindow then
+		retries or holds the agent.
+	*/
+	bool planAgent(int agent)
+	{
+		Agent &current = this->agents[agent];
+		(*this).trimHeuristics(current.heuristic);
+		this->heuristics[current.heuristic].lastUsed = this->heuristicQueries; // a clock for trimHeuristics
+		this->states.clear();
+		this->stateIndex.clear();
+		this->openSet.clear();
+
+		int endTime = this->currentTime + this->window;
+		int first = (*this).getState(current.position, this->currentTime);
+		this->states[first].gValue = 0.0;
+		this->states[first].hValue = (*this).getDistance(current.heuristic, current.position);
+		OpenEntry entry = {this->states[first].hValue, this->states[first].hValue, first};
+		this->openSet.push_back(entry);
+
+		int neighbors[9];
+		int last = -1;
+		while(this->openSet.size() > 0)
+		{
+			pop_heap(this->openSet.begin(), this->openSet.end());
+			OpenEntry top = this->openSet.back();
+			this->openSet.pop_back();
+			if(this->states[top.state].closed) continue;
+			this->states[top.state].closed = true;
+			this->expansions++;
+
+			int cell = this->states[top.state].cell;
+			int time = this->states[top.state].time;
+			if(time == endTime)
+			{
+				last = top.state;
+				break;
+			}
+
+			// moves, then waiting in place
+			int count = (*this).getConnectedNeighbors(cell, neighbors);
+			neighbors[count++] = cell;
+			for(int node = 0; node < count; node++)
+			{
+				int next = neighbors[node];
+				if(!this->reservations.isFree(next, time + 1, agent)) continue;
+				float distance = (*this).getDistance(current.heuristic, next);
+				if(distance == FLT_MAX) continue;
+
+				// no swapping places with another agent
+				int other = this->reservations.getOwner(next, time);
+				if(next != cell and other >= 0 and other != agent and this->reservations.getOwner(cell, time + 1) == other) continue;
+
+				double stepCost;
+				if(next != cell) stepCost = (*this).getStepCost(cell, next);
+				else stepCost = (cell == current.goal) ? 0.0 : WHCA_WAIT_COST;
+
+				int state = (*this).getState(next, time + 1);
+				double gValue = this->states[top.state].gValue + stepCost;
+				if(this->states[state].closed or gValue >= this->states[state].gValue) continue;
+
+				this->states[state].gValue = gValue;
+				this->states[state].hValue = distance;
+				this->states[state].parent = top.state;
+				OpenEntry child = {gValue + distance, distance, state};
+				this->openSet.push_back(child);
+				push_heap(this->openSet.begin(), this->openSet.end());
+			}
+		}
+
+		current.planStart = this->currentTime;
+		if(last < 0)
+		{
+			current.plan.assign(this->window + 1, current.position);
+			return false;
+		}
+
+		for(int state = last; state >= 0; state = this->states[state].parent)
+			current.plan[this->states[state].time - this->currentTime] = this->states[state].cell;
+		return true;
+	}
+
+	int getState(int cell, int time)
+	{
+		uint64_t key = mReservationTable::makeKey(cell, time);
+		unordered_map<uint64_t, int>::iterator found = this->stateIndex.find(key);
+		if(found != this->stateIndex.end()) return found->second;
+
+		SpaceTimeState state = {cell, time, DBL_MAX, DBL_MAX, -1, false};
+		this->states.push_back(state);
+		this->stateIndex[key] = this->states.size() - 1;
+		return this->states.size() - 1;
+	}
+
+	int getConnectedNeighbors(int cell, int *neighbors)
+	{
+		// same order as mGrid: 4 orthogonal neighbors, then diagonals
+		static const int offsetX[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+		static const int offsetY[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+		int x = this->grid->nodes[cell].x;
+		int y = this->grid->nodes[cell].y;
+		int count = 0;
+		for(int dir = 0; dir < this->grid->connectivity; dir++)
+		{
+			int nx = x + offsetX[dir];
+			int ny = y + offsetY[dir];
+			if(nx < 0 or nx >= this->grid->gridDimX or ny < 0 or ny >= this->grid->gridDimY) continue;
+
+			int index = this->grid->getNodeIdx(nx, ny);
+			if(this->grid->nodes[index].walkable) neighbors[count++] = index;
+		}
+		return count;
+	}
+
+	double getStepCost(int cellA, int cellB)
+	{
+		bool diagonal = (this->grid->nodes[cellA].x != this->grid->nodes[cellB].x and this->grid->nodes[cellA].y != this->grid->nodes[cellB].y);
+		return diagonal ? M_SQRT2 : 1.0;
+	}
+
+	int countArrived()
+	{
+		int arrived = 0;
+		for(int agent = 0; agent < this->agents.size(); agent++)
+		{
+			if(this->agents[agent].position == this->agents[agent].goal) arrived++;
+		}
+		return arrived;
+	}
+
+	// agents on the same cell at the same step, or swapping cells, along the executed steps
+	long countConflicts()
+	{
+		long conflicts = 0;
+		int steps = (this->agents.size() > 0) ? this->agents[0].trajectory.size() : 0;
+		for(int step = 0; step < steps; step++)
+		{
+			unordered_map<int, int> occupied;
+			for(int agent = 0; agent < this->agents.size(); agent++)
+			{
+				vector<int> &trajectory = this->agents[agent].trajectory;
+				if(step >= trajectory.size()) continue;
+				if(!occupied.insert(make_pair(trajectory[step], agent)).second) conflicts++;
+			}
+			if(step == 0) continue;
+
+			// a swap: 'agent' enters the cell 'other' left, and 'other' enters the cell 'agent' left
+			for(int agent = 0; agent < this->agents.size(); agent++)
+			{
+				vector<int> &trajectory = this->agents[agent].trajectory;
+				if(step >= trajectory.size() or trajectory[step] == trajectory[step - 1]) continue;
+
+				unordered_map<int, int>::iterator found = occupied.find(trajectory[step - 1]);
+				if(found == occupied.end() or found->second == agent) continue;
+				vector<int> &other = this->agents[found->second].trajectory;
+				if(other[step - 1] == trajectory[step] and found->second > agent) conflicts++;
+			}
+		}
+		return conflicts;
+	}
+
+	void print()
+	{
+		double plansPerSecond = (this->planningTime > 0.0) ? this->windowCount * (double) this->agents.size() / this->planningTime : 0.0;
+		cout << "cooperative A*: " << this->agents.size() << " agents, window " << this->window << ", " << this->windowCount << " windows, ";
+		cout << (*this).countArrived() << " arrived, " << this->failedPlans << " failed plans" << endl;
+		cout << "planning time: " << this->planningTime << " secs (" << (this->windowCount > 0 ? 1.0e3 * this->planningTime / this->windowCount : 0.0);
+		cout << " ms per window, " << plansPerSecond << " agent plans/sec), " << this->expansions << " expansions, ";
+		cout << "reservations: " << this->reservations.memoryUsage() << " bytes, heuristics: " << this->heuristics.size() << " goals, ";
+		cout << (*this).heuristicCells() << " cells" << endl;
+	}
+};
+
+#endif
@@ -0,0 +1,452 @@
+#ifndef IDA_STAR_H
+#define IDA_STAR_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Iterative-deepening A* for deployments that cannot afford per-cell search
+	state. Each iteration is a depth-first search bounded by an f-value
+	threshold, and the next threshold is the smallest f-value that exceeded
+	it, so the first path found is optimal. Transpositions are pruned with a
+	fixed-size, set-associative table of (cell, g-value, stamp) entries, the
+	stamp counting iterations over all queries: a cell reached again with a
+	higher g-value (or the same g-value in the same iteration) is not searched
+	again, and entries of earlier queries count as empty. Entries are overwritten when the
+	table is full, which only costs repeated expansions, never optimality.
+	All memory comes from 'memoryCap' bytes: up to half for the table and the
+	rest for the depth-first stack and the path, so a search whose path is
+	deeper than the stack allows stops with SEARCH_MEMORY_LIMIT. Each query
+	starts with IDA_TABLE_MIN_ENTRIES entries and doubles the table whenever
+	half of it holds entries of the query, up to half of the cap and never
+	beyond one slot per grid cell, so the table follows the cells the query
+	visits. On the seeded bench maps IDA* then peaks below SparseAStar, which
+	keeps state for every generated cell: 9.8 KB against 15.8 KB at 64x64
+	and 40 KB against 300 KB at 256x256 with the default cap, paid for with
+	re-expansions (a table smaller than the visited cells forgets them).
+	Like SparseAStar, the grid is only read for walkability.
+*/
+class IDAStar
+{
+public:
+	struct TableEntry
+	{
+		int cell;
+		int stamp;
+		double gValue;
+	};
+
+	struct Frame
+	{
+		int cell;
+		int parent;
+		int nextDir;
+		double gValue;
+	};
+
+	mGrid *grid;
+	vector<TableEntry> table;
+	vector<Frame> stack;
+	vector<int> path;
+	vector<int> bestPath;
+	long memoryCap;
+	int tableMask;
+	long maxTableEntries;
+	long tableUsed;
+	int maxDepth;
+	int startIdx;
+	int endIdx;
+	int iteration;
+	int stamp;
+	int queryStamp;
+	int status;
+	bool boxRejected;
+	double threshold;
+	double bestHValue;
+	mSearchLimits limits;
+	mSearchFilter *filter;
+	mHeuristic heuristic;
+	int peakDepth;
+	long expansions;
+	long prunedByTable;
+	long peakMemory;
+	double searchTime;
+	bool verbose;
+
+	IDAStar(mGrid *_grid, long _memoryCap=IDA_MEMORY_CAP) : grid(_grid),
+															 memoryCap(_memoryCap),
+															 startIdx(-1),
+															 endIdx(-1),
+															 iteration(0),
+															 stamp(0),
+															 queryStamp(0),
+															 status(SEARCH_NO_PATH),
+															 boxRejected(false),
+															 threshold(0.0),
+															 bestHValue(DBL_MAX),
+															 filter(NULL),
+															 peakDepth(0),
+															 expansions(0),
+															 prunedByTable(0),
+															 peakMemory(0),
+															 searchTime(0.0),
+															 verbose(true)
+	{
+		(*this).setMemoryCap(_memoryCap);
+	}
+
+	IDAStar(const IDAStar &_other)
+	{
+		this->grid = _other.grid;
+		this->table = _other.table;
+		this->stack = _other.stack;
+		this->path = _other.path;
+		this->bestPath = _other.bestPath;
+		this->memoryCap = _other.memoryCap;
+		this->tableMask = _other.tableMask;
+		this->maxTableEntries = _other.maxTableEntries;
+		this->tableUsed = _other.tableUsed;
+		this->maxDepth = _other.maxDepth;
+		this->startIdx = _other.startIdx;
+		this->endIdx = _other.endIdx;
+		this->iteration = _other.iteration;
+		this->stamp = _other.stamp;
+		this->queryStamp = _other.queryStamp;
+		this->status = _other.status;
+		this->boxRejected = _other.boxRejected;
+		this->threshold = _other.threshold;
+		this->bestHValue = _other.bestHValue;
+		this->limits = _other.limits;
+		this->filter = _other.filter;
+		this->heuristic = _other.heuristic;
+		this->peakDepth = _other.peakDepth;
+		this->expansions = _other.expansions;
+		this->prunedByTable = _other.prunedByTable;
+		this->peakMemory = _other.peakMemory;
+		this->searchTime = _other.searchTime;
+		this->verbose = _other.verbose;
+	}
+
+	virtual ~IDAStar(){}
+
+	void setVerbose(bool _b)
+	{
+		this->verbose = _b;
+	}
+
+	void setSearchLimits(mSearchLimits &_limits)
+	{
+		this->limits = _limits;
+	}
+
+	void setHeuristic(int kind)
+	{
+		this->heuristic.setKind(kind);
+	}
+
+	void setCostMode(int mode)
+	{
+		this->heuristic.setCostMode(mode);
+	}
+
+	// cells the filter rejects are never entered (NULL: no filter)
+	void setSearchFilter(mSearchFilter *_filter)
+	{
+		this->filter = _filter;
+	}
+
+	// the table may grow to the largest power of two in half of the cap (and the grid), the rest bounds the stack and the paths
+	void setMemoryCap(long _memoryCap)
+	{
+		this->memoryCap = _memoryCap;
+		long entries = IDA_TABLE_WAYS;
+		while(2 * entries * (long) sizeof(TableEntry) <= this->memoryCap / 2 and entries < this->grid->gridSize) entries *= 2;
+		this->maxTableEntries = entries;
+		(*this).resetTable();
+
+		long stackBytes = this->memoryCap - entries * (long) sizeof(TableEntry);
+		this->maxDepth = (int) max(1L, stackBytes / (long) (sizeof(Frame) + 2 * sizeof(int)));
+		this->stack.reserve(min(this->maxDepth, 1024));
+		this->stamp = 0;
+	}
+
+	// back to the smallest table; entries of earlier queries are dropped anyway
+	void resetTable()
+	{
+		long entries = min((long) IDA_TABLE_MIN_ENTRIES, this->maxTableEntries);
+		TableEntry empty = {-1, 0, DBL_MAX};
+		vector<TableEntry>(entries, empty).swap(this->table);
+		this->tableMask = entries - 1;
+		this->tableUsed = 0;
+	}
+
+	// doubles the table, keeping the entries of the current query
+	void growTable()
+	{
+		vector<TableEntry> old(2 * this->table.size());
+		old.swap(this->table);
+		TableEntry empty = {-1, 0, DBL_MAX};
+		fill(this->table.begin(), this->table.end(), empty);
+		this->tableMask = this->table.size() - 1;
+		this->tableUsed = 0;
+		int current = this->stamp;
+		for(int slot = 0; slot < (int) old.size(); slot++)
+		{
+			if(old[slot].stamp < this->queryStamp) continue;
+			this->stamp = old[slot].stamp;
+			(*this).storeEntry(old[slot].cell, old[slot].gValue);
+		}
+		this->stamp = current;
+	}
+
+	bool findPath(int startX, int startY, int endX, int endY)
+	{
+		double stime = omp_get_wtime();
+		this->startIdx = this->grid->getNodeIdx(startX, startY);
+		this->endIdx = this->grid->getNodeIdx(endX, endY);
+		this->path.clear();
+		this->bestPath.clear();
+		this->bestHValue = DBL_MAX;
+		this->boxRejected = false;
+		this->expansions = 0;
+		this->prunedByTable = 0;
+		this->peakDepth = 0;
+		this->iteration = 0;
+		this->status = SEARCH_NO_PATH;
+
+		// restart the stamps (and clear the table) long before they overflow
+		if(this->stamp > INT_MAX / 2) (*this).setMemoryCap(this->memoryCap);
+		else if(this->table.size() > IDA_TABLE_MIN_ENTRIES) (*this).resetTable();
+		this->tableUsed = 0;
+		this->queryStamp = this->stamp + 1;
+		if(!this->grid->nodes[this->startIdx].walkable or !this->grid->nodes[this->endIdx].walkable)
+		{
+			if(this->verbose) cout << "start and/or end nodes are not walkable." << endl;
+			this->searchTime = omp_get_wtime() - stime;
+			return false;
+		}
+
+		this->threshold = (*this).heuristicFunction(this->startIdx);
+		this->status = SEARCH_IN_PROGRESS;
+		while(this->status == SEARCH_IN_PROGRESS)
+		{
+			double nextThreshold = (*this).searchIteration(stime);
+			if(this->status != SEARCH_IN_PROGRESS) break;
+			if(nextThreshold == DBL_MAX) this->status = SEARCH_NO_PATH;
+			this->threshold = nextThreshold;
+		}
+		if(this->status == SEARCH_NO_PATH and this->boxRejected) this->status = SEARCH_BOX_LIMIT;
+		if(this->status != SEARCH_FOUND) this->path = this->bestPath;
+		this->searchTime = omp_get_wtime() - stime;
+		this->peakMemory = (*this).memoryUsage();
+
+		if(this->verbose)
+		{
+			cout << endl << "search time: " << this->searchTime << " secs, " << this->iteration << " iterations" << endl;
+			cout << "expanded nodes: " << this->expansions << ", pruned by table: " << this->prunedByTable;
+			cout << ", peak memory: " << this->peakMemory << " bytes" << endl;
+			if(this->status == SEARCH_FOUND)
+				cout << "path from start to end node was found :)" << endl << "length: " << (*this).getPathCost() << endl;
+			else if(this->status == SEARCH_NO_PATH)
+				cout << "no path found :(" << endl;
+			else
+				cout << "search stopped by " << mSearchLimits::statusName(this->status) << ", partial path cost: " << (*this).getPathCost() << endl;
+		}
+		return (this->status == SEARCH_FOUND);
+	}
+
+	/*
+		One depth-first pass bounded by 'threshold'. Returns the smallest
+		f-value above the threshold (DBL_MAX if none) and leaves the status
+		SEARCH_IN_PROGRESS unless the goal was found or a limit was hit. The
+		tolerance on f-values absorbs rounding of Euclidean step costs, which
+		would otherwise add iterations for f-values that only differ in the
+		last bits.
+	*/
+	double searchIteration(double startTime)
+	{
+		static const int offsetX[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+		static const int offsetY[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+		this->iteration++;
+		this->stamp++;
+		double tolerance = 1.0e-9 * max(1.0, this->threshold);
+		double bound = this->threshold + tolerance;
+		double nextThreshold = DBL_MAX;
+
+		this->stack.clear();
+		Frame first = {this->startIdx, -1, 0, 0.0};
+		this->stack.push_back(first);
+		(*this).storeEntry(this->startIdx, 0.0);
+		bool entered = true;
+		while(this->stack.size() > 0)
+		{
+			Frame &top = this->stack.back();
+			if(entered)
+			{
+				// first visit of the top frame: it counts as an expansion
+				int limitStatus = this->limits.check(this->expansions, this->heuristic.toLength(this->threshold), startTime);
+				if(limitStatus != SEARCH_IN_PROGRESS)
+				{
+					this->status = limitStatus;
+					return nextThreshold;
+				}
+				this->expansions++;
+				entered = false;
+
+				double hValue = (*this).heuristicFunction(top.cell);
+				if(hValue < this->bestHValue)
+				{
+					this->bestHValue = hValue;
+					(*this).copyStack(this->bestPath);
+				}
+				if(top.cell == this->endIdx)
+				{
+					(*this).copyStack(this->path);
+					this->status = SEARCH_FOUND;
+					return nextThreshold;
+				}
+			}
+
+			if(top.nextDir >= this->grid->connectivity)
+			{
+				this->stack.pop_back();
+				continue;
+			}
+
+			int dir = top.nextDir++;
+			int nx = this->grid->nodes[top.cell].x + offsetX[dir];
+			int ny = this->grid->nodes[top.cell].y + offsetY[dir];
+			if(nx < 0 or nx >= this->grid->gridDimX or ny < 0 or ny >= this->grid->gridDimY) continue;
+
+			int neighbor = this->grid->getNodeIdx(nx, ny);
+			if(neighbor == top.parent or !this->grid->nodes[neighbor].walkable) continue;
+			if(this->limits.useBox and !this->limits.insideBox(nx, ny))
+			{
+				this->boxRejected = true;
+				continue;
+			}
+			if(this->filter != NULL and !this->filter->allows(neighbor)) continue;
+
+			double gValue = top.gValue + this->heuristic.getStepCost(offsetX[dir], offsetY[dir]);
+			double fValue = gValue + (*this).heuristicFunction(neighbor);
+			if(fValue > bound)
+			{
+				nextThreshold = min(nextThreshold, fValue);
+				continue;
+			}
+			if(!(*this).storeEntry(neighbor, gValue))
+			{
+				this->prunedByTable++;
+				continue;
+			}
+
+			if(this->stack.size() >= this->maxDepth)
+			{
+				this->status = SEARCH_MEMORY_LIMIT;
+				return nextThreshold;
+			}
+			Frame frame = {neighbor, top.cell, 0, gValue};
+			this->stack.push_back(frame);
+			this->peakDepth = max(this->peakDepth, (int) this->stack.size());
+			entered = true;
+		}
+		return nextThreshold;
+	}
+
+	/*
+		Records a visit of 'cell' with 'gValue', returns false if the visit is
+		dominated: an entry of this iteration with a g-value at most as high,
+		or of an earlier one with a strictly lower g-value (a cheaper path to
+		the cell exists, and it is still within the larger threshold).
+	*/
+	bool storeEntry(int cell, double gValue)
+	{
+		uint32_t h = (uint32_t) cell * 2654435761u;
+		int bucket = (int) ((h ^ (h >> 16)) & this->tableMask) & ~(IDA_TABLE_WAYS - 1);
+		double tolerance = 1.0e-9 * max(1.0, gValue);
+		int victim = bucket;
+		for(int way = 0; way < IDA_TABLE_WAYS; way++)
+		{
+			TableEntry &entry = this->table[bucket + way];
+			if(entry.cell == cell and entry.stamp >= this->queryStamp)
+			{
+				if(entry.stamp == this->stamp and gValue >= entry.gValue - tolerance) return false;
+				if(entry.stamp != this->stamp and gValue > entry.gValue + tolerance) return false;
+				entry.gValue = gValue;
+				entry.stamp = this->stamp;
+				return true;
+			}
+
+			// replace an entry of an older iteration first, then the one with the highest g-value
+			TableEntry &current = this->table[victim];
+			if(entry.stamp < current.stamp or (entry.stamp == current.stamp and entry.gValue > current.gValue))
+				victim = bucket + way;
+		}
+
+		// a slot this query did not hold yet
+		if(this->table[victim].stamp < this->queryStamp) this->tableUsed++;
+		TableEntry created = {cell, this->stamp, gValue};
+		this->table[victim] = created;
+		if(2 * this->tableUsed > (long) this->table.size() and (long) this->table.size() < this->maxTableEntries) (*this).growTable();
+		return true;
+	}
+
+	void copyStack(vector<int> &cells)
+	{
+		cells.resize(this->stack.size());
+		for(int depth = 0; depth < this->stack.size(); depth++) cells[depth] = this->stack[depth].cell;
+	}
+
+	int getPathEnd()
+	{
+		if(this->path.size() == 0) return -1;
+		return this->path.back();
+	}
+
+	double getPathCost()
+	{
+		double cost = 0.0;
+		for(int entry = 1; entry < this->path.size(); entry++)
+		{
+			cost += this->heuristic.getStepCost(this->grid->nodes[this->path[entry]].x - this->grid->nodes[this->path[entry - 1]].x,
+												this->grid->nodes[this->path[entry]].y - this->grid->nodes[this->path[entry - 1]].y);
+		}
+		return (this->path.size() == 0) ? -1.0 : this->heuristic.toLength(cost);
+	}
+
+	// the path holds every cell once, so the chain is walked with a cursor that restarts at the end
+	int extractPath(mPathResult &result)
+	{
+		result.setCostMode(this->heuristic.costMode);
+		if(this->path.size() == 0)
+		{
+			result.clear();
+			return 0;
+		}
+		int cursor = this->path.size() - 1;
+		int entries = result.extractChain(this->grid, this->path.back(), [this, cursor](int index) mutable -> int
+		{
+			if(index == this->path.back()) cursor = this->path.size() - 1;
+			return (cursor > 0) ? this->path[--cursor] : -1;
+		});
+		result.partial = (this->status != SEARCH_FOUND);
+		return entries;
+	}
+
+	// bytes of the table, the deepest stack and the paths of the last query (at most memoryCap)
+	long memoryUsage()
+	{
+		return (long) (this->table.size() * sizeof(TableEntry) +
+					   this->peakDepth * (sizeof(Frame) + 2 * sizeof(int)));
+	}
+
+	double heuristicFunction(int cell)
+	{
+		return this->heuristic.estimate(this->grid->nodes[cell].x - this->grid->nodes[this->endIdx].x,
+										this->grid->nodes[cell].y - this->grid->nodes[this->endIdx].y, this->grid->connectivity);
+	}
+};
+
+#endif
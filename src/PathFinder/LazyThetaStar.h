@@ -0,0 +1,239 @@
+#ifndef LAZY_THETASTAR_H
+#define LAZY_THETASTAR_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Any-angle search (Lazy Theta*, Nash et al. 2010) over a mGrid. A node's
+	parent may be any visible node, not only a grid neighbor, so the resulting
+	path is a short list of waypoints. Line of sight is only checked when a node
+	is expanded, and runs on the packed rows/columns of a mBitGrid.
+*/
+class LazyThetaStar
+{
+public:
+	mGrid *grid;
+	mBitGrid *bitGrid;
+	mNode *startNode;
+	mNode *endNode;
+	mHeap *openSet;
+	vector<char> closedSet;
+	vector<mNode *> touchedNodes;
+	vector<mNode *> path;
+	double pathLength;
+	long expansions;
+	double searchTime;
+	bool verbose;
+
+	LazyThetaStar(mGrid *_grid) : grid(_grid),
+								  startNode(NULL),
+								  endNode(NULL),
+								  openSet(NULL),
+								  pathLength(-1.0),
+								  expansions(0),
+								  searchTime(0.0),
+								  verbose(true)
+	{
+		this->bitGrid = new mBitGrid(_grid);
+	}
+
+	LazyThetaStar(const LazyThetaStar &_other)
+	{
+		this->grid = _other.grid;
+		this->bitGrid = new mBitGrid(*_other.bitGrid);
+		this->startNode = _other.startNode;
+		this->endNode = _other.endNode;
+		this->openSet = NULL;
+		this->path = _other.path;
+		this->pathLength = _other.pathLength;
+		this->expansions = _other.expansions;
+		this->searchTime = _other.searchTime;
+		this->verbose = _other.verbose;
+	}
+
+	virtual ~LazyThetaStar()
+	{
+		if(this->openSet != NULL)
+		{
+			delete this->openSet;
+			this->openSet = NULL;
+		}
+
+		if(this->bitGrid != NULL)
+		{
+			delete this->bitGrid;
+			this->bitGrid = NULL;
+		}
+	}
+
+	void setVerbose(bool _b)
+	{
+		this->verbose = _b;
+	}
+
+	void setStartNode(int x, int y)
+	{
+		mNode *node = this->grid->getNode(x, y);
+		if(node->walkable) this->startNode = node;
+	}
+
+	void setEndNode(int x, int y)
+	{
+		mNode *node = this->grid->getNode(x, y);
+		if(node->walkable) this->endNode = node;
+	}
+
+	// rebuild the packed walkability after the grid was edited
+	void updateBitGrid()
+	{
+		this->bitGrid->build(this->grid);
+	}
+
+	// clear the search state left in the grid nodes by the previous query
+	void resetSearch()
+	{
+		for(int node = 0; node < this->touchedNodes.size(); node++)
+		{
+			this->touchedNodes[node]->setGValue(DBL_MAX);
+			this->touchedNodes[node]->setHValue(DBL_MAX);
+			this->touchedNodes[node]->setPrevious(NULL);
+			this->touchedNodes[node]->setHeapIndex(-1);
+		}
+		this->touchedNodes.clear();
+		this->closedSet.assign(this->grid->gridSize, 0);
+		this->path.clear();
+		this->pathLength = -1.0;
+		this->expansions = 0;
+		this->bitGrid->losChecks = 0;
+		this->bitGrid->wordChecks = 0;
+
+		if(this->openSet == NULL) this->openSet = new mHeap(this->grid->gridSize);
+		this->openSet->currentSize = 0;
+	}
+
+	bool findPath()
+	{
+		if(this->startNode == NULL or this->endNode == NULL)
+		{
+			cout << "start and/or end nodes not set." << endl;
+			return false;
+		}
+
+		double stime = omp_get_wtime();
+		(*this).resetSearch();
+
+		this->startNode->setGValue(0.0);
+		this->startNode->setHValue((*this).EuclideanDistance(this->startNode, this->endNode));
+		this->touchedNodes.push_back(this->startNode);
+		this->openSet->add(this->startNode);
+
+		bool found = false;
+		while(this->openSet->size() > 0)
+		{
+			mNode *currentNode = this->openSet->remove();
+			this->expansions++;
+			(*this).setVertex(currentNode);
+
+			// Stop if destination node is reached
+			if(currentNode->compare(this->endNode))
+			{
+				found = true;
+				break;
+			}
+			this->closedSet[this->grid->getNodeIdx(currentNode->x, currentNode->y)] = 1;
+
+			// parent of the current node is the candidate parent of its neighbors (path 2)
+			mNode *parentNode = (currentNode->getPrevious() != NULL) ? currentNode->getPrevious() : currentNode;
+			vector<mNode*> neighbors = this->grid->getConnectedNeighbors(currentNode->x, currentNode->y);
+			for (int node = 0; node < neighbors.size(); node++)
+			{
+				mNode *neighbor = neighbors[node];
+				if(this->closedSet[this->grid->getNodeIdx(neighbor->x, neighbor->y)]) continue;
+
+				double newGValue = parentNode->getGValue() + (*this).EuclideanDistance(parentNode, neighbor);
+				if(newGValue < neighbor->getGValue())
+				{
+					if(neighbor->getGValue() == DBL_MAX) this->touchedNodes.push_back(neighbor);
+					neighbor->setPrevious(parentNode);
+					neighbor->setGValue(newGValue);
+
+					if(!this->openSet->contains(neighbor))
+					{
+						neighbor->setHValue((*this).EuclideanDistance(neighbor, this->endNode));
+						this->openSet->add(neighbor);
+					}
+					else
+						this->openSet->update(neighbor);
+				}
+			}
+		}
+
+		if(found) (*this).buildPath();
+		stime = omp_get_wtime() - stime;
+		this->searchTime = stime;
+
+		if(this->verbose)
+		{
+			cout << endl << "search time: " << stime << " secs" << endl;
+			cout << "expanded nodes: " << this->expansions << ", line of sight checks: " << this->bitGrid->losChecks;
+			cout << " (" << this->bitGrid->wordChecks << " word checks)" << endl;
+			if(found)
+				cout << "path from start to end node was found :)" << endl << "length: " << this->pathLength << ", waypoints: " << this->path.size() << endl;
+			else
+				cout << "no path found :(" << endl;
+		}
+
+		return found;
+	}
+
+	// verify the lazily assumed parent and fall back to the best closed grid neighbor (path 1)
+	void setVertex(mNode *node)
+	{
+		mNode *parentNode = node->getPrevious();
+		if(parentNode == NULL) return;
+		if(this->bitGrid->lineOfSight(parentNode->x, parentNode->y, node->x, node->y)) return;
+
+		double bestGValue = DBL_MAX;
+		mNode *bestParent = NULL;
+		vector<mNode*> neighbors = this->grid->getConnectedNeighbors(node->x, node->y);
+		for (int idx = 0; idx < neighbors.size(); idx++)
+		{
+			mNode *neighbor = neighbors[idx];
+			if(!this->closedSet[this->grid->getNodeIdx(neighbor->x, neighbor->y)]) continue;
+
+			double newGValue = neighbor->getGValue() + (*this).EuclideanDistance(neighbor, node);
+			if(newGValue < bestGValue)
+			{
+				bestGValue = newGValue;
+				bestParent = neighbor;
+			}
+		}
+		node->setPrevious(bestParent);
+		node->setGValue(bestGValue);
+	}
+
+	void buildPath()
+	{
+		this->pathLength = this->endNode->getGValue();
+		mNode *currentNode = this->endNode;
+		while(currentNode != NULL)
+		{
+			this->path.push_back(currentNode);
+			currentNode = currentNode->getPrevious();
+		}
+		reverse(this->path.begin(), this->path.end());
+	}
+
+	double EuclideanDistance(mNode *nodeA, mNode *nodeB)
+	{
+		double dx = nodeA->x - nodeB->x;
+		double dy = nodeA->y - nodeB->y;
+
+		return sqrt(dx*dx + dy*dy);
+	}
+};
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Local load generator for PathServer. Sends random queries between walkable
+	cells of the served image over its Unix socket, keeping up to 'inflight'
+	queries outstanding (pipelining), optionally grouped in batches, and
+	reports sustained queries per second and latency percentiles.
+*/
+class LoadGenerator
+{
+public:
+	string socketPath;
+	mGrid *grid;
+	int queries;
+	int inflight;
+	int batchSize;
+	string pathMode;
+	unsigned int seed;
+	int socketFd;
+	vector<int> walkableCells;
+	vector<double> sendTimes;
+	vector<double> latencies;
+	int outstanding;
+	bool connected;
+	mutex stateMutex;
+	condition_variable stateChanged;
+	long foundCount;
+
+	LoadGenerator(string _socketPath, string imagePath, int _queries=10000, int _inflight=64, int _batchSize=1) : socketPath(_socketPath),
+																												grid(NULL),
+																												queries(_queries),
+																												inflight(_inflight),
+																												batchSize(_batchSize),
+																												pathMode("none"),
+																												seed(LOADGEN_SEED),
+																												socketFd(-1),
+																												outstanding(0),
+																												connected(false),
+																												foundCount(0)
+	{
+		cv::Mat image = cv::imread(imagePath);
+		if(image.empty())
+		{
+			cout << "could not read image " << imagePath << endl;
+			return;
+		}
+		this->grid = new mGrid(&image);
+		for(int cell = 0; cell < this->grid->gridSize; cell++)
+		{
+			if(this->grid->nodes[cell].walkable) this->walkableCells.push_back(cell);
+		}
+		if(this->batchSize < 1) this->batchSize = 1;
+		if(this->inflight < this->batchSize) this->inflight = this->batchSize;
+	}
+
+	virtual ~LoadGenerator()
+	{
+		if(this->grid != NULL)
+		{
+			delete this->grid;
+			this->grid = NULL;
+		}
+	}
+
+	void setPathMode(string _mode)
+	{
+		this->pathMode = _mode;
+	}
+
+	void run()
+	{
+		if(this->grid == NULL or this->walkableCells.size() == 0) return;
+		signal(SIGPIPE, SIG_IGN);
+
+		this->socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, this->socketPath.c_str(), sizeof(address.sun_path) - 1);
+		if(this->socketFd < 0 or connect(this->socketFd, (sockaddr *) &address, sizeof(address)) < 0)
+		{
+			cout << "could not connect to " << this->socketPath << endl;
+			return;
+		}
+
+		cout << "sending " << this->queries << " queries (" << this->inflight << " in flight, batches of " << this->batchSize << ")..." << endl;
+		this->sendTimes.assign(this->queries, 0.0);
+		this->latencies.clear();
+		this->latencies.reserve(this->queries);
+		this->connected = true;
+
+		double stime = omp_get_wtime();
+		thread sender(&LoadGenerator::sendQueries, this);
+		(*this).readAnswers();
+		sender.join();
+		stime = omp_get_wtime() - stime;
+		close(this->socketFd);
+
+		(*this).report(stime);
+	}
+
+	void sendQueries()
+	{
+		mt19937 engine(this->seed);
+		uniform_int_distribution<int> pick(0, this->walkableCells.size() - 1);
+		char text[256];
+
+		for(int first = 0; first < this->queries; first += this->batchSize)
+		{
+			int count = min(this->batchSize, this->queries - first);
+			{
+				unique_lock<mutex> lock(this->stateMutex);
+				while(this->connected and this->outstanding + count > this->inflight) this->stateChanged.wait(lock);
+				if(!this->connected) return;
+				this->outstanding += count;
+			}
+
+			string line = (this->batchSize > 1) ? "[" : "";
+			for(int query = first; query < first + count; query++)
+			{
+				mNode &start = this->grid->nodes[this->walkableCells[pick(engine)]];
+				mNode &goal = this->grid->nodes[this->walkableCells[pick(engine)]];
+				snprintf(text, sizeof(text), "{\"id\": %d, \"start\": [%d, %d], \"goal\": [%d, %d], \"path\": \"%s\"}",
+						 query, start.x, start.y, goal.x, goal.y, this->pathMode.c_str());
+				if(query > first) line += ", ";
+				line += text;
+			}
+			if(this->batchSize > 1) line += "]";
+			line += "\n";
+
+			double now = omp_get_wtime();
+			{
+				lock_guard<mutex> lock(this->stateMutex);
+				for(int query = first; query < first + count; query++) this->sendTimes[query] = now;
+			}
+
+			size_t written = 0;
+			while(written < line.size())
+			{
+				ssize_t sent = write(this->socketFd, line.data() + written, line.size() - written);
+				if(sent <= 0)
+				{
+					// the answers to the queries sent so far will not all come, wake the reader
+					shutdown(this->socketFd, SHUT_RDWR);
+					return;
+				}
+				written += sent;
+			}
+		}
+	}
+
+	void readAnswers()
+	{
+		PathServer::LineReader reader(this->socketFd);
+		string line;
+		int answered = 0;
+		while(answered < this->queries and reader.readLine(line))
+		{
+			double now = omp_get_wtime();
+			size_t pos = 0;
+			int count = 0;
+			while((pos = line.find("\"id\": ", pos)) != string::npos)
+			{
+				pos += 6;
+				int id = atoi(line.c_str() + pos);
+				if(id < 0 or id >= this->queries) continue;
+
+				lock_guard<mutex> lock(this->stateMutex);
+				this->latencies.push_back(now - this->sendTimes[id]);
+				count++;
+			}
+
+			pos = 0;
+			while((pos = line.find("\"found\"", pos)) != string::npos)
+			{
+				this->foundCount++;
+				pos++;
+			}
+
+			answered += count;
+			{
+				lock_guard<mutex> lock(this->stateMutex);
+				this->outstanding -= count;
+			}
+			this->stateChanged.notify_one();
+		}
+
+		// the server is gone (or every answer is in), do not let the sender wait for room
+		{
+			lock_guard<mutex> lock(this->stateMutex);
+			this->connected = false;
+		}
+		this->stateChanged.notify_one();
+	}
+
+	void report(double seconds)
+	{
+		if(this->latencies.size() == 0)
+		{
+			cout << "no answers received." << endl;
+			return;
+		}
+
+		sort(this->latencies.begin(), this->latencies.end());
+		int count = this->latencies.size();
+		cout << "answered " << count << " queries (" << this->foundCount << " paths found) in " << seconds << " secs" << endl;
+		cout << "throughput: " << count / seconds << " queries/sec" << endl;
+		cout << "latency (us): p50 " << 1.0e6 * (*this).percentile(0.50);
+		cout << ", p90 " << 1.0e6 * (*this).percentile(0.90);
+		cout << ", p99 " << 1.0e6 * (*this).percentile(0.99);
+		cout << ", p99.9 " << 1.0e6 * (*this).percentile(0.999);
+		cout << ", max " << 1.0e6 * this->latencies.back() << endl;
+	}
+
+	double percentile(double fraction)
+	{
+		int index = (int) (fraction * (this->latencies.size() - 1));
+		return this->latencies[index];
+	}
+};
+
+#endif
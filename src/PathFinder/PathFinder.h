@@ -7,9 +7,32 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <set>
+#include <list>
+#include <unordered_map>
 #include <limits>
+#include <climits>
 #include <random>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <cfloat>
+#include <cmath>
 #include <omp.h>
+#include <deque>
+#include <queue>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <csignal>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 // include opencv libraries
 #include <opencv2/core.hpp>
@@ -23,6 +46,17 @@
 #define GRID_SIZE 20
 #define OBSTACLES_RATE 0.2
 #define GRID_WALKABLE_COLOR 127
+#define GRID_BORDER_LEFT 0
+#define GRID_BORDER_RIGHT 1
+#define GRID_BORDER_TOP 2
+#define GRID_BORDER_BOTTOM 3
+#define GRID_LAYOUT_ROWS 0
+#define GRID_LAYOUT_TILED 1
+#define GRID_LAYOUT_MORTON 2
+#define GRID_TILE_SIZE 8
+#define GRID_MORTON_TILE_SIZE 64
+#define GRID_JOURNAL_TILE_SIZE 64
+#define GRID_JOURNAL_SIZE 1024
 
 // canvas
 #define CANVAS_WIDTH 800
@@ -47,12 +81,133 @@
 #define DRAW_CLOSED_SET true
 #define ALLOW_DIAGONAL_MOVEMENT true
 
+// path results
+#define PATH_CELLS 0
+#define PATH_WAYPOINTS 1
+#define PATH_RUN_LENGTH 2
+
+// synthetic maps
+#define MAP_UNIFORM 0
+#define MAP_MAZE 1
+#define MAP_ROOMS 2
+#define MAP_POROUS 3
+#define MAP_DEFAULT_SEED 1
+#define MAP_MAX_ROOMS 100000
+
+// heuristics and step costs
+#define HEURISTIC_AUTO -1
+#define HEURISTIC_EUCLIDEAN 0
+#define HEURISTIC_OCTILE 1
+#define HEURISTIC_MANHATTAN 2
+#define HEURISTIC_CHEBYSHEV 3
+#define COST_EUCLIDEAN 0
+#define COST_OCTILE_INT 1
+#define OCTILE_STRAIGHT_COST 10000
+#define OCTILE_DIAGONAL_COST 14142
+
+// search status
+#define SEARCH_IN_PROGRESS -1
+#define SEARCH_FOUND 0
+#define SEARCH_NO_PATH 1
+#define SEARCH_EXPANSION_LIMIT 2
+#define SEARCH_COST_LIMIT 3
+#define SEARCH_BOX_LIMIT 4
+#define SEARCH_DEADLINE 5
+#define SEARCH_MEMORY_LIMIT 6
+
+// sparse search state
+#define SPARSE_TABLE_MIN_SIZE 256
+#define STEP_CLOCK_INTERVAL 16
+
+// low-memory search
+#define IDA_MEMORY_CAP (1 << 16)
+#define IDA_TABLE_WAYS 4
+#define IDA_TABLE_MIN_ENTRIES 256
+
+// bit-parallel breadth-first search
+#define BFS_PARALLEL_MIN_WORDS 4096
+
+// path cache
+#define PATH_CACHE_SIZE 1024
+
+// query server
+#define LOADGEN_SEED 12345
+#define ENGINE_ASTAR 0
+#define ENGINE_IDA 1
+
+// coarse-to-fine search
+#define PYRAMID_LEVELS 4
+#define PYRAMID_CORRIDOR_WIDTH 2
+
+// clearance map
+#define CLEARANCE_MAX 65535
+
+// grid snapshots
+#define SNAPSHOT_TILE_SIZE 64
+#define SNAPSHOT_MAX_READERS 64
+#define SNAPSHOT_IDLE UINT64_MAX
+
+// dead-end pockets
+#define DEAD_END_BLOCK_SIZE 2
+#define DEAD_END_FILE_MAGIC 0x44454D31
+#define DEAD_END_FILE_VERSION 1
+
+// block A*
+#define LDDB_BLOCK_SIZE 8
+#define LDDB_UNREACHABLE 0xFFFF
+
+// quadtree search
+#define QUADTREE_NO_PARENT -1
+#define QUADTREE_START -2
+
+// first-move table
+#define FIRST_MOVE_ORDER_DFS 0
+#define FIRST_MOVE_ORDER_ROWS 1
+#define FIRST_MOVE_NONE 255
+#define FIRST_MOVE_FILE_MAGIC 0x464D5431
+#define FIRST_MOVE_FILE_VERSION 1
+
+// cooperative multi-agent search
+#define RESERVATION_TABLE_MIN_SIZE 1024
+#define RESERVATION_EMPTY_KEY UINT64_MAX
+#define WHCA_WINDOW 16
+#define WHCA_WAIT_COST 1.0
+#define WHCA_HEURISTIC_CELLS (1L << 22)
+
 // include PathFinder lib classes
+#include "mRandom.h"
 #include "mNode.h"
 #include "mGrid.h"
+#include "mMapGenerator.h"
 #include "mHeap.h"
+#include "mPathResult.h"
+#include "mSearchLimits.h"
+#include "mSearchFilter.h"
+#include "mClearanceMap.h"
+#include "mDeadEndMap.h"
+#include "mLocalDistanceDB.h"
+#include "mQuadtree.h"
+#include "mGridStore.h"
+#include "mHeuristic.h"
 #include "Canvas.h"
 #include "AStar.h"
+#include "mBitGrid.h"
+#include "LazyThetaStar.h"
+#include "BitBFS.h"
+#include "SparseAStar.h"
+#include "IDAStar.h"
+#include "BlockAStar.h"
+#include "QuadtreeAStar.h"
+#include "PyramidAStar.h"
+#include "mReservationTable.h"
+#include "CooperativeAStar.h"
+#include "mPathCache.h"
+#include "mFirstMoveTable.h"
+#include "mDistanceMatrix.h"
+#include "PathServer.h"
+#include "LoadGenerator.h"
+#include "mVoxelGrid.h"
+#include "VoxelAStar.h"
 #include "PathFinderApp.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,689 @@
+#ifndef PATH_SERVER_H
+#define PATH_SERVER_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Long-running query server. Grids are loaded once and queries arrive as JSON
+	lines on stdin (answers on stdout) or on a Unix domain socket. Each line is
+	either one query object or an array of queries (a batch, answered by one
+	array line in the same order). Lines are read and queued without waiting
+	for answers (pipelining) and a fixed pool of workers answers them, each
+	worker with its own search engines per grid, so answers may come out of
+	order and carry the query id.
+
+	query:  {"id": 1, "grid": 0, "start": [x, y], "goal": [x, y],
+	         "path": "cells" | "waypoints" | "rle" | "none",
+	         "maxExpansions": n, "maxCost": c, "deadlineMs": t, "size": s,
+	         "engine": "astar" | "ida"}
+	        "size" is the side of a square agent anchored at its top-left cell
+	        (default 1), checked against a mClearanceMap of the grid.
+	        "engine" picks SparseAStar (default) or the memory-capped IDAStar;
+	        queries with another engine name are answered with an error.
+	answer: {"id": 1, "status": "found", "cost": 12.5, "expansions": 40,
+	         "memory": 2048, "micros": 31.0, "path": [[x, y], ...]}
+	        "memory" is the peak search memory of the query in bytes.
+	other:  {"op": "info"} lists the grids, {"op": "shutdown"} stops the server.
+*/
+class PathServer
+{
+public:
+	struct PathQuery
+	{
+		long id;
+		string op;
+		int grid;
+		int startX, startY;
+		int endX, endY;
+		int encoding;
+		bool withPath;
+		long maxExpansions;
+		double maxCost;
+		double deadlineMs;
+		int agentSize;
+		int engine;
+		bool valid;
+	};
+
+	// output side of one client, closed once its reader and every pending job are done
+	struct Connection
+	{
+		int inputFd;
+		int outputFd;
+		bool ownsFd;
+		mutex writeMutex;
+
+		Connection(int _inputFd, int _outputFd, bool _ownsFd) : inputFd(_inputFd), outputFd(_outputFd), ownsFd(_ownsFd) {}
+		~Connection()
+		{
+			if(this->ownsFd) close(this->outputFd);
+		}
+
+		void writeLine(const string &line)
+		{
+			lock_guard<mutex> lock(this->writeMutex);
+			string data = line + "\n";
+			size_t written = 0;
+			while(written < data.size())
+			{
+				ssize_t count = write(this->outputFd, data.data() + written, data.size() - written);
+				if(count <= 0) return;
+				written += count;
+			}
+		}
+	};
+
+	struct ServerJob
+	{
+		shared_ptr<Connection> connection;
+		vector<PathQuery> queries;
+		bool batch;
+	};
+
+	// buffered reader of '\n'-terminated lines from a file descriptor
+	class LineReader
+	{
+	public:
+		int fd;
+		string buffer;
+		size_t position;
+
+		LineReader(int _fd) : fd(_fd), position(0) {}
+
+		bool readLine(string &line)
+		{
+			while(true)
+			{
+				size_t end = this->buffer.find('\n', this->position);
+				if(end != string::npos)
+				{
+					line = this->buffer.substr(this->position, end - this->position);
+					this->position = end + 1;
+					return true;
+				}
+
+				this->buffer.erase(0, this->position);
+				this->position = 0;
+				char chunk[65536];
+				ssize_t count = read(this->fd, chunk, sizeof(chunk));
+				if(count < 0 and errno == EINTR) continue;
+				if(count <= 0)
+				{
+					if(this->buffer.size() == 0) return false;
+					line = this->buffer;
+					this->buffer.clear();
+					return true;
+				}
+				this->buffer.append(chunk, count);
+			}
+		}
+	};
+
+	vector<mGrid *> grids;
+	vector<string> gridNames;
+	vector<mClearanceMap *> clearanceMaps;
+	int workerCount;
+	vector<thread> workers;
+	deque<ServerJob> jobs;
+	mutex jobMutex;
+	condition_variable jobReady;
+	bool stopping;
+	int listenFd;
+	mutex listenMutex;
+	atomic<long> answeredQueries;
+	vector<int> clientFds;
+	vector<thread> readers;
+	vector<thread::id> finishedReaders;
+	mutex clientMutex;
+
+	PathServer(vector<string> &imagePaths, int _workerCount=0) : workerCount(_workerCount),
+																 stopping(false),
+																 listenFd(-1),
+																 answeredQueries(0)
+	{
+		if(this->workerCount <= 0) this->workerCount = max(1, (int) thread::hardware_concurrency());
+		for(int image = 0; image < imagePaths.size(); image++)
+		{
+			cv::Mat matrix = cv::imread(imagePaths[image]);
+			if(matrix.empty())
+			{
+				cerr << "could not read image " << imagePaths[image] << endl;
+				continue;
+			}
+			mGrid *grid = new mGrid(&matrix);
+			if(ALLOW_DIAGONAL_MOVEMENT) grid->setConnectivity(8);
+			this->grids.push_back(grid);
+			this->gridNames.push_back(imagePaths[image]);
+		}
+	}
+
+	PathServer(vector<mGrid *> &_grids, int _workerCount=0) : grids(_grids),
+															 workerCount(_workerCount),
+															 stopping(false),
+															 listenFd(-1),
+															 answeredQueries(0)
+	{
+		if(this->workerCount <= 0) this->workerCount = max(1, (int) thread::hardware_concurrency());
+		this->gridNames.resize(this->grids.size(), "grid");
+	}
+
+	virtual ~PathServer()
+	{
+		(*this).stopWorkers();
+		for(int grid = 0; grid < this->clearanceMaps.size(); grid++)
+		{
+			if(this->clearanceMaps[grid] != NULL)
+			{
+				delete this->clearanceMaps[grid];
+				this->clearanceMaps[grid] = NULL;
+			}
+		}
+		for(int grid = 0; grid < this->grids.size(); grid++)
+		{
+			if(this->grids[grid] != NULL)
+			{
+				delete this->grids[grid];
+				this->grids[grid] = NULL;
+			}
+		}
+	}
+
+	void startWorkers()
+	{
+		// clearance maps are built once, before workers share them read-only
+		for(int grid = this->clearanceMaps.size(); grid < this->grids.size(); grid++)
+			this->clearanceMaps.push_back(new mClearanceMap(this->grids[grid]));
+		this->stopping = false;
+		for(int worker = 0; worker < this->workerCount; worker++)
+			this->workers.push_back(thread(&PathServer::workerLoop, this));
+	}
+
+	void stopWorkers()
+	{
+		{
+			lock_guard<mutex> lock(this->jobMutex);
+			this->stopping = true;
+		}
+		this->jobReady.notify_all();
+		for(int worker = 0; worker < this->workers.size(); worker++)
+		{
+			if(this->workers[worker].joinable()) this->workers[worker].join();
+		}
+		this->workers.clear();
+	}
+
+	// serve queries from stdin and write answers to stdout until end of input
+	void runStdio()
+	{
+		cerr << "serving " << this->grids.size() << " grids on stdin with " << this->workerCount << " workers" << endl;
+		(*this).startWorkers();
+		shared_ptr<Connection> connection(new Connection(0, 1, false));
+		(*this).readQueries(connection);
+		(*this).stopWorkers();
+	}
+
+	// serve queries on a Unix domain socket until a shutdown query arrives
+	void runSocket(string socketPath)
+	{
+		// a client that hangs up fails the write of its answers instead of killing the server
+		signal(SIGPIPE, SIG_IGN);
+		int serverFd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(serverFd < 0)
+		{
+			cout << "could not create socket." << endl;
+			return;
+		}
+
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+		unlink(socketPath.c_str());
+		if(bind(serverFd, (sockaddr *) &address, sizeof(address)) < 0 or listen(serverFd, 64) < 0)
+		{
+			cout << "could not listen on " << socketPath << endl;
+			close(serverFd);
+			return;
+		}
+		{
+			lock_guard<mutex> lock(this->listenMutex);
+			this->listenFd = serverFd;
+		}
+
+		cout << "serving " << this->grids.size() << " grids on " << socketPath << " with " << this->workerCount << " workers" << endl;
+		(*this).startWorkers();
+		while(true)
+		{
+			int clientFd = accept(serverFd, NULL, NULL);
+			if(clientFd < 0)
+			{
+				if(errno == EINTR) continue;
+				break;
+			}
+
+			(*this).joinReaders(false);
+			shared_ptr<Connection> connection(new Connection(clientFd, clientFd, true));
+			lock_guard<mutex> lock(this->clientMutex);
+			this->clientFds.push_back(clientFd);
+			this->readers.push_back(thread(&PathServer::readQueries, this, connection));
+		}
+
+		// only this thread closes the listening socket, after shutdownServer can no longer touch it
+		{
+			lock_guard<mutex> lock(this->listenMutex);
+			this->listenFd = -1;
+		}
+		close(serverFd);
+
+		// unblock the readers of clients that are still connected and wait for them
+		{
+			lock_guard<mutex> lock(this->clientMutex);
+			for(int client = 0; client < this->clientFds.size(); client++)
+				shutdown(this->clientFds[client], SHUT_RD);
+		}
+		(*this).joinReaders(true);
+
+		(*this).stopWorkers();
+		unlink(socketPath.c_str());
+		cout << "server stopped after " << this->answeredQueries << " queries." << endl;
+	}
+
+	// called by reader threads: wakes the accept loop of runSocket, which closes the socket
+	void shutdownServer()
+	{
+		lock_guard<mutex> lock(this->listenMutex);
+		if(this->listenFd >= 0)
+		{
+			shutdown(this->listenFd, SHUT_RDWR);
+			this->listenFd = -1;
+		}
+	}
+
+	void readQueries(shared_ptr<Connection> connection)
+	{
+		(*this).serveConnection(connection);
+		if(connection->ownsFd)
+		{
+			lock_guard<mutex> lock(this->clientMutex);
+			this->clientFds.erase(remove(this->clientFds.begin(), this->clientFds.end(), connection->inputFd), this->clientFds.end());
+			this->finishedReaders.push_back(this_thread::get_id());
+		}
+	}
+
+	// join the reader threads that are done (all of them if 'all'); only the accept loop of runSocket calls it
+	void joinReaders(bool all)
+	{
+		vector<thread> done;
+		{
+			lock_guard<mutex> lock(this->clientMutex);
+			for(int reader = this->readers.size() - 1; reader >= 0; reader--)
+			{
+				vector<thread::id>::iterator finished = find(this->finishedReaders.begin(), this->finishedReaders.end(), this->readers[reader].get_id());
+				if(finished == this->finishedReaders.end())
+				{
+					if(!all) continue;
+				} else
+				{
+					this->finishedReaders.erase(finished);
+				}
+				done.push_back(move(this->readers[reader]));
+				this->readers.erase(this->readers.begin() + reader);
+			}
+		}
+		for(int reader = 0; reader < done.size(); reader++) done[reader].join();
+
+		// readers joined while still running leave their ids behind once they are done
+		if(all)
+		{
+			lock_guard<mutex> lock(this->clientMutex);
+			this->finishedReaders.clear();
+		}
+	}
+
+	void serveConnection(shared_ptr<Connection> connection)
+	{
+		LineReader reader(connection->inputFd);
+		string line;
+		while(reader.readLine(line))
+		{
+			ServerJob job;
+			job.connection = connection;
+			if(!(*this).parseLine(line, job.queries, job.batch))
+			{
+				connection->writeLine("{\"status\": \"error\", \"message\": \"malformed query\"}");
+				continue;
+			}
+
+			// control queries are answered by the reader itself
+			if(!job.batch and job.queries.size() == 1 and job.queries[0].op.size() > 0)
+			{
+				if(job.queries[0].op == "shutdown")
+				{
+					connection->writeLine("{\"status\": \"stopping\"}");
+					(*this).shutdownServer();
+					return;
+				}
+				connection->writeLine((*this).formatInfo());
+				continue;
+			}
+
+			{
+				lock_guard<mutex> lock(this->jobMutex);
+				this->jobs.push_back(job);
+			}
+			this->jobReady.notify_one();
+		}
+	}
+
+	void workerLoop()
+	{
+		// per-worker search contexts, one per grid
+		vector<SparseAStar *> engines(this->grids.size(), (SparseAStar *) NULL);
+		vector<IDAStar *> lowMemoryEngines(this->grids.size(), (IDAStar *) NULL);
+		vector<int> pathBuffer(1024);
+
+		while(true)
+		{
+			ServerJob job;
+			{
+				unique_lock<mutex> lock(this->jobMutex);
+				while(this->jobs.size() == 0 and !this->stopping) this->jobReady.wait(lock);
+				if(this->jobs.size() == 0) break;
+				job = this->jobs.front();
+				this->jobs.pop_front();
+			}
+
+			string answer = job.batch ? "[" : "";
+			for(int query = 0; query < job.queries.size(); query++)
+			{
+				if(query > 0) answer += ", ";
+				answer += (*this).answerQuery(job.queries[query], engines, lowMemoryEngines, pathBuffer);
+			}
+			if(job.batch) answer += "]";
+			job.connection->writeLine(answer);
+			this->answeredQueries += job.queries.size();
+		}
+
+		for(int engine = 0; engine < engines.size(); engine++)
+		{
+			if(engines[engine] != NULL) delete engines[engine];
+			if(lowMemoryEngines[engine] != NULL) delete lowMemoryEngines[engine];
+		}
+	}
+
+	string answerQuery(PathQuery &query, vector<SparseAStar *> &engines, vector<IDAStar *> &lowMemoryEngines, vector<int> &pathBuffer)
+	{
+		char text[256];
+		if(!query.valid or query.grid < 0 or query.grid >= this->grids.size())
+		{
+			snprintf(text, sizeof(text), "{\"id\": %ld, \"status\": \"error\"}", query.id);
+			return string(text);
+		}
+
+		mGrid *grid = this->grids[query.grid];
+		mClearanceMap *clearanceMap = this->clearanceMaps[query.grid];
+		if(query.agentSize < 1 or
+		   !clearanceMap->fits(query.startX, query.startY, query.agentSize) or
+		   !clearanceMap->fits(query.endX, query.endY, query.agentSize))
+		{
+			snprintf(text, sizeof(text), "{\"id\": %ld, \"status\": \"invalid\"}", query.id);
+			return string(text);
+		}
+
+		mSearchLimits limits;
+		limits.setMaxExpansions(query.maxExpansions);
+		limits.setMaxCost(query.maxCost);
+		if(query.deadlineMs >= 0.0) limits.setDeadline(query.deadlineMs * 1.0e-3);
+		mClearanceFilter clearanceFilter(clearanceMap, query.agentSize);
+		mSearchFilter *filter = (query.agentSize > 1) ? &clearanceFilter : NULL;
+
+		double stime = omp_get_wtime();
+		mPathResult result(pathBuffer.data(), pathBuffer.size(), query.encoding);
+		int searchStatus;
+		long expansions, peakMemory;
+		if(query.engine == ENGINE_IDA) (*this).runQuery(lowMemoryEngines, query, limits, filter, pathBuffer, result, searchStatus, expansions, peakMemory);
+		else (*this).runQuery(engines, query, limits, filter, pathBuffer, result, searchStatus, expansions, peakMemory);
+		stime = omp_get_wtime() - stime;
+
+		string status;
+		if(searchStatus == SEARCH_FOUND) status = "found";
+		else if(searchStatus == SEARCH_NO_PATH) status = "no path";
+		else status = "partial: " + mSearchLimits::statusName(searchStatus);
+
+		snprintf(text, sizeof(text), "{\"id\": %ld, \"status\": \"%s\", \"cost\": %.6f, \"expansions\": %ld, \"memory\": %ld, \"micros\": %.1f",
+				 query.id, status.c_str(), result.found ? result.cost : -1.0, expansions, peakMemory, stime * 1.0e6);
+		string answer(text);
+		if(query.withPath and result.found)
+		{
+			answer += ", \"path\": [";
+			for(int entry = 0; entry < result.length; entry++)
+			{
+				if(entry > 0) answer += ", ";
+				if(query.encoding == PATH_RUN_LENGTH and entry > 0)
+					snprintf(text, sizeof(text), "[%d, %d]", result.buffer[entry] >> 24, result.buffer[entry] & 0xFFFFFF);
+				else
+					snprintf(text, sizeof(text), "[%d, %d]", grid->nodes[result.buffer[entry]].x, grid->nodes[result.buffer[entry]].y);
+				answer += text;
+			}
+			answer += "]";
+		}
+		answer += "}";
+		return answer;
+	}
+
+	// run a query on the worker's engine of its grid (created on first use) and extract the whole path
+	template<class Engine>
+	void runQuery(vector<Engine *> &engines, PathQuery &query, mSearchLimits &limits, mSearchFilter *filter, vector<int> &pathBuffer,
+				  mPathResult &result, int &searchStatus, long &expansions, long &peakMemory)
+	{
+		if(engines[query.grid] == NULL)
+		{
+			engines[query.grid] = new Engine(this->grids[query.grid]);
+			engines[query.grid]->setVerbose(false);
+		}
+		Engine *engine = engines[query.grid];
+		engine->setSearchLimits(limits);
+		engine->setSearchFilter(filter);
+		engine->findPath(query.startX, query.startY, query.endX, query.endY);
+		engine->extractPath(result);
+		if(result.truncated)
+		{
+			pathBuffer.resize(result.length);
+			result = mPathResult(pathBuffer.data(), pathBuffer.size(), query.encoding);
+			engine->extractPath(result);
+		}
+		engine->setSearchFilter(NULL);
+		searchStatus = engine->status;
+		expansions = engine->expansions;
+		peakMemory = engine->peakMemory;
+	}
+
+	string formatInfo()
+	{
+		string info = "{\"status\": \"ok\", \"workers\": " + to_string(this->workerCount) + ", \"grids\": [";
+		for(int grid = 0; grid < this->grids.size(); grid++)
+		{
+			if(grid > 0) info += ", ";
+			info += "{\"id\": " + to_string(grid) + ", \"width\": " + to_string(this->grids[grid]->gridDimX);
+			info += ", \"height\": " + to_string(this->grids[grid]->gridDimY) + "}";
+		}
+		return info + "]}";
+	}
+
+	// minimal JSON reader for the flat query objects described above
+	bool parseLine(const string &line, vector<PathQuery> &queries, bool &batch)
+	{
+		size_t pos = 0;
+		(*this).skipSpaces(line, pos);
+		if(pos >= line.size()) return false;
+
+		batch = (line[pos] == '[');
+		if(!batch)
+		{
+			PathQuery query;
+			if(!(*this).parseQuery(line, pos, query)) return false;
+			queries.push_back(query);
+			return true;
+		}
+
+		pos++;
+		while(true)
+		{
+			(*this).skipSpaces(line, pos);
+			if(pos < line.size() and line[pos] == ']') return true;
+			PathQuery query;
+			if(!(*this).parseQuery(line, pos, query)) return false;
+			queries.push_back(query);
+			(*this).skipSpaces(line, pos);
+			if(pos < line.size() and line[pos] == ',') pos++;
+		}
+	}
+
+	bool parseQuery(const string &line, size_t &pos, PathQuery &query)
+	{
+		query.id = -1;
+		query.grid = 0;
+		query.startX = query.startY = query.endX = query.endY = -1;
+		query.encoding = PATH_CELLS;
+		query.withPath = true;
+		query.maxExpansions = -1;
+		query.maxCost = DBL_MAX;
+		query.deadlineMs = -1.0;
+		query.agentSize = 1;
+		query.engine = ENGINE_ASTAR;
+		query.valid = false;
+
+		(*this).skipSpaces(line, pos);
+		if(pos >= line.size() or line[pos] != '{') return false;
+		pos++;
+
+		bool hasStart = false, hasGoal = false, knownEngine = true;
+		while(true)
+		{
+			(*this).skipSpaces(line, pos);
+			if(pos >= line.size()) return false;
+			if(line[pos] == '}')
+			{
+				pos++;
+				break;
+			}
+			if(line[pos] == ',')
+			{
+				pos++;
+				continue;
+			}
+
+			string key, text;
+			vector<double> numbers;
+			if(!(*this).parseString(line, pos, key)) return false;
+			(*this).skipSpaces(line, pos);
+			if(pos >= line.size() or line[pos] != ':') return false;
+			pos++;
+			if(!(*this).parseValue(line, pos, text, numbers)) return false;
+
+			if(key == "id" and numbers.size() == 1) query.id = (long) numbers[0];
+			else if(key == "grid" and numbers.size() == 1) query.grid = (int) numbers[0];
+			else if(key == "op") query.op = text;
+			else if(key == "start" and numbers.size() == 2)
+			{
+				query.startX = (int) numbers[0];
+				query.startY = (int) numbers[1];
+				hasStart = true;
+			}
+			else if(key == "goal" and numbers.size() == 2)
+			{
+				query.endX = (int) numbers[0];
+				query.endY = (int) numbers[1];
+				hasGoal = true;
+			}
+			else if(key == "path")
+			{
+				if(text == "waypoints") query.encoding = PATH_WAYPOINTS;
+				else if(text == "rle") query.encoding = PATH_RUN_LENGTH;
+				else if(text == "none") query.withPath = false;
+			}
+			else if(key == "maxExpansions" and numbers.size() == 1) query.maxExpansions = (long) numbers[0];
+			else if(key == "maxCost" and numbers.size() == 1) query.maxCost = numbers[0];
+			else if(key == "deadlineMs" and numbers.size() == 1) query.deadlineMs = numbers[0];
+			else if(key == "size" and numbers.size() == 1) query.agentSize = (int) numbers[0];
+			else if(key == "engine")
+			{
+				if(text == "ida") query.engine = ENGINE_IDA;
+				else if(text == "astar") query.engine = ENGINE_ASTAR;
+				else knownEngine = false;
+			}
+		}
+
+		query.valid = (hasStart and hasGoal and knownEngine);
+		return true;
+	}
+
+	bool parseValue(const string &line, size_t &pos, string &text, vector<double> &numbers)
+	{
+		(*this).skipSpaces(line, pos);
+		if(pos >= line.size()) return false;
+		if(line[pos] == '"') return (*this).parseString(line, pos, text);
+		if(line[pos] == '[')
+		{
+			pos++;
+			while(true)
+			{
+				(*this).skipSpaces(line, pos);
+				if(pos >= line.size()) return false;
+				if(line[pos] == ']')
+				{
+					pos++;
+					return true;
+				}
+				if(line[pos] == ',')
+				{
+					pos++;
+					continue;
+				}
+				if(!(*this).parseNumber(line, pos, numbers)) return false;
+			}
+		}
+		if(line.compare(pos, 4, "true") == 0 or line.compare(pos, 4, "null") == 0)
+		{
+			pos += 4;
+			return true;
+		}
+		if(line.compare(pos, 5, "false") == 0)
+		{
+			pos += 5;
+			return true;
+		}
+		return (*this).parseNumber(line, pos, numbers);
+	}
+
+	bool parseString(const string &line, size_t &pos, string &text)
+	{
+		if(pos >= line.size() or line[pos] != '"') return false;
+		size_t end = line.find('"', pos + 1);
+		if(end == string::npos) return false;
+		text = line.substr(pos + 1, end - pos - 1);
+		pos = end + 1;
+		return true;
+	}
+
+	bool parseNumber(const string &line, size_t &pos, vector<double> &numbers)
+	{
+		const char *begin = line.c_str() + pos;
+		char *end;
+		double value = strtod(begin, &end);
+		if(end == begin) return false;
+		numbers.push_back(value);
+		pos += end - begin;
+		return true;
+	}
+
+	void skipSpaces(const string &line, size_t &pos)
+	{
+		while(pos < line.size() and isspace((unsigned char) line[pos])) pos++;
+	}
+};
+
+#endif
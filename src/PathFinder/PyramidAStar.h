@@ -0,0 +1,304 @@
+#ifndef PYRAMID_ASTAR_H
+#define PYRAMID_ASTAR_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Coarse-to-fine search over a walkability pyramid. Each level halves the
+	previous one and a coarse cell is walkable only if all of its fine cells
+	are (blocked stays blocked), so a coarse route never crosses a wall. A
+	query first finds a route on the top level, then runs full-resolution
+	SparseAStar restricted to a corridor of 'corridorWidth' coarse cells
+	around that route. If the corridor holds no path (or the coarse search
+	fails, e.g. the passage is narrower than a coarse cell), the query falls
+	back to the unrestricted search. Paths are optimal within the corridor,
+	not necessarily over the whole grid. The levels follow grid edits: a
+	query first downsamples the journal tiles changed since the last one
+	again (or every cell if the journal no longer reaches back that far).
+*/
+class PyramidAStar
+{
+public:
+	mGrid *grid;
+	vector<mGrid *> levels;
+	int corridorWidth;
+	int scale;
+	SparseAStar *coarseSearch;
+	SparseAStar *fineSearch;
+	mCorridorFilter *corridor;
+	vector<int> coarsePath;
+	long gridVersion;
+	int status;
+	bool usedFallback;
+	long expansions;
+	long fallbacks;
+	double coarseTime;
+	double fineTime;
+	bool verbose;
+
+	PyramidAStar(mGrid *_grid, int levelCount=PYRAMID_LEVELS, int _corridorWidth=PYRAMID_CORRIDOR_WIDTH) : grid(_grid),
+																										   corridorWidth(_corridorWidth),
+																										   scale(1),
+																										   status(SEARCH_NO_PATH),
+																										   usedFallback(false),
+																										   expansions(0),
+																										   fallbacks(0),
+																										   coarseTime(0.0),
+																										   fineTime(0.0),
+																										   verbose(true)
+	{
+		(*this).buildPyramid(max(1, levelCount));
+		this->coarseSearch = new SparseAStar(this->levels.back());
+		this->coarseSearch->setVerbose(false);
+		this->fineSearch = new SparseAStar(this->grid);
+		this->fineSearch->setVerbose(false);
+		this->corridor = new mCorridorFilter(this->grid, this->scale);
+		this->coarsePath.resize(1024);
+	}
+
+	PyramidAStar(const PyramidAStar &_other)
+	{
+		this->grid = _other.grid;
+		this->corridorWidth = _other.corridorWidth;
+		this->scale = 1;
+		(*this).buildPyramid(_other.levels.size());
+		this->coarseSearch = new SparseAStar(this->levels.back());
+		this->coarseSearch->setVerbose(false);
+		this->fineSearch = new SparseAStar(this->grid);
+		this->fineSearch->setVerbose(false);
+		this->corridor = new mCorridorFilter(*_other.corridor);
+		this->coarsePath = _other.coarsePath;
+		this->status = _other.status;
+		this->usedFallback = _other.usedFallback;
+		this->expansions = _other.expansions;
+		this->fallbacks = _other.fallbacks;
+		this->coarseTime = _other.coarseTime;
+		this->fineTime = _other.fineTime;
+		this->verbose = _other.verbose;
+	}
+
+	virtual ~PyramidAStar()
+	{
+		delete this->coarseSearch;
+		delete this->fineSearch;
+		delete this->corridor;
+
+		// level 0 is the caller's grid
+		for(int level = 1; level < this->levels.size(); level++)
+		{
+			if(this->levels[level] != NULL)
+			{
+				delete this->levels[level];
+				this->levels[level] = NULL;
+			}
+		}
+	}
+
+	void setVerbose(bool _b)
+	{
+		this->verbose = _b;
+	}
+
+	void setCorridorWidth(int _width)
+	{
+		this->corridorWidth = _width;
+	}
+
+	void buildPyramid(int levelCount)
+	{
+		this->levels.push_back(this->grid);
+		for(int level = 1; level < levelCount; level++)
+		{
+			mGrid *fine = this->levels.back();
+			if(fine->gridDimX < 2 or fine->gridDimY < 2) break;
+
+			mGrid *coarse = new mGrid((fine->gridDimX + 1) / 2, (fine->gridDimY + 1) / 2, true);
+			coarse->setConnectivity(this->grid->connectivity);
+			if(this->grid->layout != GRID_LAYOUT_ROWS) coarse->setLayout(this->grid->layout, this->grid->tileSize);
+			this->levels.push_back(coarse);
+			this->scale *= 2;
+		}
+		(*this).downsample(0, 0, this->grid->gridDimX, this->grid->gridDimY);
+		this->gridVersion = this->grid->version;
+	}
+
+	/*
+		Conservative 2x downsampling of the cells above the grid rectangle
+		[x0, x1) x [y0, y1): a coarse cell is walkable only if all of its fine
+		cells are. The rectangle is halved (rounded outwards) at every level.
+	*/
+	void downsample(int x0, int y0, int x1, int y1)
+	{
+		for(int level = 1; level < this->levels.size(); level++)
+		{
+			mGrid *fine = this->levels[level - 1];
+			mGrid *coarse = this->levels[level];
+			x0 /= 2;
+			y0 /= 2;
+			x1 = min((x1 + 1) / 2, coarse->gridDimX);
+			y1 = min((y1 + 1) / 2, coarse->gridDimY);
+			#pragma omp parallel for
+			for(int y = y0; y < y1; y++)
+			{
+				for(int x = x0; x < x1; x++)
+				{
+					bool walkable = true;
+					for(int fy = 2*y; fy < min(2*y + 2, fine->gridDimY); fy++)
+					{
+						for(int fx = 2*x; fx < min(2*x + 2, fine->gridDimX); fx++)
+							walkable = walkable and fine->getNode(fx, fy)->walkable;
+					}
+					coarse->getNode(x, y)->walkable = walkable;
+				}
+			}
+		}
+	}
+
+	// bring the levels up to date with the grid: downsample the changed journal tiles again, or every cell
+	void update()
+	{
+		for(int level = 1; level < this->levels.size(); level++)
+		{
+			if(this->levels[level]->connectivity != this->grid->connectivity) this->levels[level]->setConnectivity(this->grid->connectivity);
+		}
+		if(this->gridVersion == this->grid->version) return;
+
+		vector<int> tiles;
+		bool opened;
+		if(this->grid->getChanges(this->gridVersion, tiles, opened))
+		{
+			for(int tile = 0; tile < tiles.size(); tile++)
+			{
+				int x0, y0, x1, y1;
+				this->grid->getJournalTileRect(tiles[tile], x0, y0, x1, y1);
+				(*this).downsample(x0, y0, x1, y1);
+			}
+		} else
+		{
+			(*this).downsample(0, 0, this->grid->gridDimX, this->grid->gridDimY);
+		}
+		this->gridVersion = this->grid->version;
+	}
+
+	bool findPath(int startX, int startY, int endX, int endY)
+	{
+		double stime = omp_get_wtime();
+		this->usedFallback = false;
+		this->expansions = 0;
+		this->coarseTime = 0.0;
+		this->fineTime = 0.0;
+		(*this).update();
+
+		bool restricted = (this->levels.size() > 1) and (*this).buildCorridor(startX, startY, endX, endY);
+		this->coarseTime = omp_get_wtime() - stime;
+
+		bool found = false;
+		if(restricted)
+		{
+			this->fineSearch->setSearchFilter(this->corridor);
+			found = this->fineSearch->findPath(startX, startY, endX, endY);
+			this->expansions += this->fineSearch->expansions;
+		}
+
+		// no coarse route, or no path inside the corridor: search the whole grid
+		if(!found and (!restricted or this->fineSearch->status == SEARCH_NO_PATH))
+		{
+			this->usedFallback = true;
+			this->fallbacks++;
+			this->fineSearch->setSearchFilter(NULL);
+			found = this->fineSearch->findPath(startX, startY, endX, endY);
+			this->expansions += this->fineSearch->expansions;
+		}
+
+		this->status = this->fineSearch->status;
+		this->fineTime = omp_get_wtime() - stime - this->coarseTime;
+
+		if(this->verbose)
+		{
+			cout << endl << "search time: " << this->coarseTime + this->fineTime << " secs (coarse " << this->coarseTime << ")" << endl;
+			cout << "expanded nodes: " << this->expansions << ", corridor cells: " << this->corridor->markedCells * this->scale * this->scale;
+			cout << (this->usedFallback ? " (fallback to full search)" : "") << endl;
+			if(found)
+				cout << "path from start to end node was found :)" << endl << "length: " << (*this).getPathCost() << endl;
+			else
+				cout << "no path found :(" << endl;
+		}
+		return found;
+	}
+
+	// route on the top level, widened to a corridor of coarse cells; false if there is no route
+	bool buildCorridor(int startX, int startY, int endX, int endY)
+	{
+		mGrid *top = this->levels.back();
+		int coarseStart = (*this).findCoarseCell(startX / this->scale, startY / this->scale);
+		int coarseEnd = (*this).findCoarseCell(endX / this->scale, endY / this->scale);
+		if(coarseStart < 0 or coarseEnd < 0) return false;
+
+		if(!this->coarseSearch->findPath(top->nodes[coarseStart].x, top->nodes[coarseStart].y, top->nodes[coarseEnd].x, top->nodes[coarseEnd].y))
+		{
+			this->expansions += this->coarseSearch->expansions;
+			return false;
+		}
+		this->expansions += this->coarseSearch->expansions;
+
+		mPathResult route(this->coarsePath.data(), this->coarsePath.size(), PATH_CELLS);
+		this->coarseSearch->extractPath(route);
+		if(route.truncated)
+		{
+			this->coarsePath.resize(route.length);
+			route = mPathResult(this->coarsePath.data(), this->coarsePath.size(), PATH_CELLS);
+			this->coarseSearch->extractPath(route);
+		}
+
+		this->corridor->clear();
+		for(int entry = 0; entry < route.length; entry++)
+			this->corridor->mark(top->nodes[route.buffer[entry]].x, top->nodes[route.buffer[entry]].y, this->corridorWidth);
+
+		// the endpoints' own blocks, which may be blocked on the coarse level
+		this->corridor->mark(startX / this->scale, startY / this->scale, this->corridorWidth);
+		this->corridor->mark(endX / this->scale, endY / this->scale, this->corridorWidth);
+		return true;
+	}
+
+	// walkable top-level cell nearest to (x, y), within the corridor width (-1 if none)
+	int findCoarseCell(int x, int y)
+	{
+		mGrid *top = this->levels.back();
+		for(int radius = 0; radius <= this->corridorWidth; radius++)
+		{
+			for(int cy = max(0, y - radius); cy <= min(top->gridDimY - 1, y + radius); cy++)
+			{
+				for(int cx = max(0, x - radius); cx <= min(top->gridDimX - 1, x + radius); cx++)
+				{
+					if(max(abs(cx - x), abs(cy - y)) != radius) continue;
+					if(top->getNode(cx, cy)->walkable) return top->getNodeIdx(cx, cy);
+				}
+			}
+		}
+		return -1;
+	}
+
+	double getPathCost()
+	{
+		return this->fineSearch->getPathCost();
+	}
+
+	int extractPath(mPathResult &result)
+	{
+		return this->fineSearch->extractPath(result);
+	}
+
+	// bytes of the coarse levels (level 0 is the caller's grid)
+	long memoryUsage()
+	{
+		long bytes = 0;
+		for(int level = 1; level < this->levels.size(); level++)
+			bytes += (long) this->levels[level]->gridSize * sizeof(mNode);
+		return bytes + (long) this->corridor->marks.size();
+	}
+};
+
+#endif
@@ -0,0 +1,363 @@
+#ifndef QUADTREE_ASTAR_H
+#define QUADTREE_ASTAR_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	A* over the free leaves of a mQuadtree. Search states are the perimeter
+	cells of free leaves: a path only changes leaves with a single step
+	between two perimeter cells, and crosses a free leaf on a straight octile
+	line, so the search is exact with two kinds of edges:
+	  - a step from a perimeter cell to a neighboring cell of another free
+	    leaf (found by a descent from the root),
+	  - from a cell entered from another leaf, the octile distance to every
+	    portal cell of its own leaf (a cell entered from inside its leaf can
+	    skip them, the triangle inequality holds inside the square).
+	The start and goal cells may lie inside their leaves; they are joined
+	to the portals of their leaf the same way. The search stops once no open
+	state can beat the best start-to-goal length. The cell-level path is
+	refined by drawing the octile line between consecutive states. The
+	per-state arrays are allocated once for all queries and reset lazily with
+	a query stamp. Search filters and bounding boxes are not supported.
+	Every query first brings the tree up to date with its grid (see
+	mQuadtree::update); a tree shared by several threads is updated by its
+	owner before concurrent queries, which then only compare versions.
+*/
+class QuadtreeAStar
+{
+public:
+	struct QueueEntry
+	{
+		double fValue;
+		double gValue;
+		long state;
+
+		bool operator<(const QueueEntry &other) const
+		{
+			return this->fValue > other.fValue;
+		}
+	};
+
+	mQuadtree *tree;
+	vector<double> gValues;
+	vector<long> parents;
+	vector<uint32_t> stamps;
+	uint32_t stamp;
+	vector<QueueEntry> openSet;
+	vector<int> path;
+	int startX;
+	int startY;
+	int endX;
+	int endY;
+	int startLeaf;
+	int goalLeaf;
+	long goalParent;
+	double bestLength;
+	int status;
+	mSearchLimits limits;
+	mHeuristic heuristic;
+	long expansions;
+	long touched;
+	double searchTime;
+	bool verbose;
+
+	QuadtreeAStar(mQuadtree *_tree) : tree(_tree),
+									  stamp(0),
+									  startX(0),
+									  startY(0),
+									  endX(0),
+									  endY(0),
+									  startLeaf(-1),
+									  goalLeaf(-1),
+									  goalParent(QUADTREE_NO_PARENT),
+									  bestLength(DBL_MAX),
+									  status(SEARCH_NO_PATH),
+									  expansions(0),
+									  touched(0),
+									  searchTime(0.0),
+									  verbose(true)
+	{}
+
+	QuadtreeAStar(const QuadtreeAStar &_other)
+	{
+		this->tree = _other.tree;
+		this->gValues = _other.gValues;
+		this->parents = _other.parents;
+		this->stamps = _other.stamps;
+		this->stamp = _other.stamp;
+		this->openSet = _other.openSet;
+		this->path = _other.path;
+		this->startX = _other.startX;
+		this->startY = _other.startY;
+		this->endX = _other.endX;
+		this->endY = _other.endY;
+		this->startLeaf = _other.startLeaf;
+		this->goalLeaf = _other.goalLeaf;
+		this->goalParent = _other.goalParent;
+		this->bestLength = _other.bestLength;
+		this->status = _other.status;
+		this->limits = _other.limits;
+		this->heuristic = _other.heuristic;
+		this->expansions = _other.expansions;
+		this->touched = _other.touched;
+		this->searchTime = _other.searchTime;
+		this->verbose = _other.verbose;
+	}
+
+	virtual ~QuadtreeAStar(){}
+
+	void setVerbose(bool _b)
+	{
+		this->verbose = _b;
+	}
+
+	// expansion limits count perimeter cells; the bounding box is ignored
+	void setSearchLimits(mSearchLimits &_limits)
+	{
+		this->limits = _limits;
+	}
+
+	void setHeuristic(int kind)
+	{
+		this->heuristic.setKind(kind);
+	}
+
+	void setCostMode(int mode)
+	{
+		this->heuristic.setCostMode(mode);
+	}
+
+	// length of the octile line between two cells of one free leaf
+	double getLineCost(int x0, int y0, int x1, int y1)
+	{
+		int dx = abs(x1 - x0);
+		int dy = abs(y1 - y0);
+		if(this->tree->connectivity == 4) return (dx + dy) * this->heuristic.straightCost;
+		return (max(dx, dy) - min(dx, dy)) * this->heuristic.straightCost + min(dx, dy) * this->heuristic.diagonalCost;
+	}
+
+	double heuristicFunction(int x, int y)
+	{
+		return this->heuristic.estimate(x - this->endX, y - this->endY, this->tree->connectivity);
+	}
+
+	// free leaf slot of a global perimeter state
+	int getSlot(long state)
+	{
+		return upper_bound(this->tree->boundaryOffsets.begin(), this->tree->boundaryOffsets.end(), state) - this->tree->boundaryOffsets.begin() - 1;
+	}
+
+	void getStateCell(long state, int &x, int &y)
+	{
+		int slot = (*this).getSlot(state);
+		this->tree->getPerimeterCell(this->tree->nodes[this->tree->freeLeaves[slot]], state - this->tree->boundaryOffsets[slot], x, y);
+	}
+
+	bool findPath(int _startX, int _startY, int _endX, int _endY)
+	{
+		double stime = omp_get_wtime();
+		this->tree->update();
+		this->startX = _startX;
+		this->startY = _startY;
+		this->endX = _endX;
+		this->endY = _endY;
+		this->openSet.clear();
+		this->path.clear();
+		this->goalParent = QUADTREE_NO_PARENT;
+		this->bestLength = DBL_MAX;
+		this->expansions = 0;
+		this->touched = 0;
+		this->status = SEARCH_NO_PATH;
+		this->startLeaf = this->tree->findLeaf(_startX, _startY);
+		this->goalLeaf = this->tree->findLeaf(_endX, _endY);
+		if(this->startLeaf < 0 or this->goalLeaf < 0 or !this->tree->nodes[this->startLeaf].walkable or !this->tree->nodes[this->goalLeaf].walkable)
+		{
+			if(this->verbose) cout << "start and/or end nodes are not walkable." << endl;
+			this->searchTime = omp_get_wtime() - stime;
+			return false;
+		}
+
+		// state arrays cover every perimeter cell; a new stamp empties them
+		long stateCount = this->tree->boundaryOffsets.back();
+		if(this->gValues.size() != stateCount)
+		{
+			this->gValues.assign(stateCount, DBL_MAX);
+			this->parents.assign(stateCount, QUADTREE_NO_PARENT);
+			this->stamps.assign(stateCount, 0);
+			this->stamp = 0;
+		}
+		this->stamp++;
+
+		if(this->startLeaf == this->goalLeaf)
+		{
+			this->bestLength = (*this).getLineCost(_startX, _startY, _endX, _endY);
+			this->goalParent = QUADTREE_START;
+		}
+		(*this).relaxPortals(this->startLeaf, _startX, _startY, 0.0, QUADTREE_START);
+
+		while(this->openSet.size() > 0)
+		{
+			pop_heap(this->openSet.begin(), this->openSet.end());
+			QueueEntry current = this->openSet.back();
+			this->openSet.pop_back();
+			if(current.gValue > this->gValues[current.state]) continue;
+			if(current.fValue >= this->bestLength - 1.0e-9 * max(1.0, this->bestLength)) break;
+			int limitStatus = this->limits.check(this->expansions, this->heuristic.toLength(current.fValue), stime);
+			if(limitStatus != SEARCH_IN_PROGRESS)
+			{
+				this->status = limitStatus;
+				break;
+			}
+			(*this).expand(current.state);
+		}
+		if(this->status == SEARCH_NO_PATH and this->goalParent != QUADTREE_NO_PARENT)
+		{
+			this->status = SEARCH_FOUND;
+			(*this).buildPath();
+		}
+		this->searchTime = omp_get_wtime() - stime;
+
+		if(this->verbose)
+		{
+			cout << endl << "search time: " << this->searchTime << " secs" << endl;
+			cout << "expanded perimeter cells: " << this->expansions << ", touched: " << this->touched << endl;
+			if(this->status == SEARCH_FOUND)
+				cout << "path from start to end node was found :)" << endl << "length: " << (*this).getPathCost() << endl;
+			else if(this->status == SEARCH_NO_PATH)
+				cout << "no path found :(" << endl;
+			else
+				cout << "search stopped by " << mSearchLimits::statusName(this->status) << endl;
+		}
+		return (this->status == SEARCH_FOUND);
+	}
+
+	void relax(long state, int x, int y, double gValue, long parent)
+	{
+		if(this->stamps[state] == this->stamp and gValue >= this->gValues[state]) return;
+		if(this->stamps[state] != this->stamp) this->touched++;
+		this->stamps[state] = this->stamp;
+		this->gValues[state] = gValue;
+		this->parents[state] = parent;
+		QueueEntry entry = {gValue + (*this).heuristicFunction(x, y), gValue, state};
+		this->openSet.push_back(entry);
+		push_heap(this->openSet.begin(), this->openSet.end());
+	}
+
+	// octile lines from a cell of a free leaf to every portal of that leaf
+	void relaxPortals(int leafIndex, int x, int y, double gValue, long parent)
+	{
+		mQuadtree::Node &leaf = this->tree->nodes[leafIndex];
+		int slot = this->tree->leafSlot[leafIndex];
+		long offset = this->tree->boundaryOffsets[slot];
+		for(long portal = this->tree->portalOffsets[slot]; portal < this->tree->portalOffsets[slot + 1]; portal++)
+		{
+			int position = this->tree->portalPositions[portal];
+			if(offset + position == parent) continue;
+			int px, py;
+			this->tree->getPerimeterCell(leaf, position, px, py);
+			(*this).relax(offset + position, px, py, gValue + (*this).getLineCost(x, y, px, py), parent);
+		}
+	}
+
+	void expand(long state)
+	{
+		static const int offsetX[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+		static const int offsetY[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+		this->expansions++;
+		int slot = (*this).getSlot(state);
+		int leafIndex = this->tree->freeLeaves[slot];
+		mQuadtree::Node &leaf = this->tree->nodes[leafIndex];
+		int x, y;
+		this->tree->getPerimeterCell(leaf, state - this->tree->boundaryOffsets[slot], x, y);
+		double gValue = this->gValues[state];
+
+		if(leafIndex == this->goalLeaf)
+		{
+			double length = gValue + (*this).getLineCost(x, y, this->endX, this->endY);
+			if(length < this->bestLength)
+			{
+				this->bestLength = length;
+				this->goalParent = state;
+			}
+		}
+
+		// entered from another leaf: cross this one
+		long parent = this->parents[state];
+		bool fromInside = (parent == QUADTREE_START) ? (leafIndex == this->startLeaf) : ((*this).getSlot(parent) == slot);
+		if(!fromInside) (*this).relaxPortals(leafIndex, x, y, gValue, state);
+
+		// single steps into the neighboring free leaves; neighbors often share a leaf, so the last one is tried first
+		int neighborLeaf = -1;
+		for(int dir = 0; dir < this->tree->connectivity; dir++)
+		{
+			int nx = x + offsetX[dir];
+			int ny = y + offsetY[dir];
+			if(nx >= leaf.x and nx < leaf.x + leaf.size and ny >= leaf.y and ny < leaf.y + leaf.size) continue;
+			if(neighborLeaf < 0 or !this->tree->contains(neighborLeaf, nx, ny)) neighborLeaf = this->tree->findLeaf(nx, ny);
+			if(neighborLeaf < 0 or !this->tree->nodes[neighborLeaf].walkable) continue;
+			long neighbor = this->tree->boundaryOffsets[this->tree->leafSlot[neighborLeaf]] + this->tree->getPerimeterPosition(this->tree->nodes[neighborLeaf], nx, ny);
+			(*this).relax(neighbor, nx, ny, gValue + this->heuristic.getStepCost(offsetX[dir], offsetY[dir]), state);
+		}
+	}
+
+	// states from the goal back to the start, refined into cells along octile lines
+	void buildPath()
+	{
+		vector<pair<int, int> > waypoints(1, make_pair(this->endX, this->endY));
+		for(long state = this->goalParent; state != QUADTREE_START; state = this->parents[state])
+		{
+			int x, y;
+			(*this).getStateCell(state, x, y);
+			waypoints.push_back(make_pair(x, y));
+		}
+		waypoints.push_back(make_pair(this->startX, this->startY));
+		reverse(waypoints.begin(), waypoints.end());
+
+		int x = this->startX;
+		int y = this->startY;
+		this->path.assign(1, y * this->tree->gridDimX + x);
+		for(int entry = 1; entry < waypoints.size(); entry++)
+		{
+			while(x != waypoints[entry].first or y != waypoints[entry].second)
+			{
+				int dx = (waypoints[entry].first > x) ? 1 : ((waypoints[entry].first < x) ? -1 : 0);
+				int dy = (waypoints[entry].second > y) ? 1 : ((waypoints[entry].second < y) ? -1 : 0);
+				if(this->tree->connectivity == 4 and dx != 0) dy = 0;
+				x += dx;
+				y += dy;
+				this->path.push_back(y * this->tree->gridDimX + x);
+			}
+		}
+	}
+
+	double getPathCost()
+	{
+		if(this->status != SEARCH_FOUND) return -1.0;
+		return this->heuristic.toLength(this->bestLength);
+	}
+
+	// the path as cells of a grid of the same map
+	int extractPath(mGrid *grid, mPathResult &result)
+	{
+		result.setCostMode(this->heuristic.costMode);
+		vector<int> cells(this->path.size());
+		for(int entry = 0; entry < this->path.size(); entry++)
+			cells[entry] = grid->getNodeIdx(this->path[entry] % this->tree->gridDimX, this->path[entry] / this->tree->gridDimX);
+		if(cells.size() == 0)
+		{
+			result.clear();
+			return 0;
+		}
+		return result.assign(grid, cells.data(), cells.size());
+	}
+
+	long memoryUsage()
+	{
+		return (long) (this->gValues.size() * (sizeof(double) + sizeof(long) + sizeof(uint32_t)) + this->openSet.capacity() * sizeof(QueueEntry));
+	}
+};
+
+#endif
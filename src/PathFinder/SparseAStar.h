@@ -0,0 +1,495 @@
+#ifndef SPARSE_ASTAR_H
+#define SPARSE_ASTAR_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	A* whose search state is allocated lazily, only for the cells the query
+	touches. States live in a pool indexed by an open-addressing hash map
+	(cell index -> pool index) and the open set is a binary heap of pool
+	indices, so a short query on a huge grid costs memory proportional to the
+	search, not to the map. The grid is only read for walkability, so several
+	SparseAStar objects can query the same mGrid concurrently.
+*/
+class SparseAStar
+{
+public:
+	struct SearchState
+	{
+		int cell;
+		int parent;
+		double gValue;
+		double hValue;
+		int heapIndex;
+		bool closed;
+	};
+
+	mGrid *grid;
+	vector<SearchState> states;
+	vector<int> table;
+	vector<int> usedSlots;
+	vector<int> openSet;
+	int tableMask;
+	int startIdx;
+	int endIdx;
+	int foundIdx;
+	int bestIdx;
+	int bestState;
+	bool boxRejected;
+	int status;
+	mSearchLimits limits;
+	mSearchFilter *filter;
+	mHeuristic heuristic;
+	int peakOpenSize;
+	long expansions;
+	long peakMemory;
+	double searchTime;
+	double startTime;
+	int steps;
+	double longestStep;
+	bool verbose;
+
+	SparseAStar(mGrid *_grid) : grid(_grid),
+								startIdx(-1),
+								endIdx(-1),
+								foundIdx(-1),
+								bestIdx(-1),
+								bestState(-1),
+								boxRejected(false),
+								status(SEARCH_NO_PATH),
+								filter(NULL),
+								peakOpenSize(0),
+								expansions(0),
+								peakMemory(0),
+								searchTime(0.0),
+								startTime(0.0),
+								steps(0),
+								longestStep(0.0),
+								verbose(true)
+	{
+		this->table.assign(SPARSE_TABLE_MIN_SIZE, -1);
+		this->tableMask = SPARSE_TABLE_MIN_SIZE - 1;
+	}
+
+	SparseAStar(const SparseAStar &_other)
+	{
+		this->grid = _other.grid;
+		this->states = _other.states;
+		this->table = _other.table;
+		this->usedSlots = _other.usedSlots;
+		this->openSet = _other.openSet;
+		this->tableMask = _other.tableMask;
+		this->startIdx = _other.startIdx;
+		this->endIdx = _other.endIdx;
+		this->foundIdx = _other.foundIdx;
+		this->bestIdx = _other.bestIdx;
+		this->bestState = _other.bestState;
+		this->boxRejected = _other.boxRejected;
+		this->status = _other.status;
+		this->limits = _other.limits;
+		this->filter = _other.filter;
+		this->heuristic = _other.heuristic;
+		this->peakOpenSize = _other.peakOpenSize;
+		this->expansions = _other.expansions;
+		this->peakMemory = _other.peakMemory;
+		this->searchTime = _other.searchTime;
+		this->startTime = _other.startTime;
+		this->steps = _other.steps;
+		this->longestStep = _other.longestStep;
+		this->verbose = _other.verbose;
+	}
+
+	virtual ~SparseAStar(){}
+
+	void setVerbose(bool _b)
+	{
+		this->verbose = _b;
+	}
+
+	void setSearchLimits(mSearchLimits &_limits)
+	{
+		this->limits = _limits;
+	}
+
+	void setHeuristic(int kind)
+	{
+		this->heuristic.setKind(kind);
+	}
+
+	void setCostMode(int mode)
+	{
+		this->heuristic.setCostMode(mode);
+	}
+
+	// cells the filter rejects are never entered (NULL: no filter)
+	void setSearchFilter(mSearchFilter *_filter)
+	{
+		this->filter = _filter;
+	}
+
+	bool findPath(int startX, int startY, int endX, int endY)
+	{
+		if(!(*this).begin(startX, startY, endX, endY)) return false;
+		(*this).step(0);
+		return (this->foundIdx >= 0);
+	}
+
+	/*
+		Time-sliced search: begin() sets up a query and step() expands at most
+		'maxExpansions' nodes and runs for at most 'maxMicros' microseconds
+		(0: no bound), keeping the open set and closed states for the next
+		call. Slices together do the same expansions as one findPath(); query
+		limits still count from begin(). Each SparseAStar holds one query, so
+		many queries interleave on one thread with one object per query.
+	*/
+	bool begin(int startX, int startY, int endX, int endY)
+	{
+		this->startIdx = this->grid->getNodeIdx(startX, startY);
+		this->endIdx = this->grid->getNodeIdx(endX, endY);
+		this->foundIdx = -1;
+		this->bestIdx = -1;
+		this->bestState = -1;
+		this->boxRejected = false;
+		this->searchTime = 0.0;
+		this->steps = 0;
+		this->longestStep = 0.0;
+		this->status = SEARCH_NO_PATH;
+		if(!this->grid->nodes[this->startIdx].walkable or !this->grid->nodes[this->endIdx].walkable)
+		{
+			if(this->verbose) cout << "start and/or end nodes are not walkable." << endl;
+			return false;
+		}
+
+		this->startTime = omp_get_wtime();
+		(*this).resetSearch();
+
+		int first = (*this).getState(this->startIdx);
+		this->states[first].gValue = 0.0;
+		this->states[first].hValue = (*this).heuristicFunction(this->startIdx);
+		(*this).heapAdd(first);
+		this->status = SEARCH_IN_PROGRESS;
+		return true;
+	}
+
+	// returns the status: SEARCH_IN_PROGRESS until the query is finished
+	int step(long maxExpansions, double maxMicros=0.0)
+	{
+		if(this->status != SEARCH_IN_PROGRESS) return this->status;
+
+		double stime = omp_get_wtime();
+		double deadline = (maxMicros > 0.0) ? stime + maxMicros * 1.0e-6 : DBL_MAX;
+		long stepExpansions = 0;
+		int neighbors[8];
+		while(this->openSet.size() > 0)
+		{
+			// end of the slice (the clock is read every STEP_CLOCK_INTERVAL expansions)
+			if(maxExpansions > 0 and stepExpansions >= maxExpansions) break;
+			if(deadline < DBL_MAX and stepExpansions % STEP_CLOCK_INTERVAL == 0 and stepExpansions > 0 and omp_get_wtime() >= deadline) break;
+
+			// Stop as soon as a query limit is hit
+			SearchState &top = this->states[this->openSet[0]];
+			int limitStatus = this->limits.check(this->expansions, this->heuristic.toLength(top.gValue + top.hValue), this->startTime);
+			if(limitStatus != SEARCH_IN_PROGRESS)
+			{
+				this->status = limitStatus;
+				break;
+			}
+
+			int current = (*this).heapRemove();
+			this->states[current].closed = true;
+			this->expansions++;
+			stepExpansions++;
+			if(this->bestState < 0 or this->states[current].hValue < this->states[this->bestState].hValue) this->bestState = current;
+
+			int currentCell = this->states[current].cell;
+			if(currentCell == this->endIdx)
+			{
+				this->foundIdx = currentCell;
+				this->status = SEARCH_FOUND;
+				break;
+			}
+
+			int count = (*this).getConnectedNeighbors(currentCell, neighbors);
+			double currentGValue = this->states[current].gValue;
+			for(int node = 0; node < count; node++)
+			{
+				// cells outside the query bounding box are never entered
+				if(this->limits.useBox and !this->limits.insideBox(this->grid->nodes[neighbors[node]].x, this->grid->nodes[neighbors[node]].y))
+				{
+					this->boxRejected = true;
+					continue;
+				}
+				if(this->filter != NULL and !this->filter->allows(neighbors[node])) continue;
+
+				int neighbor = (*this).getState(neighbors[node]);
+				if(this->states[neighbor].closed) continue;
+
+				double newGValue = currentGValue + (*this).getStepCost(currentCell, neighbors[node]);
+				if(newGValue < this->states[neighbor].gValue)
+				{
+					this->states[neighbor].gValue = newGValue;
+					this->states[neighbor].parent = currentCell;
+					if(this->states[neighbor].heapIndex < 0)
+					{
+						this->states[neighbor].hValue = (*this).heuristicFunction(neighbors[node]);
+						(*this).heapAdd(neighbor);
+					}
+					else
+						(*this).heapSortUp(this->states[neighbor].heapIndex);
+				}
+			}
+		}
+		if(this->status == SEARCH_IN_PROGRESS and this->openSet.size() == 0) this->status = SEARCH_NO_PATH;
+
+		stime = omp_get_wtime() - stime;
+		this->searchTime += stime;
+		this->longestStep = max(this->longestStep, stime);
+		this->steps++;
+		if(this->status != SEARCH_IN_PROGRESS) (*this).finish();
+		return this->status;
+	}
+
+	int getStatus()
+	{
+		return this->status;
+	}
+
+	void finish()
+	{
+		if(this->status == SEARCH_NO_PATH and this->boxRejected) this->status = SEARCH_BOX_LIMIT;
+		if(this->bestState >= 0) this->bestIdx = this->states[this->bestState].cell;
+		this->peakMemory = (*this).memoryUsage();
+
+		if(this->verbose)
+		{
+			cout << endl << "search time: " << this->searchTime << " secs";
+			if(this->steps > 1) cout << " in " << this->steps << " steps (longest " << this->longestStep << " secs)";
+			cout << endl << "expanded nodes: " << this->expansions << ", touched nodes: " << this->states.size();
+			cout << ", peak memory: " << this->peakMemory << " bytes" << endl;
+			if(this->status == SEARCH_FOUND)
+				cout << "path from start to end node was found :)" << endl << "length: " << (*this).getPathCost() << endl;
+			else if(this->status == SEARCH_NO_PATH)
+				cout << "no path found :(" << endl;
+			else
+				cout << "search stopped by " << mSearchLimits::statusName(this->status) << ", partial path cost: " << (*this).getPathCost() << endl;
+		}
+	}
+
+	// last cell of the path: the goal, or the best node of a search stopped by a limit
+	int getPathEnd()
+	{
+		if(this->status == SEARCH_FOUND) return this->foundIdx;
+		if(this->status == SEARCH_NO_PATH) return -1;
+		return this->bestIdx;
+	}
+
+	double getPathCost()
+	{
+		int endCell = (*this).getPathEnd();
+		if(endCell < 0) return -1.0;
+		return this->heuristic.toLength(this->states[(*this).findState(endCell)].gValue);
+	}
+
+	int extractPath(mPathResult &result)
+	{
+		result.setCostMode(this->heuristic.costMode);
+		int endCell = (*this).getPathEnd();
+		if(endCell < 0)
+		{
+			result.clear();
+			return 0;
+		}
+		int entries = result.extractChain(this->grid, endCell, [this](int index) -> int
+		{
+			return this->states[(*this).findState(index)].parent;
+		});
+		result.partial = (this->status != SEARCH_FOUND);
+		return entries;
+	}
+
+	/*
+		Bytes of search state needed by the last query: its pool entries, the
+		hash table sized for them and the largest open set. Buffers keep their
+		capacity between queries, see reservedMemory().
+	*/
+	long memoryUsage()
+	{
+		long tableSize = SPARSE_TABLE_MIN_SIZE;
+		while(tableSize < 2 * (long) this->states.size()) tableSize *= 2;
+		return (long) (this->states.size() * sizeof(SearchState) +
+					   this->states.size() * sizeof(int) +
+					   tableSize * sizeof(int) +
+					   this->peakOpenSize * sizeof(int));
+	}
+
+	long reservedMemory()
+	{
+		return (long) (this->states.capacity() * sizeof(SearchState) +
+					   this->table.capacity() * sizeof(int) +
+					   this->usedSlots.capacity() * sizeof(int) +
+					   this->openSet.capacity() * sizeof(int));
+	}
+
+	void resetSearch()
+	{
+		// only the slots used by the previous query are cleared
+		for(int slot = 0; slot < this->usedSlots.size(); slot++)
+			this->table[this->usedSlots[slot]] = -1;
+		this->usedSlots.clear();
+		this->states.clear();
+		this->openSet.clear();
+		this->peakOpenSize = 0;
+		this->expansions = 0;
+	}
+
+	int hashCell(int cell)
+	{
+		uint32_t h = (uint32_t) cell * 2654435761u;
+		return (int) ((h ^ (h >> 16)) & this->tableMask);
+	}
+
+	int findState(int cell)
+	{
+		int slot = (*this).hashCell(cell);
+		while(this->table[slot] >= 0)
+		{
+			if(this->states[this->table[slot]].cell == cell) return this->table[slot];
+			slot = (slot + 1) & this->tableMask;
+		}
+		return -1;
+	}
+
+	// state of a cell, created on first touch
+	int getState(int cell)
+	{
+		int slot = (*this).hashCell(cell);
+		while(this->table[slot] >= 0)
+		{
+			if(this->states[this->table[slot]].cell == cell) return this->table[slot];
+			slot = (slot + 1) & this->tableMask;
+		}
+
+		SearchState state = {cell, -1, DBL_MAX, DBL_MAX, -1, false};
+		this->states.push_back(state);
+		this->table[slot] = this->states.size() - 1;
+		this->usedSlots.push_back(slot);
+
+		// keep the load factor under 1/2
+		if(2 * this->states.size() > this->table.size()) (*this).growTable();
+		return this->states.size() - 1;
+	}
+
+	void growTable()
+	{
+		this->table.assign(2 * this->table.size(), -1);
+		this->tableMask = this->table.size() - 1;
+		this->usedSlots.clear();
+		for(int state = 0; state < this->states.size(); state++)
+		{
+			int slot = (*this).hashCell(this->states[state].cell);
+			while(this->table[slot] >= 0) slot = (slot + 1) & this->tableMask;
+			this->table[slot] = state;
+			this->usedSlots.push_back(slot);
+		}
+	}
+
+	int getConnectedNeighbors(int cell, int *neighbors)
+	{
+		// same order as mGrid: 4 orthogonal neighbors, then diagonals
+		static const int offsetX[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+		static const int offsetY[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+		int x = this->grid->nodes[cell].x;
+		int y = this->grid->nodes[cell].y;
+		int count = 0;
+		for(int dir = 0; dir < this->grid->connectivity; dir++)
+		{
+			int nx = x + offsetX[dir];
+			int ny = y + offsetY[dir];
+			if(nx < 0 or nx >= this->grid->gridDimX or ny < 0 or ny >= this->grid->gridDimY) continue;
+
+			int index = this->grid->getNodeIdx(nx, ny);
+			if(this->grid->nodes[index].walkable) neighbors[count++] = index;
+		}
+		return count;
+	}
+
+	double getStepCost(int cellA, int cellB)
+	{
+		return this->heuristic.getStepCost(this->grid->nodes[cellA].x - this->grid->nodes[cellB].x,
+										   this->grid->nodes[cellA].y - this->grid->nodes[cellB].y);
+	}
+
+	double heuristicFunction(int cell)
+	{
+		return this->heuristic.estimate(this->grid->nodes[cell].x - this->grid->nodes[this->endIdx].x,
+										this->grid->nodes[cell].y - this->grid->nodes[this->endIdx].y, this->grid->connectivity);
+	}
+
+	// heap over pool indices, ordered like mNode::isGreater (lower f, then lower h)
+	bool heapLess(int stateA, int stateB)
+	{
+		double fA = this->states[stateA].gValue + this->states[stateA].hValue;
+		double fB = this->states[stateB].gValue + this->states[stateB].hValue;
+		if(fA != fB) return fA < fB;
+		return this->states[stateA].hValue < this->states[stateB].hValue;
+	}
+
+	void heapSwap(int idxA, int idxB)
+	{
+		int temp = this->openSet[idxA];
+		this->openSet[idxA] = this->openSet[idxB];
+		this->openSet[idxB] = temp;
+		this->states[this->openSet[idxA]].heapIndex = idxA;
+		this->states[this->openSet[idxB]].heapIndex = idxB;
+	}
+
+	void heapAdd(int state)
+	{
+		this->states[state].heapIndex = this->openSet.size();
+		this->openSet.push_back(state);
+		if(this->openSet.size() > this->peakOpenSize) this->peakOpenSize = this->openSet.size();
+		(*this).heapSortUp(this->openSet.size() - 1);
+	}
+
+	int heapRemove()
+	{
+		int first = this->openSet[0];
+		(*this).heapSwap(0, this->openSet.size() - 1);
+		this->openSet.pop_back();
+		(*this).heapSortDown(0);
+		this->states[first].heapIndex = -1;
+		return first;
+	}
+
+	void heapSortUp(int idx)
+	{
+		while(idx > 0)
+		{
+			int parentIdx = (idx - 1) / 2;
+			if(!(*this).heapLess(this->openSet[idx], this->openSet[parentIdx])) return;
+			(*this).heapSwap(idx, parentIdx);
+			idx = parentIdx;
+		}
+	}
+
+	void heapSortDown(int idx)
+	{
+		int size = this->openSet.size();
+		while(true)
+		{
+			int bestIdx = idx;
+			int leftIdx = 2*idx + 1;
+			int rightIdx = 2*idx + 2;
+			if(leftIdx < size and (*this).heapLess(this->openSet[leftIdx], this->openSet[bestIdx])) bestIdx = leftIdx;
+			if(rightIdx < size and (*this).heapLess(this->openSet[rightIdx], this->openSet[bestIdx])) bestIdx = rightIdx;
+			if(bestIdx == idx) return;
+			(*this).heapSwap(idx, bestIdx);
+			idx = bestIdx;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef VOXEL_ASTAR_H
+#define VOXEL_ASTAR_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	A* over a mVoxelGrid. Follows the same loop as AStar::findPath, but keeps
+	its state in compact arrays indexed by voxel (float g-value, 1 byte parent
+	direction and 1 closed bit per voxel) since one mNode per voxel does not fit
+	in memory for large volumes. The open set is a binary heap with lazy deletion.
+*/
+class VoxelAStar
+{
+public:
+	struct OpenEntry
+	{
+		float fValue;
+		float hValue;
+		long index;
+
+		// same ordering as mNode::isGreater (lower f first, then lower h)
+		bool operator<(const OpenEntry &other) const
+		{
+			if(this->fValue != other.fValue) return this->fValue > other.fValue;
+			return this->hValue > other.hValue;
+		}
+	};
+
+	mVoxelGrid *grid;
+	long startIdx;
+	long endIdx;
+	vector<float> gValues;
+	vector<unsigned char> parentDirs;
+	vector<uint64_t> closedBits;
+	vector<OpenEntry> openSet;
+	vector<long> path;
+	double pathLength;
+	long expansions;
+	double searchTime;
+	bool verbose;
+
+	VoxelAStar(mVoxelGrid *_grid) : grid(_grid),
+									startIdx(-1),
+									endIdx(-1),
+									pathLength(-1.0),
+									expansions(0),
+									searchTime(0.0),
+									verbose(true)
+	{}
+
+	VoxelAStar(const VoxelAStar &_other)
+	{
+		this->grid = _other.grid;
+		this->startIdx = _other.startIdx;
+		this->endIdx = _other.endIdx;
+		this->path = _other.path;
+		this->pathLength = _other.pathLength;
+		this->expansions = _other.expansions;
+		this->searchTime = _other.searchTime;
+		this->verbose = _other.verbose;
+	}
+
+	virtual ~VoxelAStar(){}
+
+	void setVerbose(bool _b)
+	{
+		this->verbose = _b;
+	}
+
+	void setStartNode(int x, int y, int z)
+	{
+		long index = this->grid->getNodeIdx(x, y, z);
+		if(this->grid->isWalkable(index))
+			this->startIdx = index;
+	}
+
+	void setEndNode(int x, int y, int z)
+	{
+		long index = this->grid->getNodeIdx(x, y, z);
+		if(this->grid->isWalkable(index))
+			this->endIdx = index;
+	}
+
+	long memoryUsage()
+	{
+		return (long) (this->gValues.capacity() * sizeof(float) +
+					   this->parentDirs.capacity() * sizeof(unsigned char) +
+					   this->closedBits.capacity() * sizeof(uint64_t) +
+					   this->openSet.capacity() * sizeof(OpenEntry)) + this->grid->memoryUsage();
+	}
+
+	bool findPath()
+	{
+		this->path.clear();
+		this->pathLength = -1.0;
+		this->expansions = 0;
+		if(this->startIdx < 0 or this->endIdx < 0)
+		{
+			cout << "start and/or end voxels not set." << endl;
+			return false;
+		}
+
+		double stime = omp_get_wtime();
+		this->gValues.assign(this->grid->gridSize, FLT_MAX);
+		this->parentDirs.assign(this->grid->gridSize, 255);
+		this->closedBits.assign((this->grid->gridSize + 63) / 64, 0);
+		this->openSet.clear();
+
+		int endX, endY, endZ;
+		this->grid->getNodeCoords(this->endIdx, endX, endY, endZ);
+
+		this->gValues[this->startIdx] = 0.0f;
+		float startH = (float) (*this).heuristicFunction(this->startIdx, endX, endY, endZ);
+		OpenEntry first = {startH, startH, this->startIdx};
+		this->openSet.push_back(first);
+
+		long neighbors[26];
+		int directions[26];
+		bool found = false;
+		while(this->openSet.size() > 0)
+		{
+			pop_heap(this->openSet.begin(), this->openSet.end());
+			OpenEntry current = this->openSet.back();
+			this->openSet.pop_back();
+
+			// skip stale entries left behind by lazy deletion
+			long currentIdx = current.index;
+			if((this->closedBits[currentIdx >> 6] >> (currentIdx & 63)) & 1ULL) continue;
+			this->closedBits[currentIdx >> 6] |= (1ULL << (currentIdx & 63));
+			this->expansions++;
+
+			// Stop if destination voxel is reached
+			if(currentIdx == this->endIdx)
+			{
+				found = true;
+				break;
+			}
+
+			int x, y, z;
+			this->grid->getNodeCoords(currentIdx, x, y, z);
+			float currentGValue = this->gValues[currentIdx];
+			int count = this->grid->getConnectedNeighbors(x, y, z, neighbors, directions);
+			for(int node = 0; node < count; node++)
+			{
+				long neighborIdx = neighbors[node];
+				if((this->closedBits[neighborIdx >> 6] >> (neighborIdx & 63)) & 1ULL) continue;
+
+				float newGValue = currentGValue + (float) this->grid->neighborCosts[directions[node]];
+				if(newGValue < this->gValues[neighborIdx])
+				{
+					this->gValues[neighborIdx] = newGValue;
+					this->parentDirs[neighborIdx] = (unsigned char) directions[node];
+					float hValue = (float) (*this).heuristicFunction(neighborIdx, endX, endY, endZ);
+					OpenEntry entry = {newGValue + hValue, hValue, neighborIdx};
+					this->openSet.push_back(entry);
+					push_heap(this->openSet.begin(), this->openSet.end());
+				}
+			}
+		}
+
+		if(found) (*this).buildPath();
+		stime = omp_get_wtime() - stime;
+		this->searchTime = stime;
+
+		if(this->verbose)
+		{
+			cout << endl << "search time: " << stime << " secs" << endl;
+			cout << "expanded voxels: " << this->expansions << endl;
+			if(found)
+				cout << "path from start to end voxel was found :)" << endl << "length: " << this->pathLength << endl;
+			else
+				cout << "no path found :(" << endl;
+		}
+
+		return found;
+	}
+
+	void buildPath()
+	{
+		this->pathLength = this->gValues[this->endIdx];
+		long currentIdx = this->endIdx;
+		while(true)
+		{
+			this->path.push_back(currentIdx);
+			int dir = this->parentDirs[currentIdx];
+			if(dir == 255) break;
+
+			int x, y, z;
+			this->grid->getNodeCoords(currentIdx, x, y, z);
+			currentIdx = this->grid->getNodeIdx(x - this->grid->neighborOffsets[dir][0],
+												y - this->grid->neighborOffsets[dir][1],
+												z - this->grid->neighborOffsets[dir][2]);
+		}
+		reverse(this->path.begin(), this->path.end());
+	}
+
+	// admissible distance for the grid connectivity (6: Manhattan, 18 and 26: diagonal)
+	double heuristicFunction(long index, int endX, int endY, int endZ)
+	{
+		int x, y, z;
+		this->grid->getNodeCoords(index, x, y, z);
+		int d[3] = {abs(x - endX), abs(y - endY), abs(z - endZ)};
+		sort(d, d + 3);
+
+		if(this->grid->connectivity == 6)
+		{
+			return d[0] + d[1] + d[2];
+		} else
+		if(this->grid->connectivity == 18)
+		{
+			if(d[2] >= d[0] + d[1]) return M_SQRT2 * (d[0] + d[1]) + (d[2] - d[0] - d[1]);
+			int total = d[0] + d[1] + d[2];
+			return M_SQRT2 * (total / 2) + (total % 2);
+		} else
+		{
+			return sqrt(3.0) * d[0] + M_SQRT2 * (d[1] - d[0]) + (d[2] - d[1]);
+		}
+	}
+};
+
+#endif
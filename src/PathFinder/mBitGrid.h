@@ -0,0 +1,201 @@
+#ifndef BITGRID_H
+#define BITGRID_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Packed walkability of a mGrid, 1 bit per cell, stored both by rows and by
+	columns (transposed) so that a run of up to 64 cells along either axis is
+	tested with a single word operation.
+*/
+class mBitGrid
+{
+public:
+	int gridDimX;
+	int gridDimY;
+	int rowWords;
+	int colWords;
+	vector<uint64_t> rowBits;
+	vector<uint64_t> colBits;
+	long losChecks;
+	long wordChecks;
+
+	mBitGrid(mGrid *_grid) : gridDimX(_grid->gridDimX),
+							 gridDimY(_grid->gridDimY),
+							 losChecks(0),
+							 wordChecks(0)
+	{
+		this->rowWords = (this->gridDimX + 63) / 64;
+		this->colWords = (this->gridDimY + 63) / 64;
+		(*this).build(_grid);
+	}
+
+	mBitGrid(const mBitGrid &_other)
+	{
+		this->gridDimX = _other.gridDimX;
+		this->gridDimY = _other.gridDimY;
+		this->rowWords = _other.rowWords;
+		this->colWords = _other.colWords;
+		this->rowBits = _other.rowBits;
+		this->colBits = _other.colBits;
+		this->losChecks = _other.losChecks;
+		this->wordChecks = _other.wordChecks;
+	}
+
+	virtual ~mBitGrid(){}
+
+	void build(mGrid *_grid)
+	{
+		this->rowBits.assign((long) this->rowWords * this->gridDimY, 0);
+		this->colBits.assign((long) this->colWords * this->gridDimX, 0);
+
+		#pragma omp parallel for schedule(static)
+		for(int y = 0; y < this->gridDimY; y++)
+		{
+			uint64_t *row = &this->rowBits[(long) y * this->rowWords];
+			for(int x = 0; x < this->gridDimX; x++)
+			{
+				if(_grid->getNode(x, y)->walkable) row[x >> 6] |= (1ULL << (x & 63));
+			}
+		}
+
+		#pragma omp parallel for schedule(static)
+		for(int x = 0; x < this->gridDimX; x++)
+		{
+			uint64_t *col = &this->colBits[(long) x * this->colWords];
+			for(int y = 0; y < this->gridDimY; y++)
+			{
+				if((this->rowBits[(long) y * this->rowWords + (x >> 6)] >> (x & 63)) & 1ULL)
+					col[y >> 6] |= (1ULL << (y & 63));
+			}
+		}
+	}
+
+	bool isWalkable(int x, int y)
+	{
+		return (this->rowBits[(long) y * this->rowWords + (x >> 6)] >> (x & 63)) & 1ULL;
+	}
+
+	void setWalkable(int x, int y, bool walkable)
+	{
+		uint64_t rowMask = 1ULL << (x & 63);
+		uint64_t colMask = 1ULL << (y & 63);
+		uint64_t &rowWord = this->rowBits[(long) y * this->rowWords + (x >> 6)];
+		uint64_t &colWord = this->colBits[(long) x * this->colWords + (y >> 6)];
+		if(walkable)
+		{
+			rowWord |= rowMask;
+			colWord |= colMask;
+		} else
+		{
+			rowWord &= ~rowMask;
+			colWord &= ~colMask;
+		}
+	}
+
+	// check if every bit in [first, last] of a packed line is set
+	bool isSpanFree(uint64_t *line, int first, int last)
+	{
+		int firstWord = first >> 6;
+		int lastWord = last >> 6;
+		for(int word = firstWord; word <= lastWord; word++)
+		{
+			uint64_t mask = ~0ULL;
+			if(word == firstWord) mask &= ~0ULL << (first & 63);
+			if(word == lastWord) mask &= ~0ULL >> (63 - (last & 63));
+			this->wordChecks++;
+			if((line[word] & mask) != mask) return false;
+		}
+		return true;
+	}
+
+	bool isRowSpanFree(int y, int x0, int x1)
+	{
+		if(x0 > x1) swap(x0, x1);
+		return (*this).isSpanFree(&this->rowBits[(long) y * this->rowWords], x0, x1);
+	}
+
+	bool isColSpanFree(int x, int y0, int y1)
+	{
+		if(y0 > y1) swap(y0, y1);
+		return (*this).isSpanFree(&this->colBits[(long) x * this->colWords], y0, y1);
+	}
+
+	/*
+		Line of sight between two cell centers. Every cell whose interior is
+		crossed by the segment must be walkable (grazing a corner is allowed,
+		like a diagonal move in mGrid). The segment is split into one span per
+		row (or per column, for steep lines), and each span is checked on the
+		packed words.
+	*/
+	bool lineOfSight(int x0, int y0, int x1, int y1)
+	{
+		this->losChecks++;
+		int dx = x1 - x0;
+		int dy = y1 - y0;
+		if(abs(dx) >= abs(dy))
+		{
+			return (*this).sweepLines(x0, y0, x1, y1, true);
+		} else
+		{
+			return (*this).sweepLines(y0, x0, y1, x1, false);
+		}
+	}
+
+	// 'u' is the major axis and 'v' the minor axis of the segment.
+	// Coordinates are doubled so that cell borders lie on integers.
+	bool sweepLines(int u0, int v0, int u1, int v1, bool rows)
+	{
+		if(v0 > v1)
+		{
+			swap(u0, u1);
+			swap(v0, v1);
+		}
+
+		long du = u1 - u0;
+		long dv = v1 - v0;
+		if(dv == 0)
+		{
+			if(rows) return (*this).isRowSpanFree(v0, u0, u1);
+			else return (*this).isColSpanFree(v0, u0, u1);
+		}
+
+		for(int v = v0; v <= v1; v++)
+		{
+			// doubled minor coordinates of the segment piece inside line v
+			long vLow = max(2L * v - 1, 2L * v0);
+			long vHigh = min(2L * v + 1, 2L * v1);
+
+			// doubled major coordinates are uLow/dv and uHigh/dv
+			long uLow = 2L * u0 * dv + (vLow - 2L * v0) * du;
+			long uHigh = 2L * u0 * dv + (vHigh - 2L * v0) * du;
+			if(uLow > uHigh) swap(uLow, uHigh);
+
+			// cells c whose interior (2c-1, 2c+1) overlaps (uLow/dv, uHigh/dv)
+			int first = (int) (floorDiv(uLow - dv, 2 * dv) + 1);
+			int last = (int) (ceilDiv(uHigh + dv, 2 * dv) - 1);
+			bool free;
+			if(rows) free = (*this).isRowSpanFree(v, first, last);
+			else free = (*this).isColSpanFree(v, first, last);
+			if(!free) return false;
+		}
+		return true;
+	}
+
+	static long floorDiv(long a, long b)
+	{
+		long q = a / b;
+		if((a % b != 0) and ((a < 0) != (b < 0))) q--;
+		return q;
+	}
+
+	static long ceilDiv(long a, long b)
+	{
+		return -floorDiv(-a, b);
+	}
+};
+
+#endif
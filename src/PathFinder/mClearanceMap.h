@@ -0,0 +1,257 @@
+#ifndef CLEARANCE_MAP_H
+#define CLEARANCE_MAP_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Clearance of every cell of a mGrid: the side of the largest free square
+	whose top-left cell is that cell (0 for blocked cells). An agent of
+	'size' x 'size' cells anchored at its top-left cell fits on a cell if the
+	clearance is at least 'size', so one map serves every agent size.
+	With r and d the free runs to the right of and below a cell,
+	  clearance(x, y) = min(r(x, y), d(x, y), 1 + clearance(x+1, y+1))
+	Runs are computed in parallel by rows and by columns, then every diagonal
+	is an independent chain, so the whole map is built in linear time.
+	Journaled grid edits are repaired in place (see repair).
+*/
+class mClearanceMap
+{
+public:
+	mGrid *grid;
+	vector<uint16_t> clearance;
+	int maxClearance;
+	long gridVersion;
+	double buildTime;
+
+	mClearanceMap(mGrid *_grid) : grid(_grid),
+								  maxClearance(0),
+								  gridVersion(-1),
+								  buildTime(0.0)
+	{
+		(*this).build();
+	}
+
+	mClearanceMap(const mClearanceMap &_other)
+	{
+		this->grid = _other.grid;
+		this->clearance = _other.clearance;
+		this->maxClearance = _other.maxClearance;
+		this->gridVersion = _other.gridVersion;
+		this->buildTime = _other.buildTime;
+	}
+
+	virtual ~mClearanceMap(){}
+
+	void build()
+	{
+		double stime = omp_get_wtime();
+		int dimX = this->grid->gridDimX;
+		int dimY = this->grid->gridDimY;
+		long size = (long) dimX * dimY;
+
+		// free runs to the right (by rows) and downwards (by columns), row-major
+		vector<uint16_t> right(size), down(size);
+		#pragma omp parallel for schedule(static)
+		for(int y = 0; y < dimY; y++)
+		{
+			int run = 0;
+			for(int x = dimX - 1; x >= 0; x--)
+			{
+				run = this->grid->getNode(x, y)->walkable ? min(run + 1, CLEARANCE_MAX) : 0;
+				right[(long) y * dimX + x] = run;
+			}
+		}
+
+		#pragma omp parallel for schedule(static)
+		for(int x = 0; x < dimX; x++)
+		{
+			int run = 0;
+			for(int y = dimY - 1; y >= 0; y--)
+			{
+				run = (right[(long) y * dimX + x] > 0) ? min(run + 1, CLEARANCE_MAX) : 0;
+				down[(long) y * dimX + x] = run;
+			}
+		}
+
+		// one chain per diagonal, from its bottom-right end; diagonal 'd' starts at (d, 0) or (0, -d)
+		this->clearance.assign(this->grid->gridSize, 0);
+		int maxValue = 0;
+		#pragma omp parallel for schedule(dynamic, 64) reduction(max:maxValue)
+		for(int diagonal = -(dimY - 1); diagonal < dimX; diagonal++)
+		{
+			int x0 = max(diagonal, 0);
+			int y0 = max(-diagonal, 0);
+			int length = min(dimX - x0, dimY - y0);
+			int previous = 0;
+			for(int step = length - 1; step >= 0; step--)
+			{
+				int x = x0 + step;
+				int y = y0 + step;
+				long offset = (long) y * dimX + x;
+				int value = min(min((int) right[offset], (int) down[offset]), previous + 1);
+				this->clearance[this->grid->getNodeIdx(x, y)] = value;
+				maxValue = max(maxValue, value);
+				previous = value;
+			}
+		}
+
+		this->maxClearance = maxValue;
+		this->gridVersion = this->grid->version;
+		this->buildTime = omp_get_wtime() - stime;
+	}
+
+	// bring the map up to date with the grid: repair the changed journal tiles, or rebuild
+	void update()
+	{
+		if(this->gridVersion == this->grid->version) return;
+		vector<int> tiles;
+		bool opened;
+		if(this->gridVersion >= 0 and this->grid->getChanges(this->gridVersion, tiles, opened)) (*this).repair(tiles);
+		else (*this).build();
+	}
+
+	/*
+		The clearance of a cell only depends on the cells to its right and
+		below, through the equivalent recurrence
+		  clearance(x, y) = 1 + min(clearance(x+1, y), clearance(x, y+1), clearance(x+1, y+1))
+		so rows are recomputed from the bottom of the changed tiles upwards.
+		A row visits the cells of its changed tiles and the cells next to a
+		change in the row below, and carries on to the left while its values
+		keep changing; it stops above the tiles once a row changes nothing.
+	*/
+	void repair(vector<int> &tiles)
+	{
+		int dimX = this->grid->gridDimX;
+		int dimY = this->grid->gridDimY;
+		int size = GRID_JOURNAL_TILE_SIZE;
+		int tilesX = this->grid->getJournalTilesX();
+		int bands = (dimY + size - 1) / size;
+		vector<uint8_t> dirty((long) tilesX * bands, 0);
+		vector<int> bandLeft(bands, dimX), bandRight(bands, -1);
+		int top = dimY, bottom = -1;
+		for(int tile = 0; tile < tiles.size(); tile++)
+		{
+			int x0, y0, x1, y1;
+			this->grid->getJournalTileRect(tiles[tile], x0, y0, x1, y1);
+			dirty[tiles[tile]] = 1;
+			bandLeft[y0 / size] = min(bandLeft[y0 / size], x0);
+			bandRight[y0 / size] = max(bandRight[y0 / size], x1 - 1);
+			top = min(top, y0);
+			bottom = max(bottom, y1 - 1);
+		}
+
+		// cells changed in the row below and in the current row, with their spans
+		vector<uint8_t> below(dimX + 1, 0), here(dimX + 1, 0);
+		int belowLeft = dimX, belowRight = -1;
+		int maxValue = this->maxClearance;
+		bool lostMax = false;
+		for(int y = bottom; y >= 0; y--)
+		{
+			int band = y / size;
+			int left = dimX, right = -1;
+			if(belowRight >= 0)
+			{
+				left = max(belowLeft - 1, 0);
+				right = belowRight;
+			}
+			if(bandRight[band] >= 0)
+			{
+				left = min(left, bandLeft[band]);
+				right = max(right, bandRight[band]);
+			}
+			if(right < 0 and y < top) break;
+
+			int hereLeft = dimX, hereRight = -1;
+			for(int x = right; x >= 0 and (x >= left or here[x + 1]); x--)
+			{
+				if(!dirty[band * tilesX + x / size] and !below[x] and !below[x + 1] and !here[x + 1]) continue;
+				int cell = this->grid->getNodeIdx(x, y);
+				int value = 0;
+				if(this->grid->nodes[cell].walkable)
+				{
+					int rightValue = (x + 1 < dimX) ? this->clearance[this->grid->getNodeIdx(x + 1, y)] : 0;
+					int downValue = (y + 1 < dimY) ? this->clearance[this->grid->getNodeIdx(x, y + 1)] : 0;
+					int diagonalValue = (x + 1 < dimX and y + 1 < dimY) ? this->clearance[this->grid->getNodeIdx(x + 1, y + 1)] : 0;
+					value = min(1 + min(min(rightValue, downValue), diagonalValue), CLEARANCE_MAX);
+				}
+				if(value == this->clearance[cell]) continue;
+				if(this->clearance[cell] == this->maxClearance and value < this->maxClearance) lostMax = true;
+				this->clearance[cell] = value;
+				maxValue = max(maxValue, value);
+				here[x] = 1;
+				hereLeft = min(hereLeft, x);
+				hereRight = max(hereRight, x);
+			}
+
+			for(int x = belowLeft; x <= belowRight; x++) below[x] = 0;
+			below.swap(here);
+			belowLeft = hereLeft;
+			belowRight = hereRight;
+		}
+
+		// the largest square may have shrunk
+		if(lostMax and maxValue == this->maxClearance)
+		{
+			maxValue = 0;
+			#pragma omp parallel for reduction(max:maxValue)
+			for(int cell = 0; cell < this->grid->gridSize; cell++) maxValue = max(maxValue, (int) this->clearance[cell]);
+		}
+		this->maxClearance = maxValue;
+		this->gridVersion = this->grid->version;
+	}
+
+	int getClearance(int x, int y)
+	{
+		return this->clearance[this->grid->getNodeIdx(x, y)];
+	}
+
+	bool fits(int x, int y, int size)
+	{
+		if(x < 0 or x >= this->grid->gridDimX or y < 0 or y >= this->grid->gridDimY) return false;
+		return (*this).getClearance(x, y) >= size;
+	}
+
+	long memoryUsage()
+	{
+		return (long) (this->clearance.size() * sizeof(uint16_t));
+	}
+
+	void print()
+	{
+		cout << "clearance map: " << this->grid->gridDimX << "x" << this->grid->gridDimY << ", largest free square " << this->maxClearance;
+		cout << ", built in " << this->buildTime << " secs, " << (*this).memoryUsage() << " bytes" << endl;
+	}
+};
+
+/*
+	Cells where an agent of 'agentSize' x 'agentSize' cells (anchored at its
+	top-left cell) fits, read from a shared mClearanceMap in O(1).
+*/
+class mClearanceFilter : public mSearchFilter
+{
+public:
+	mClearanceMap *clearanceMap;
+	int agentSize;
+
+	mClearanceFilter(mClearanceMap *_clearanceMap, int _agentSize) : clearanceMap(_clearanceMap),
+																	 agentSize(_agentSize)
+	{}
+
+	mClearanceFilter(const mClearanceFilter &_other)
+	{
+		this->clearanceMap = _other.clearanceMap;
+		this->agentSize = _other.agentSize;
+	}
+
+	virtual ~mClearanceFilter(){}
+
+	virtual bool allows(int cell)
+	{
+		return this->clearanceMap->clearance[cell] >= this->agentSize;
+	}
+};
+
+#endif
@@ -0,0 +1,555 @@
+#ifndef DEAD_END_MAP_H
+#define DEAD_END_MAP_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Dead-end pockets of a mGrid. The grid is decomposed into blocks whose
+	walkable cells are all adjacent to each other: single cells on
+	4-connected grids, DEAD_END_BLOCK_SIZE x DEAD_END_BLOCK_SIZE blocks on
+	8-connected ones. A pocket is a set of blocks that the rest of its
+	connected component reaches only through one articulation block, so a
+	shortest path whose start and goal both lie outside the pocket never
+	enters it: it would leave and re-enter the articulation block, and the
+	direct step between those two cells is shorter than any detour.
+	Pockets are the depth-first subtrees cut off by articulation blocks
+	(Tarjan's low-link), so they nest and each one is an interval of the
+	depth-first order: a query only has to keep the pockets that contain its
+	start or goal, which is two interval tests per cell (mDeadEndFilter).
+	Block links are computed in parallel, components are labeled with a
+	parallel union-find and searched in parallel, one depth-first search per
+	component. The map can be saved to and loaded from a binary file next to
+	the grid image.
+*/
+class mDeadEndMap
+{
+public:
+	struct Pocket
+	{
+		int first;
+		int last;
+		int articulation;
+		int parent;
+	};
+
+	struct Frame
+	{
+		int block;
+		int parent;
+		int nextDir;
+	};
+
+	mGrid *grid;
+	int connectivity;
+	int blockSize;
+	int blocksX;
+	int blocksY;
+	vector<uint8_t> links;
+	vector<int> order;
+	vector<int> pocketOf;
+	vector<Pocket> pockets;
+	int componentCount;
+	long pocketCells;
+	int maxDepth;
+	long gridVersion;
+	double buildTime;
+
+	mDeadEndMap(mGrid *_grid) : grid(_grid),
+								connectivity(_grid->connectivity),
+								blockSize(1),
+								blocksX(0),
+								blocksY(0),
+								componentCount(0),
+								pocketCells(0),
+								maxDepth(0),
+								gridVersion(-1),
+								buildTime(0.0)
+	{}
+
+	mDeadEndMap(const mDeadEndMap &_other)
+	{
+		this->grid = _other.grid;
+		this->connectivity = _other.connectivity;
+		this->blockSize = _other.blockSize;
+		this->blocksX = _other.blocksX;
+		this->blocksY = _other.blocksY;
+		this->links = _other.links;
+		this->order = _other.order;
+		this->pocketOf = _other.pocketOf;
+		this->pockets = _other.pockets;
+		this->componentCount = _other.componentCount;
+		this->pocketCells = _other.pocketCells;
+		this->maxDepth = _other.maxDepth;
+		this->gridVersion = _other.gridVersion;
+		this->buildTime = _other.buildTime;
+	}
+
+	virtual ~mDeadEndMap(){}
+
+	static int getOffsetX(int dir)
+	{
+		static const int offsetX[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+		return offsetX[dir];
+	}
+
+	static int getOffsetY(int dir)
+	{
+		static const int offsetY[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+		return offsetY[dir];
+	}
+
+	// directions are indexed like the neighbors of mGrid: 4 orthogonal, then diagonals
+	static int getDirection(int dx, int dy)
+	{
+		for(int dir = 0; dir < 8; dir++)
+		{
+			if(getOffsetX(dir) == dx and getOffsetY(dir) == dy) return dir;
+		}
+		return -1;
+	}
+
+	int getBlock(int cell)
+	{
+		return (this->grid->nodes[cell].y / this->blockSize) * this->blocksX + this->grid->nodes[cell].x / this->blockSize;
+	}
+
+	// linked neighbor block of 'block' in 'dir', -1 if none
+	int getNeighbor(int block, int dir)
+	{
+		if(!((this->links[block] >> dir) & 1)) return -1;
+		return (block / this->blocksX + getOffsetY(dir)) * this->blocksX + block % this->blocksX + getOffsetX(dir);
+	}
+
+	// blocks with a walkable cell adjacent to a walkable cell of the neighbor block (bit per direction)
+	void buildLinks()
+	{
+		this->blocksX = (this->grid->gridDimX + this->blockSize - 1) / this->blockSize;
+		this->blocksY = (this->grid->gridDimY + this->blockSize - 1) / this->blockSize;
+		this->links.assign(this->blocksX * this->blocksY, 0);
+		#pragma omp parallel for schedule(static)
+		for(int by = 0; by < this->blocksY; by++)
+		{
+			for(int bx = 0; bx < this->blocksX; bx++)
+			{
+				uint8_t mask = 0;
+				for(int y = by * this->blockSize; y < min((by + 1) * this->blockSize, this->grid->gridDimY); y++)
+				{
+					for(int x = bx * this->blockSize; x < min((bx + 1) * this->blockSize, this->grid->gridDimX); x++)
+					{
+						if(!this->grid->getNode(x, y)->walkable) continue;
+						for(int dir = 0; dir < this->connectivity; dir++)
+						{
+							int nx = x + getOffsetX(dir);
+							int ny = y + getOffsetY(dir);
+							if(nx < 0 or nx >= this->grid->gridDimX or ny < 0 or ny >= this->grid->gridDimY) continue;
+							if(nx / this->blockSize == bx and ny / this->blockSize == by) continue;
+							if(this->grid->getNode(nx, ny)->walkable) mask |= 1 << getDirection(nx / this->blockSize - bx, ny / this->blockSize - by);
+						}
+					}
+				}
+				this->links[by * this->blocksX + bx] = mask;
+			}
+		}
+	}
+
+	bool hasWalkableCell(int block)
+	{
+		int bx = block % this->blocksX;
+		int by = block / this->blocksX;
+		for(int y = by * this->blockSize; y < min((by + 1) * this->blockSize, this->grid->gridDimY); y++)
+		{
+			for(int x = bx * this->blockSize; x < min((bx + 1) * this->blockSize, this->grid->gridDimX); x++)
+			{
+				if(this->grid->getNode(x, y)->walkable) return true;
+			}
+		}
+		return false;
+	}
+
+	void build()
+	{
+		double stime = omp_get_wtime();
+		this->connectivity = this->grid->connectivity;
+		this->blockSize = (this->connectivity == 8) ? DEAD_END_BLOCK_SIZE : 1;
+		(*this).buildLinks();
+		int size = this->blocksX * this->blocksY;
+		vector<char> walkable(size);
+		#pragma omp parallel for schedule(static)
+		for(int block = 0; block < size; block++) walkable[block] = (*this).hasWalkableCell(block);
+		this->order.assign(size, -1);
+		this->pocketOf.assign(size, -1);
+		this->pockets.clear();
+
+		// components: lock-free union-find, every block linked to its neighbors in parallel
+		vector<atomic<int> > roots(size);
+		#pragma omp parallel for schedule(static)
+		for(int block = 0; block < size; block++) roots[block].store(block);
+		#pragma omp parallel for schedule(static)
+		for(int block = 0; block < size; block++)
+		{
+			for(int dir = 0; dir < this->connectivity; dir++)
+			{
+				int neighbor = (*this).getNeighbor(block, dir);
+				if(neighbor > block) unite(roots, block, neighbor);
+			}
+		}
+
+		// one depth-first search per component, each numbering its blocks from its own offset
+		vector<int> starts;
+		vector<int> offsets;
+		vector<int> sizes(size, 0);
+		for(int block = 0; block < size; block++)
+		{
+			if(walkable[block]) sizes[findRoot(roots, block)]++;
+		}
+		int walkableCount = 0;
+		for(int block = 0; block < size; block++)
+		{
+			if(sizes[block] == 0) continue;
+			starts.push_back(block);
+			offsets.push_back(walkableCount);
+			walkableCount += sizes[block];
+		}
+		this->componentCount = starts.size();
+
+		vector<int> low(size, 0);
+		vector<int> blocks(walkableCount, -1);
+		vector<vector<Pocket> > found(starts.size());
+		int depth = 0;
+		#pragma omp parallel for schedule(dynamic, 1) reduction(max:depth)
+		for(int component = 0; component < starts.size(); component++)
+		{
+			(*this).searchComponent(starts[component], offsets[component], low, blocks, found[component]);
+			depth = max(depth, (*this).assignPockets(found[component], offsets[component], offsets[component] + sizes[starts[component]] - 1, blocks));
+		}
+		this->maxDepth = depth;
+
+		// pocket ids are global: shift the local ids of each component
+		for(int component = 0; component < found.size(); component++)
+		{
+			int shift = this->pockets.size();
+			for(int pocket = 0; pocket < found[component].size(); pocket++)
+			{
+				Pocket entry = found[component][pocket];
+				if(entry.parent >= 0) entry.parent += shift;
+				this->pockets.push_back(entry);
+			}
+			if(shift == 0) continue;
+			for(int ordinal = offsets[component]; ordinal < offsets[component] + sizes[starts[component]]; ordinal++)
+			{
+				if(this->pocketOf[blocks[ordinal]] >= 0) this->pocketOf[blocks[ordinal]] += shift;
+			}
+		}
+
+		(*this).countPocketCells();
+		this->gridVersion = this->grid->version;
+		this->buildTime = omp_get_wtime() - stime;
+	}
+
+	void countPocketCells()
+	{
+		long cells = 0;
+		#pragma omp parallel for reduction(+:cells)
+		for(int cell = 0; cell < this->grid->gridSize; cell++)
+		{
+			if(this->grid->nodes[cell].walkable and this->pocketOf[(*this).getBlock(cell)] >= 0) cells++;
+		}
+		this->pocketCells = cells;
+	}
+
+	// rebuild if the grid was edited since the last build
+	void update()
+	{
+		if(this->gridVersion != this->grid->version) (*this).build();
+	}
+
+	static int findRoot(vector<atomic<int> > &roots, int block)
+	{
+		while(true)
+		{
+			int parent = roots[block].load();
+			if(parent == block) return block;
+			int grandParent = roots[parent].load();
+			if(grandParent != parent) roots[block].compare_exchange_weak(parent, grandParent);
+			block = grandParent;
+		}
+	}
+
+	// the larger root is linked under the smaller one, retried if another thread moved it first
+	static void unite(vector<atomic<int> > &roots, int blockA, int blockB)
+	{
+		while(true)
+		{
+			blockA = findRoot(roots, blockA);
+			blockB = findRoot(roots, blockB);
+			if(blockA == blockB) return;
+			if(blockA < blockB) swap(blockA, blockB);
+			int expected = blockA;
+			if(roots[blockA].compare_exchange_strong(expected, blockB)) return;
+		}
+	}
+
+	/*
+		Iterative Tarjan from 'root': a child v of u whose subtree has no link
+		above u (low[v] >= order[u]) is a pocket hanging off u. Pockets are
+		recorded in post-order with their order interval; the only child of
+		the root would be the whole component but the root, so it is dropped.
+	*/
+	void searchComponent(int root, int offset, vector<int> &low, vector<int> &blocks, vector<Pocket> &found)
+	{
+		vector<Frame> stack;
+		int counter = offset;
+		int rootChildren = 0;
+		Frame first = {root, -1, 0};
+		stack.push_back(first);
+		this->order[root] = low[root] = counter;
+		blocks[counter++] = root;
+		while(stack.size() > 0)
+		{
+			Frame &top = stack.back();
+			if(top.nextDir < this->connectivity)
+			{
+				int neighbor = (*this).getNeighbor(top.block, top.nextDir++);
+				if(neighbor < 0 or neighbor == top.parent) continue;
+				if(this->order[neighbor] >= 0)
+				{
+					low[top.block] = min(low[top.block], this->order[neighbor]);
+					continue;
+				}
+				Frame frame = {neighbor, top.block, 0};
+				this->order[neighbor] = low[neighbor] = counter;
+				blocks[counter++] = neighbor;
+				stack.push_back(frame);
+				continue;
+			}
+
+			int block = top.block;
+			int parent = top.parent;
+			stack.pop_back();
+			if(parent < 0) continue;
+
+			low[parent] = min(low[parent], low[block]);
+			if(parent == root) rootChildren++;
+			if(low[block] >= this->order[parent])
+			{
+				Pocket pocket = {this->order[block], counter - 1, parent, -1};
+				found.push_back(pocket);
+			}
+		}
+		if(rootChildren == 1 and found.size() > 0 and found.back().articulation == root) found.pop_back();
+	}
+
+	/*
+		Innermost pocket of every block of the ordinals [first, last]: the
+		intervals nest, so a sweep with a stack of open pockets (outer ones
+		first) gives each block the pocket on top. Returns the deepest nesting.
+	*/
+	int assignPockets(vector<Pocket> &found, int first, int last, vector<int> &blocks)
+	{
+		vector<int> sorted(found.size());
+		for(int pocket = 0; pocket < found.size(); pocket++) sorted[pocket] = pocket;
+		sort(sorted.begin(), sorted.end(), [&found](int a, int b) -> bool
+		{
+			if(found[a].first != found[b].first) return found[a].first < found[b].first;
+			return found[a].last > found[b].last;
+		});
+
+		vector<int> open;
+		int next = 0;
+		int depth = 0;
+		for(int ordinal = first; ordinal <= last; ordinal++)
+		{
+			while(open.size() > 0 and found[open.back()].last < ordinal) open.pop_back();
+			while(next < sorted.size() and found[sorted[next]].first == ordinal)
+			{
+				found[sorted[next]].parent = (open.size() > 0) ? open.back() : -1;
+				open.push_back(sorted[next++]);
+			}
+			depth = max(depth, (int) open.size());
+			if(open.size() > 0) this->pocketOf[blocks[ordinal]] = open.back();
+		}
+		return depth;
+	}
+
+	// true if the pocket holds the cell (in its own blocks or in a pocket nested in it)
+	bool contains(int pocket, int cell)
+	{
+		int block = (*this).getBlock(cell);
+		return this->order[block] >= this->pockets[pocket].first and this->order[block] <= this->pockets[pocket].last;
+	}
+
+	long memoryUsage()
+	{
+		return (long) ((this->order.size() + this->pocketOf.size()) * sizeof(int) + this->links.size() + this->pockets.size() * sizeof(Pocket));
+	}
+
+	void print()
+	{
+		cout << "dead-end map: " << this->blocksX << "x" << this->blocksY << " blocks of " << this->blockSize << "x" << this->blockSize << ", " << this->componentCount << " components, " << this->pockets.size() << " pockets holding ";
+		cout << this->pocketCells << " cells, nested up to " << this->maxDepth << " deep, built in " << this->buildTime << " secs" << endl;
+	}
+
+	/*
+		File layout (native endianness): magic, version, grid width, height and
+		connectivity, block size, pocket count, then links, order and pocketOf
+		by row-major block and the pockets. The walkable cells of the grid and
+		the block size build() would pick must match; load() also rejects
+		orders and pockets outside the block ranges, and leaves the map
+		unchanged when it rejects a file.
+	*/
+	bool save(string filePath)
+	{
+		ofstream file(filePath.c_str(), ios::binary);
+		if(!file.is_open())
+		{
+			cout << "could not write " << filePath << endl;
+			return false;
+		}
+
+		int header[7] = {DEAD_END_FILE_MAGIC, DEAD_END_FILE_VERSION, this->grid->gridDimX, this->grid->gridDimY,
+						 this->connectivity, this->blockSize, (int) this->pockets.size()};
+		file.write((const char *) header, sizeof(header));
+		file.write((const char *) this->links.data(), this->links.size());
+		file.write((const char *) this->order.data(), this->order.size() * sizeof(int));
+		file.write((const char *) this->pocketOf.data(), this->pocketOf.size() * sizeof(int));
+		file.write((const char *) this->pockets.data(), this->pockets.size() * sizeof(Pocket));
+		return file.good();
+	}
+
+	bool load(string filePath)
+	{
+		ifstream file(filePath.c_str(), ios::binary);
+		int header[7];
+		if(!file.is_open() or !file.read((char *) header, sizeof(header)))
+		{
+			cout << "could not read " << filePath << endl;
+			return false;
+		}
+		// pockets are only exact for the block size build() picks for the connectivity
+		int blockSize = (header[4] == 8) ? DEAD_END_BLOCK_SIZE : 1;
+		if(header[0] != DEAD_END_FILE_MAGIC or header[1] != DEAD_END_FILE_VERSION or
+		   header[2] != this->grid->gridDimX or header[3] != this->grid->gridDimY or header[4] != this->grid->connectivity or
+		   header[5] != blockSize)
+		{
+			cout << filePath << " is not a dead-end map of this grid." << endl;
+			return false;
+		}
+
+		// everything is read into 'loaded' and swapped in only once the whole file is valid
+		mDeadEndMap loaded(this->grid);
+		loaded.connectivity = header[4];
+		loaded.blockSize = blockSize;
+		loaded.buildLinks();
+		int size = loaded.blocksX * loaded.blocksY;
+		if(header[6] < 0 or header[6] > size)
+		{
+			cout << filePath << " has an invalid pocket count." << endl;
+			return false;
+		}
+		vector<uint8_t> fileLinks(size);
+		loaded.order.resize(size);
+		loaded.pocketOf.resize(size);
+		loaded.pockets.resize(header[6]);
+		file.read((char *) fileLinks.data(), size);
+		file.read((char *) loaded.order.data(), size * sizeof(int));
+		file.read((char *) loaded.pocketOf.data(), size * sizeof(int));
+		file.read((char *) loaded.pockets.data(), loaded.pockets.size() * sizeof(Pocket));
+		if(!file)
+		{
+			cout << filePath << " is truncated." << endl;
+			return false;
+		}
+
+		// the links are derived from the walkable cells, so they must be identical
+		int ordered = 0;
+		for(int block = 0; block < size; block++)
+		{
+			if(fileLinks[block] != loaded.links[block] or (loaded.order[block] >= 0) != loaded.hasWalkableCell(block))
+			{
+				cout << filePath << " does not match the walkable cells of the grid." << endl;
+				return false;
+			}
+			if(loaded.order[block] >= 0) ordered++;
+		}
+
+		// orders number the walkable blocks, pockets are order intervals of them
+		int pocketCount = loaded.pockets.size();
+		for(int block = 0; block < size; block++)
+		{
+			int owner = loaded.pocketOf[block];
+			if(loaded.order[block] >= ordered or owner < -1 or owner >= pocketCount or (owner >= 0 and loaded.order[block] < 0))
+			{
+				cout << filePath << " has invalid block orders." << endl;
+				return false;
+			}
+		}
+		for(int pocket = 0; pocket < pocketCount; pocket++)
+		{
+			Pocket &entry = loaded.pockets[pocket];
+			if(entry.first < 0 or entry.first > entry.last or entry.last >= ordered or entry.articulation < 0 or entry.articulation >= size or
+			   entry.parent < -1 or entry.parent >= pocketCount or entry.parent == pocket)
+			{
+				cout << filePath << " has invalid pockets." << endl;
+				return false;
+			}
+		}
+
+		this->connectivity = loaded.connectivity;
+		this->blockSize = loaded.blockSize;
+		this->blocksX = loaded.blocksX;
+		this->blocksY = loaded.blocksY;
+		this->links.swap(loaded.links);
+		this->order.swap(loaded.order);
+		this->pocketOf.swap(loaded.pocketOf);
+		this->pockets.swap(loaded.pockets);
+		(*this).countPocketCells();
+		this->gridVersion = this->grid->version;
+		return true;
+	}
+};
+
+/*
+	Prunes the dead-end pockets of a mDeadEndMap that hold neither the start
+	nor the goal of the current query (call setQuery() before each search).
+*/
+class mDeadEndFilter : public mSearchFilter
+{
+public:
+	mDeadEndMap *deadEnds;
+	int startOrder;
+	int goalOrder;
+
+	mDeadEndFilter(mDeadEndMap *_deadEnds) : deadEnds(_deadEnds),
+											 startOrder(-1),
+											 goalOrder(-1)
+	{}
+
+	mDeadEndFilter(const mDeadEndFilter &_other)
+	{
+		this->deadEnds = _other.deadEnds;
+		this->startOrder = _other.startOrder;
+		this->goalOrder = _other.goalOrder;
+	}
+
+	virtual ~mDeadEndFilter(){}
+
+	void setQuery(int startX, int startY, int endX, int endY)
+	{
+		this->startOrder = this->deadEnds->order[this->deadEnds->getBlock(this->deadEnds->grid->getNodeIdx(startX, startY))];
+		this->goalOrder = this->deadEnds->order[this->deadEnds->getBlock(this->deadEnds->grid->getNodeIdx(endX, endY))];
+	}
+
+	virtual bool allows(int cell)
+	{
+		int pocket = this->deadEnds->pocketOf[this->deadEnds->getBlock(cell)];
+		if(pocket < 0) return true;
+		const mDeadEndMap::Pocket &entry = this->deadEnds->pockets[pocket];
+		return (this->startOrder >= entry.first and this->startOrder <= entry.last) or
+			   (this->goalOrder >= entry.first and this->goalOrder <= entry.last);
+	}
+};
+
+#endif
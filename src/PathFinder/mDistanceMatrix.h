@@ -0,0 +1,356 @@
+#ifndef DISTANCE_MATRIX_H
+#define DISTANCE_MATRIX_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Shortest distances between every pair of N waypoints on one mGrid (e.g.
+	for tour planning). Moves are symmetric, so the sweep from waypoint i is
+	a one-to-many Dijkstra that only has to settle the waypoints after i, and
+	it stops as soon as the last of them in the component of i is settled
+	(components of the waypoints are flood-filled once per compute, so an
+	unreachable waypoint does not make every sweep cover its whole
+	component); the distances fill both halves of the dense N x N matrix. Sweeps run in parallel with OpenMP,
+	each thread reusing its own distance and parent arrays (reset lazily by a
+	per-sweep stamp). The sweeps read a row-major copy of the walkability
+	with a blocked border, so a neighbor is one offset away and needs no
+	bounds check. With keepPaths, every path is read from the parent chain
+	when its target is settled and stored once per unordered pair.
+*/
+class mDistanceMatrix
+{
+public:
+	struct SweepEntry
+	{
+		double distance;
+		int cell;
+
+		bool operator<(const SweepEntry &other) const
+		{
+			return this->distance > other.distance;
+		}
+	};
+
+	struct SweepState
+	{
+		vector<double> distances;
+		vector<int> parents;
+		vector<uint32_t> stamps;
+		vector<SweepEntry> openSet;
+		uint32_t stamp;
+	};
+
+	mGrid *grid;
+	mHeuristic heuristic;
+	int width;
+	vector<uint8_t> walkable;
+	vector<int> waypoints;
+	vector<int> firstWaypointAt;
+	vector<int> nextWaypoint;
+	vector<int> componentOf;
+	vector<double> distances;
+	vector<vector<int> > paths;
+	bool keepPaths;
+	long expansions;
+	double computeTime;
+	bool verbose;
+
+	mDistanceMatrix(mGrid *_grid) : grid(_grid),
+									width(0),
+									keepPaths(false),
+									expansions(0),
+									computeTime(0.0),
+									verbose(true)
+	{}
+
+	mDistanceMatrix(const mDistanceMatrix &_other)
+	{
+		this->grid = _other.grid;
+		this->heuristic = _other.heuristic;
+		this->width = _other.width;
+		this->walkable = _other.walkable;
+		this->waypoints = _other.waypoints;
+		this->firstWaypointAt = _other.firstWaypointAt;
+		this->nextWaypoint = _other.nextWaypoint;
+		this->componentOf = _other.componentOf;
+		this->distances = _other.distances;
+		this->paths = _other.paths;
+		this->keepPaths = _other.keepPaths;
+		this->expansions = _other.expansions;
+		this->computeTime = _other.computeTime;
+		this->verbose = _other.verbose;
+	}
+
+	virtual ~mDistanceMatrix(){}
+
+	void setVerbose(bool _b)
+	{
+		this->verbose = _b;
+	}
+
+	void setCostMode(int mode)
+	{
+		this->heuristic.setCostMode(mode);
+	}
+
+	int getSize()
+	{
+		return this->waypoints.size();
+	}
+
+	/*
+		Distances between all waypoints (x, y pairs); blocked waypoints reach
+		nothing. Returns false if a coordinate lies outside the grid.
+	*/
+	bool compute(const vector<pair<int, int> > &_waypoints, bool _keepPaths=false)
+	{
+		double stime = omp_get_wtime();
+		int count = _waypoints.size();
+		this->keepPaths = _keepPaths;
+		this->waypoints.clear();
+		this->distances.assign((long) count * count, -1.0);
+		this->paths.clear();
+		if(this->keepPaths) this->paths.resize((long) count * (count - 1) / 2);
+		this->expansions = 0;
+		for(int waypoint = 0; waypoint < count; waypoint++)
+		{
+			int x = _waypoints[waypoint].first;
+			int y = _waypoints[waypoint].second;
+			if(x < 0 or x >= this->grid->gridDimX or y < 0 or y >= this->grid->gridDimY)
+			{
+				if(this->verbose) cout << "waypoint " << waypoint << " is outside the grid." << endl;
+				this->waypoints.clear();
+				this->distances.clear();
+				return false;
+			}
+			this->waypoints.push_back(this->grid->getNodeIdx(x, y));
+		}
+
+		// padded row-major walkability
+		this->width = this->grid->gridDimX + 2;
+		long paddedSize = (long) this->width * (this->grid->gridDimY + 2);
+		this->walkable.assign(paddedSize, 0);
+		#pragma omp parallel for schedule(static)
+		for(int y = 0; y < this->grid->gridDimY; y++)
+		{
+			for(int x = 0; x < this->grid->gridDimX; x++)
+				this->walkable[(long) (y + 1) * this->width + x + 1] = this->grid->getNode(x, y)->walkable ? 1 : 0;
+		}
+
+		// waypoints by padded cell, so a settled cell finds every waypoint on it (duplicates included)
+		this->firstWaypointAt.assign(paddedSize, -1);
+		this->nextWaypoint.assign(count, -1);
+		for(int waypoint = count - 1; waypoint >= 0; waypoint--)
+		{
+			int padded = (*this).getPaddedCell(_waypoints[waypoint].first, _waypoints[waypoint].second);
+			this->nextWaypoint[waypoint] = this->firstWaypointAt[padded];
+			this->firstWaypointAt[padded] = waypoint;
+		}
+		(*this).labelComponents();
+
+		long expanded = 0;
+		#pragma omp parallel reduction(+:expanded)
+		{
+			SweepState state;
+			state.distances.resize(paddedSize);
+			state.parents.resize(paddedSize);
+			state.stamps.assign(paddedSize, 0);
+			state.stamp = 0;
+
+			#pragma omp for schedule(dynamic, 1)
+			for(int source = 0; source < count; source++) expanded += (*this).sweep(source, state);
+		}
+		this->expansions = expanded;
+		this->computeTime = omp_get_wtime() - stime;
+
+		if(this->verbose)
+		{
+			cout << "distance matrix: " << count << " waypoints, " << this->expansions << " expansions, ";
+			cout << this->computeTime << " secs" << endl;
+		}
+		return true;
+	}
+
+	int getPaddedCell(int x, int y)
+	{
+		return (y + 1) * this->width + x + 1;
+	}
+
+	// grid cell of a padded cell
+	int getGridCell(int padded)
+	{
+		return this->grid->getNodeIdx(padded % this->width - 1, padded / this->width - 1);
+	}
+
+	// moves of the sweeps in the padded grid, the first 'connectivity' of them are used
+	void getMoves(int offsets[8], int offsetX[8], int offsetY[8])
+	{
+		static const int moveX[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+		static const int moveY[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+		for(int dir = 0; dir < 8; dir++)
+		{
+			offsetX[dir] = moveX[dir];
+			offsetY[dir] = moveY[dir];
+			offsets[dir] = moveY[dir] * this->width + moveX[dir];
+		}
+	}
+
+	// component of every waypoint (-1 if blocked), flood-filled from the waypoint cells only
+	void labelComponents()
+	{
+		int offsets[8], offsetX[8], offsetY[8];
+		(*this).getMoves(offsets, offsetX, offsetY);
+		int count = this->waypoints.size();
+		vector<int> labels(this->walkable.size(), -1);
+		vector<int> stack;
+		int components = 0;
+		this->componentOf.assign(count, -1);
+		for(int waypoint = 0; waypoint < count; waypoint++)
+		{
+			int cell = (*this).getPaddedCell(this->grid->nodes[this->waypoints[waypoint]].x, this->grid->nodes[this->waypoints[waypoint]].y);
+			if(!this->walkable[cell]) continue;
+			if(labels[cell] < 0)
+			{
+				labels[cell] = components;
+				stack.push_back(cell);
+				while(stack.size() > 0)
+				{
+					int current = stack.back();
+					stack.pop_back();
+					for(int dir = 0; dir < this->grid->connectivity; dir++)
+					{
+						int neighbor = current + offsets[dir];
+						if(!this->walkable[neighbor] or labels[neighbor] >= 0) continue;
+						labels[neighbor] = components;
+						stack.push_back(neighbor);
+					}
+				}
+				components++;
+			}
+			this->componentOf[waypoint] = labels[cell];
+		}
+	}
+
+	// Dijkstra from one waypoint until the reachable waypoints after it are settled; returns the expansions
+	long sweep(int source, SweepState &state)
+	{
+		int offsets[8], offsetX[8], offsetY[8];
+		double stepCosts[8];
+		(*this).getMoves(offsets, offsetX, offsetY);
+		for(int dir = 0; dir < 8; dir++) stepCosts[dir] = this->heuristic.getStepCost(offsetX[dir], offsetY[dir]);
+		int count = this->waypoints.size();
+		int sourceCell = (*this).getPaddedCell(this->grid->nodes[this->waypoints[source]].x, this->grid->nodes[this->waypoints[source]].y);
+		this->distances[(long) source * count + source] = this->walkable[sourceCell] ? 0.0 : -1.0;
+		if(!this->walkable[sourceCell]) return 0;
+
+		// blocked waypoints and waypoints of other components are never settled
+		int remaining = 0;
+		for(int target = source + 1; target < count; target++)
+		{
+			if(this->componentOf[target] == this->componentOf[source]) remaining++;
+		}
+		if(remaining == 0) return 0;
+
+		state.stamp++;
+		state.openSet.clear();
+		state.distances[sourceCell] = 0.0;
+		state.parents[sourceCell] = -1;
+		state.stamps[sourceCell] = state.stamp;
+		SweepEntry first = {0.0, sourceCell};
+		state.openSet.push_back(first);
+
+		long expanded = 0;
+		while(state.openSet.size() > 0 and remaining > 0)
+		{
+			pop_heap(state.openSet.begin(), state.openSet.end());
+			SweepEntry current = state.openSet.back();
+			state.openSet.pop_back();
+			if(current.distance > state.distances[current.cell]) continue;
+			expanded++;
+
+			// every later waypoint on this cell is settled now
+			for(int target = this->firstWaypointAt[current.cell]; target >= 0; target = this->nextWaypoint[target])
+			{
+				if(target <= source) continue;
+				double length = this->heuristic.toLength(current.distance);
+				this->distances[(long) source * count + target] = length;
+				this->distances[(long) target * count + source] = length;
+				if(this->keepPaths) (*this).storePath(source, target, current.cell, state);
+				remaining--;
+			}
+
+			for(int dir = 0; dir < this->grid->connectivity; dir++)
+			{
+				int neighbor = current.cell + offsets[dir];
+				if(!this->walkable[neighbor]) continue;
+
+				double distance = current.distance + stepCosts[dir];
+				if(state.stamps[neighbor] != state.stamp or distance < state.distances[neighbor])
+				{
+					state.stamps[neighbor] = state.stamp;
+					state.distances[neighbor] = distance;
+					state.parents[neighbor] = current.cell;
+					SweepEntry entry = {distance, neighbor};
+					state.openSet.push_back(entry);
+					push_heap(state.openSet.begin(), state.openSet.end());
+				}
+			}
+		}
+		return expanded;
+	}
+
+	// slot of the unordered pair (a, b), a < b, in 'paths'
+	long getPairIndex(int a, int b)
+	{
+		return (long) b * (b - 1) / 2 + a;
+	}
+
+	// cells from the source to 'cell', read back along the parents of the sweep
+	void storePath(int source, int target, int cell, SweepState &state)
+	{
+		vector<int> &path = this->paths[(*this).getPairIndex(source, target)];
+		path.clear();
+		for(int step = cell; step >= 0; step = state.parents[step]) path.push_back((*this).getGridCell(step));
+		reverse(path.begin(), path.end());
+	}
+
+	// path length between two waypoints (-1 if unreachable)
+	double getDistance(int from, int to)
+	{
+		return this->distances[(long) from * this->waypoints.size() + to];
+	}
+
+	// path between two waypoints (needs keepPaths); returns the entries written
+	int extractPath(int from, int to, mPathResult &result)
+	{
+		result.setCostMode(this->heuristic.costMode);
+		result.clear();
+		if(!this->keepPaths or (*this).getDistance(from, to) < 0.0) return 0;
+		if(from == to) return result.assign(this->grid, &this->waypoints[from], 1);
+
+		vector<int> &path = this->paths[(*this).getPairIndex(min(from, to), max(from, to))];
+		return result.assign(this->grid, path.data(), path.size(), from > to);
+	}
+
+	long memoryUsage()
+	{
+		long bytes = this->distances.size() * sizeof(double) + this->walkable.size() + this->firstWaypointAt.size() * sizeof(int);
+		for(long pair = 0; pair < this->paths.size(); pair++) bytes += this->paths[pair].size() * sizeof(int);
+		return bytes;
+	}
+
+	void print()
+	{
+		int count = this->waypoints.size();
+		for(int from = 0; from < count; from++)
+		{
+			for(int to = 0; to < count; to++) cout << (*this).getDistance(from, to) << ((to + 1 < count) ? " " : "");
+			cout << endl;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,523 @@
+#ifndef FIRST_MOVE_TABLE_H
+#define FIRST_MOVE_TABLE_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Compressed path database (CPD) for a static mGrid. For every walkable
+	source it stores the first move of an optimal path toward every walkable
+	target, so a path is extracted by repeated table lookups, without search.
+
+	Walkable cells are renumbered in depth-first order, which keeps cells that
+	are close in the grid close in the numbering, so the first moves of one
+	source form long runs along that order. Each source row is stored as a
+	sorted list of runs (first target ordinal << 4 | move). Targets in another
+	connected component and the source itself are "don't care" entries that
+	never break a run; reachability is answered by the component ids instead.
+
+	build() runs one Dijkstra per source, in parallel with OpenMP, and the
+	table can be saved to and loaded from a binary file.
+*/
+class mFirstMoveTable
+{
+public:
+	struct DijkstraEntry
+	{
+		double distance;
+		int ordinal;
+
+		bool operator<(const DijkstraEntry &other) const
+		{
+			return this->distance > other.distance;
+		}
+	};
+
+	mGrid *grid;
+	int connectivity;
+	int ordering;
+	int nodeCount;
+	vector<int> ordinalToCell;
+	vector<int> cellToOrdinal;
+	vector<int> components;
+	vector<int> adjacency;
+	vector<uint32_t> rowOffsets;
+	vector<uint32_t> runs;
+	vector<int> path;
+	double pathCost;
+	int status;
+	double buildTime;
+
+	mFirstMoveTable(mGrid *_grid, int _ordering=FIRST_MOVE_ORDER_DFS) : grid(_grid),
+																		connectivity(_grid->connectivity),
+																		ordering(_ordering),
+																		nodeCount(0),
+																		pathCost(-1.0),
+																		status(SEARCH_NO_PATH),
+																		buildTime(0.0)
+	{}
+
+	mFirstMoveTable(const mFirstMoveTable &_other)
+	{
+		this->grid = _other.grid;
+		this->connectivity = _other.connectivity;
+		this->ordering = _other.ordering;
+		this->nodeCount = _other.nodeCount;
+		this->ordinalToCell = _other.ordinalToCell;
+		this->cellToOrdinal = _other.cellToOrdinal;
+		this->components = _other.components;
+		this->adjacency = _other.adjacency;
+		this->rowOffsets = _other.rowOffsets;
+		this->runs = _other.runs;
+		this->path = _other.path;
+		this->pathCost = _other.pathCost;
+		this->status = _other.status;
+		this->buildTime = _other.buildTime;
+	}
+
+	virtual ~mFirstMoveTable(){}
+
+	// moves are indexed like the neighbors of mGrid: 4 orthogonal, then diagonals
+	static int getOffsetX(int move)
+	{
+		static const int offsetX[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+		return offsetX[move];
+	}
+
+	static int getOffsetY(int move)
+	{
+		static const int offsetY[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+		return offsetY[move];
+	}
+
+	static double getMoveCost(int move)
+	{
+		return (move < 4) ? 1.0 : sqrt(2.0);
+	}
+
+	void build()
+	{
+		double stime = omp_get_wtime();
+		this->connectivity = this->grid->connectivity;
+		(*this).buildOrdering();
+		(*this).buildAdjacency();
+
+		// one Dijkstra per source; rows are compressed as soon as they are complete
+		vector<vector<uint32_t> > rows(this->nodeCount);
+		#pragma omp parallel
+		{
+			vector<double> distances(this->nodeCount);
+			vector<unsigned char> firstMoves(this->nodeCount);
+			vector<DijkstraEntry> openSet;
+
+			#pragma omp for schedule(dynamic, 16)
+			for(int source = 0; source < this->nodeCount; source++)
+			{
+				(*this).computeFirstMoves(source, distances, firstMoves, openSet);
+				(*this).compressRow(firstMoves, rows[source]);
+			}
+		}
+
+		this->rowOffsets.assign(this->nodeCount + 1, 0);
+		for(int source = 0; source < this->nodeCount; source++)
+			this->rowOffsets[source + 1] = this->rowOffsets[source] + rows[source].size();
+		this->runs.resize(this->rowOffsets[this->nodeCount]);
+		for(int source = 0; source < this->nodeCount; source++)
+		{
+			copy(rows[source].begin(), rows[source].end(), this->runs.begin() + this->rowOffsets[source]);
+			vector<uint32_t>().swap(rows[source]);
+		}
+
+		this->buildTime = omp_get_wtime() - stime;
+	}
+
+	// walkable cells numbered in depth-first (or row-major) order, with component ids
+	void buildOrdering()
+	{
+		this->ordinalToCell.clear();
+		this->components.clear();
+		this->cellToOrdinal.assign(this->grid->gridSize, -1);
+
+		if(this->ordering == FIRST_MOVE_ORDER_ROWS)
+		{
+			for(int y = 0; y < this->grid->gridDimY; y++)
+			{
+				for(int x = 0; x < this->grid->gridDimX; x++)
+				{
+					int cell = this->grid->getNodeIdx(x, y);
+					if(!this->grid->nodes[cell].walkable) continue;
+					this->cellToOrdinal[cell] = this->ordinalToCell.size();
+					this->ordinalToCell.push_back(cell);
+				}
+			}
+			this->nodeCount = this->ordinalToCell.size();
+			(*this).labelComponents();
+			return;
+		}
+
+		vector<int> stack;
+		int component = 0;
+		for(int root = 0; root < this->grid->gridSize; root++)
+		{
+			if(!this->grid->nodes[root].walkable or this->cellToOrdinal[root] >= 0) continue;
+
+			stack.push_back(root);
+			while(stack.size() > 0)
+			{
+				int cell = stack.back();
+				stack.pop_back();
+				if(this->cellToOrdinal[cell] >= 0) continue;
+				this->cellToOrdinal[cell] = this->ordinalToCell.size();
+				this->ordinalToCell.push_back(cell);
+				this->components.push_back(component);
+
+				// pushed in reverse so that the first neighbor is visited first
+				for(int move = this->connectivity - 1; move >= 0; move--)
+				{
+					int neighbor = (*this).getNeighborCell(cell, move);
+					if(neighbor >= 0 and this->cellToOrdinal[neighbor] < 0) stack.push_back(neighbor);
+				}
+			}
+			component++;
+		}
+		this->nodeCount = this->ordinalToCell.size();
+	}
+
+	void labelComponents()
+	{
+		this->components.assign(this->nodeCount, -1);
+		vector<int> stack;
+		int component = 0;
+		for(int root = 0; root < this->nodeCount; root++)
+		{
+			if(this->components[root] >= 0) continue;
+			this->components[root] = component;
+			stack.push_back(this->ordinalToCell[root]);
+			while(stack.size() > 0)
+			{
+				int cell = stack.back();
+				stack.pop_back();
+				for(int move = 0; move < this->connectivity; move++)
+				{
+					int neighbor = (*this).getNeighborCell(cell, move);
+					if(neighbor < 0 or this->components[this->cellToOrdinal[neighbor]] >= 0) continue;
+					this->components[this->cellToOrdinal[neighbor]] = component;
+					stack.push_back(neighbor);
+				}
+			}
+			component++;
+		}
+	}
+
+	// neighbor ordinal of every node for every move (-1 if blocked)
+	void buildAdjacency()
+	{
+		this->adjacency.assign((long) this->nodeCount * this->connectivity, -1);
+		#pragma omp parallel for
+		for(int node = 0; node < this->nodeCount; node++)
+		{
+			for(int move = 0; move < this->connectivity; move++)
+			{
+				int neighbor = (*this).getNeighborCell(this->ordinalToCell[node], move);
+				if(neighbor >= 0) this->adjacency[(long) node * this->connectivity + move] = this->cellToOrdinal[neighbor];
+			}
+		}
+	}
+
+	int getNeighborCell(int cell, int move)
+	{
+		int nx = this->grid->nodes[cell].x + getOffsetX(move);
+		int ny = this->grid->nodes[cell].y + getOffsetY(move);
+		if(nx < 0 or nx >= this->grid->gridDimX or ny < 0 or ny >= this->grid->gridDimY) return -1;
+
+		int index = this->grid->getNodeIdx(nx, ny);
+		return this->grid->nodes[index].walkable ? index : -1;
+	}
+
+	// Dijkstra from one source; every settled node inherits the first move of its parent
+	void computeFirstMoves(int source, vector<double> &distances, vector<unsigned char> &firstMoves, vector<DijkstraEntry> &openSet)
+	{
+		fill(distances.begin(), distances.end(), DBL_MAX);
+		fill(firstMoves.begin(), firstMoves.end(), FIRST_MOVE_NONE);
+		openSet.clear();
+
+		distances[source] = 0.0;
+		DijkstraEntry first = {0.0, source};
+		openSet.push_back(first);
+		while(openSet.size() > 0)
+		{
+			pop_heap(openSet.begin(), openSet.end());
+			DijkstraEntry current = openSet.back();
+			openSet.pop_back();
+			if(current.distance > distances[current.ordinal]) continue;
+
+			const int *neighbors = &this->adjacency[(long) current.ordinal * this->connectivity];
+			for(int move = 0; move < this->connectivity; move++)
+			{
+				int neighbor = neighbors[move];
+				if(neighbor < 0) continue;
+
+				double distance = current.distance + getMoveCost(move);
+				if(distance < distances[neighbor])
+				{
+					distances[neighbor] = distance;
+					firstMoves[neighbor] = (current.ordinal == source) ? move : firstMoves[current.ordinal];
+					DijkstraEntry entry = {distance, neighbor};
+					openSet.push_back(entry);
+					push_heap(openSet.begin(), openSet.end());
+				}
+			}
+		}
+	}
+
+	// runs of equal first moves along the node ordering, "don't care" entries extend the current run
+	void compressRow(vector<unsigned char> &firstMoves, vector<uint32_t> &row)
+	{
+		row.clear();
+		int lastMove = -1;
+		for(int target = 0; target < this->nodeCount; target++)
+		{
+			int move = firstMoves[target];
+			if(move == FIRST_MOVE_NONE or move == lastMove) continue;
+
+			// the first run always starts at ordinal 0, whatever precedes it is "don't care"
+			uint32_t start = (row.size() == 0) ? 0 : target;
+			row.push_back((start << 4) | move);
+			lastMove = move;
+		}
+		row.shrink_to_fit();
+	}
+
+	// first move of an optimal path from one node to another (FIRST_MOVE_NONE if unreachable)
+	int getFirstMove(int sourceOrdinal, int targetOrdinal)
+	{
+		if(sourceOrdinal == targetOrdinal or this->components[sourceOrdinal] != this->components[targetOrdinal]) return FIRST_MOVE_NONE;
+
+		const uint32_t *first = this->runs.data() + this->rowOffsets[sourceOrdinal];
+		const uint32_t *last = this->runs.data() + this->rowOffsets[sourceOrdinal + 1];
+		const uint32_t *run = upper_bound(first, last, ((uint32_t) targetOrdinal << 4) | 15u);
+		return *(run - 1) & 15u;
+	}
+
+	bool findPath(int startX, int startY, int endX, int endY)
+	{
+		this->path.clear();
+		this->pathCost = -1.0;
+		this->status = SEARCH_NO_PATH;
+
+		int source = this->cellToOrdinal[this->grid->getNodeIdx(startX, startY)];
+		int target = this->cellToOrdinal[this->grid->getNodeIdx(endX, endY)];
+		if(source < 0 or target < 0 or this->components[source] != this->components[target]) return false;
+
+		// a path visits every node at most once, so a longer walk means a corrupt table
+		this->pathCost = 0.0;
+		this->path.push_back(this->ordinalToCell[source]);
+		for(int step = 0; source != target; step++)
+		{
+			int move = (*this).getFirstMove(source, target);
+			source = (step < this->nodeCount) ? this->adjacency[(long) source * this->connectivity + move] : -1;
+			if(source < 0)
+			{
+				this->path.clear();
+				this->pathCost = -1.0;
+				return false;
+			}
+			this->pathCost += getMoveCost(move);
+			this->path.push_back(this->ordinalToCell[source]);
+		}
+		this->status = SEARCH_FOUND;
+		return true;
+	}
+
+	int extractPath(mPathResult &result)
+	{
+		if(this->status != SEARCH_FOUND)
+		{
+			result.clear();
+			return 0;
+		}
+		return result.assign(this->grid, this->path.data(), this->path.size());
+	}
+
+	// bytes of the compressed table (runs, row offsets and node numbering)
+	long memoryUsage()
+	{
+		return (long) (this->runs.size() * sizeof(uint32_t) +
+					   this->rowOffsets.size() * sizeof(uint32_t) +
+					   this->ordinalToCell.size() * sizeof(int) +
+					   this->components.size() * sizeof(int) +
+					   this->cellToOrdinal.size() * sizeof(int));
+	}
+
+	void print()
+	{
+		double rawSize = (double) this->nodeCount * this->nodeCount;
+		cout << "first-move table: " << this->nodeCount << " nodes, " << this->runs.size() << " runs (";
+		cout << (this->nodeCount > 0 ? (double) this->runs.size() / this->nodeCount : 0.0) << " per row), ";
+		cout << (this->ordering == FIRST_MOVE_ORDER_DFS ? "dfs" : "row-major") << " order" << endl;
+		cout << "build time: " << this->buildTime << " secs with " << omp_get_max_threads() << " threads, ";
+		cout << "size: " << (*this).memoryUsage() << " bytes (uncompressed " << (long) rawSize << " bytes, ratio ";
+		cout << (rawSize > 0 ? rawSize / (*this).memoryUsage() : 0.0) << ")" << endl;
+	}
+
+	/*
+		File layout (native endianness): magic, version, grid width, height and
+		connectivity, node count, ordering, then ordinalToCell (as row-major
+		positions, whatever the grid layout), components, rowOffsets and runs.
+		The dimensions, connectivity and walkable cells of the grid must match.
+		load() rejects files whose components differ from the grid's, whose row
+		offsets or runs are out of range or whose moves lead into a blocked
+		cell, and leaves the table unchanged when it does.
+	*/
+	bool save(string filePath)
+	{
+		ofstream file(filePath.c_str(), ios::binary);
+		if(!file.is_open())
+		{
+			cout << "could not write " << filePath << endl;
+			return false;
+		}
+
+		int header[7] = {FIRST_MOVE_FILE_MAGIC, FIRST_MOVE_FILE_VERSION, this->grid->gridDimX, this->grid->gridDimY,
+						 this->connectivity, this->nodeCount, this->ordering};
+		file.write((const char *) header, sizeof(header));
+		vector<int> positions(this->nodeCount);
+		for(int node = 0; node < this->nodeCount; node++) positions[node] = this->grid->getRowMajorIdx(this->ordinalToCell[node]);
+		file.write((const char *) positions.data(), this->nodeCount * sizeof(int));
+		file.write((const char *) this->components.data(), this->nodeCount * sizeof(int));
+		file.write((const char *) this->rowOffsets.data(), (this->nodeCount + 1) * sizeof(uint32_t));
+		file.write((const char *) this->runs.data(), this->runs.size() * sizeof(uint32_t));
+		return file.good();
+	}
+
+	bool load(string filePath)
+	{
+		ifstream file(filePath.c_str(), ios::binary);
+		int header[7];
+		if(!file.is_open() or !file.read((char *) header, sizeof(header)))
+		{
+			cout << "could not read " << filePath << endl;
+			return false;
+		}
+		int walkableCount = 0;
+		for(int cell = 0; cell < this->grid->gridSize; cell++)
+		{
+			if(this->grid->nodes[cell].walkable) walkableCount++;
+		}
+		if(header[0] != FIRST_MOVE_FILE_MAGIC or header[1] != FIRST_MOVE_FILE_VERSION or
+		   header[2] != this->grid->gridDimX or header[3] != this->grid->gridDimY or header[4] != this->grid->connectivity or
+		   (header[6] != FIRST_MOVE_ORDER_DFS and header[6] != FIRST_MOVE_ORDER_ROWS))
+		{
+			cout << filePath << " is not a first-move table of this grid." << endl;
+			return false;
+		}
+		if(header[5] != walkableCount)
+		{
+			cout << filePath << " does not match the walkable cells of the grid." << endl;
+			return false;
+		}
+
+		// everything is read into 'loaded' and swapped in only once the whole file is valid
+		mFirstMoveTable loaded(this->grid, header[6]);
+		loaded.connectivity = header[4];
+		loaded.nodeCount = header[5];
+		loaded.ordinalToCell.resize(loaded.nodeCount);
+		loaded.components.resize(loaded.nodeCount);
+		loaded.rowOffsets.resize(loaded.nodeCount + 1);
+		file.read((char *) loaded.ordinalToCell.data(), loaded.nodeCount * sizeof(int));
+		file.read((char *) loaded.components.data(), loaded.nodeCount * sizeof(int));
+		file.read((char *) loaded.rowOffsets.data(), (loaded.nodeCount + 1) * sizeof(uint32_t));
+		if(!file)
+		{
+			cout << filePath << " is truncated." << endl;
+			return false;
+		}
+
+		// row offsets start at 0, never decrease and the runs they cover must all be in the file
+		streampos runsStart = file.tellg();
+		file.seekg(0, ios::end);
+		long runsInFile = (long) (file.tellg() - runsStart) / sizeof(uint32_t);
+		file.seekg(runsStart);
+		for(int node = 0; node < loaded.nodeCount; node++)
+		{
+			if(loaded.rowOffsets[node] > loaded.rowOffsets[node + 1])
+			{
+				cout << filePath << " has invalid row offsets." << endl;
+				return false;
+			}
+		}
+		if(loaded.rowOffsets[0] != 0 or (long) loaded.rowOffsets[loaded.nodeCount] > runsInFile)
+		{
+			cout << filePath << " has invalid row offsets." << endl;
+			return false;
+		}
+		loaded.runs.resize(loaded.rowOffsets[loaded.nodeCount]);
+		file.read((char *) loaded.runs.data(), loaded.runs.size() * sizeof(uint32_t));
+		if(!file)
+		{
+			cout << filePath << " is truncated." << endl;
+			return false;
+		}
+
+		loaded.cellToOrdinal.assign(this->grid->gridSize, -1);
+		for(int node = 0; node < loaded.nodeCount; node++)
+		{
+			int position = loaded.ordinalToCell[node];
+			if(position < 0 or position >= this->grid->gridSize or
+			   !this->grid->getNode(position % this->grid->gridDimX, position / this->grid->gridDimX)->walkable or
+			   loaded.cellToOrdinal[this->grid->getNodeIdx(position % this->grid->gridDimX, position / this->grid->gridDimX)] >= 0)
+			{
+				cout << filePath << " does not match the walkable cells of the grid." << endl;
+				return false;
+			}
+			int cell = this->grid->getNodeIdx(position % this->grid->gridDimX, position / this->grid->gridDimX);
+			loaded.ordinalToCell[node] = cell;
+			loaded.cellToOrdinal[cell] = node;
+		}
+		loaded.buildAdjacency();
+
+		// components are numbered in order of their first ordinal, as build() numbers them
+		vector<int> storedComponents;
+		storedComponents.swap(loaded.components);
+		loaded.labelComponents();
+		if(storedComponents != loaded.components)
+		{
+			cout << filePath << " has invalid components." << endl;
+			return false;
+		}
+
+		// every row is a sorted list of runs starting at ordinal 0, with moves to walkable neighbors
+		for(int node = 0; node < loaded.nodeCount; node++)
+		{
+			for(uint32_t run = loaded.rowOffsets[node]; run < loaded.rowOffsets[node + 1]; run++)
+			{
+				uint32_t start = loaded.runs[run] >> 4;
+				int move = loaded.runs[run] & 15u;
+				bool ordered = (run == loaded.rowOffsets[node]) ? (start == 0) : (start > (loaded.runs[run - 1] >> 4));
+				if(!ordered or start >= (uint32_t) loaded.nodeCount or move >= loaded.connectivity or
+				   loaded.adjacency[(long) node * loaded.connectivity + move] < 0)
+				{
+					cout << filePath << " has invalid runs." << endl;
+					return false;
+				}
+			}
+		}
+
+		this->connectivity = loaded.connectivity;
+		this->nodeCount = loaded.nodeCount;
+		this->ordering = loaded.ordering;
+		this->ordinalToCell.swap(loaded.ordinalToCell);
+		this->cellToOrdinal.swap(loaded.cellToOrdinal);
+		this->components.swap(loaded.components);
+		this->adjacency.swap(loaded.adjacency);
+		this->rowOffsets.swap(loaded.rowOffsets);
+		this->runs.swap(loaded.runs);
+		this->path.clear();
+		this->status = SEARCH_NO_PATH;
+		return true;
+	}
+};
+
+#endif
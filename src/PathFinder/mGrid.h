@@ -6,22 +6,63 @@
 
 using namespace std;
 
+/*
+	Cells are stored in 'nodes' in one of three layouts, always as a dense
+	array of gridSize entries; code outside mGrid only sees cell indices
+	from getNodeIdx and coordinates from the nodes themselves.
+	  GRID_LAYOUT_ROWS    row-major
+	  GRID_LAYOUT_TILED   square tiles of 'tileSize' cells, tiles in row-major
+	                      order, row-major inside a tile
+	  GRID_LAYOUT_MORTON  like TILED, with Z-order (Morton) inside full tiles
+	Tiles on the right and bottom borders are clipped to the grid (stored
+	row-major), so no index is wasted on padding.
+	Every change of the walkability raises 'version'. Edits made through
+	setWalkable and the batched edits also append the journal tiles
+	(GRID_JOURNAL_TILE_SIZE squares) they touched to a bounded change
+	journal, so derived data can repair only those tiles (see getChanges).
+*/
 class mGrid
 {
 public:
+	struct JournalEntry
+	{
+		long version;
+		bool opened;
+		vector<int> tiles;
+	};
+
 	int gridSize;
 	int gridDimX;
 	int gridDimY;
 	mNode *nodes;
 	int connectivity;
+	long version;
+	int layout;
+	int tileSize;
+	int tileMask;
+	vector<int> rowOffsets;
+	vector<int> columnOffsets;
+	deque<JournalEntry> journal;
+	long journalBase;
 
-	mGrid(int _dimX, int _dimY) : gridDimX(_dimX), gridDimY(_dimY), gridSize(_dimX*_dimY), connectivity(4)
+	mGrid(int _dimX, int _dimY) : gridDimX(_dimX), gridDimY(_dimY), gridSize(_dimX*_dimY), connectivity(4), version(0), layout(GRID_LAYOUT_ROWS), tileSize(1), tileMask(0), journalBase(0)
 	{
 		nodes = new mNode[gridSize];
 		(*this).buildGridOfNodes();
 	};
 
-	mGrid(cv::Mat *image) : connectivity(4)
+	// grid with every cell walkable (or blocked), e.g. to be filled by the caller
+	mGrid(int _dimX, int _dimY, bool _walkable) : gridDimX(_dimX), gridDimY(_dimY), gridSize(_dimX*_dimY), connectivity(4), version(0), layout(GRID_LAYOUT_ROWS), tileSize(1), tileMask(0), journalBase(0)
+	{
+		nodes = new mNode[gridSize];
+		for(int j = 0; j < this->gridDimY; j++)
+		{
+			for(int i = 0; i < this->gridDimX; i++)
+				this->nodes[(*this).getNodeIdx(i,j)].set(i, j, _walkable);
+		}
+	};
+
+	mGrid(cv::Mat *image) : connectivity(4), version(0), layout(GRID_LAYOUT_ROWS), tileSize(1), tileMask(0), journalBase(0)
 	{	
 		this->gridDimX = image->rows; 
 		this->gridDimY = image->cols;
@@ -37,6 +78,14 @@ public:
 		this->gridDimY = otherGrid.gridDimY;
 		this->nodes = otherGrid.nodes;
 		this->connectivity = otherGrid.connectivity;
+		this->version = otherGrid.version;
+		this->layout = otherGrid.layout;
+		this->tileSize = otherGrid.tileSize;
+		this->tileMask = otherGrid.tileMask;
+		this->rowOffsets = otherGrid.rowOffsets;
+		this->columnOffsets = otherGrid.columnOffsets;
+		this->journal = otherGrid.journal;
+		this->journalBase = otherGrid.journalBase;
 	}
 
 	virtual ~mGrid()
@@ -52,9 +101,106 @@ public:
 
 	int getNodeIdx(int x, int y)
 	{
-		int index = this->gridDimX * y + x;
-		index = index % gridSize;
-		return index;
+		if(this->layout == GRID_LAYOUT_ROWS)
+		{
+			int index = this->gridDimX * y + x;
+			index = index % gridSize;
+			return index;
+		}
+
+		// full tiles: the index splits into a part of y and a part of x
+		if(x < this->columnOffsets.size() and y < this->rowOffsets.size())
+			return this->rowOffsets[y] + this->columnOffsets[x];
+
+		// first cell of the tile: full bands of tiles above, then the tiles to the left in this band
+		int bandY = y & ~this->tileMask;
+		int tileX = x & ~this->tileMask;
+		int bandHeight = min(this->tileSize, this->gridDimY - bandY);
+		int tileWidth = min(this->tileSize, this->gridDimX - tileX);
+		int index = bandY * this->gridDimX + tileX * bandHeight;
+		if(this->layout == GRID_LAYOUT_MORTON and bandHeight == this->tileSize and tileWidth == this->tileSize)
+			return index + (int) mGrid::interleaveBits(x & this->tileMask, y & this->tileMask);
+		return index + (y - bandY) * tileWidth + (x - tileX);
+	}
+
+	// Morton code of (x, y) for coordinates below 2^16
+	static uint32_t interleaveBits(uint32_t x, uint32_t y)
+	{
+		x = (x | (x << 8)) & 0x00FF00FF;
+		x = (x | (x << 4)) & 0x0F0F0F0F;
+		x = (x | (x << 2)) & 0x33333333;
+		x = (x | (x << 1)) & 0x55555555;
+		y = (y | (y << 8)) & 0x00FF00FF;
+		y = (y | (y << 4)) & 0x0F0F0F0F;
+		y = (y | (y << 2)) & 0x33333333;
+		y = (y | (y << 1)) & 0x55555555;
+		return x | (y << 1);
+	}
+
+	/*
+		Move every cell to its place in another layout ('_tileSize' is rounded
+		up to a power of two; 0 picks GRID_TILE_SIZE or GRID_MORTON_TILE_SIZE).
+		Cell indices and mNode pointers taken before the call are invalid
+		afterwards, so the version changes; searches bound to the grid must be
+		set up again.
+	*/
+	void setLayout(int _layout, int _tileSize=0)
+	{
+		if(_tileSize <= 0) _tileSize = (_layout == GRID_LAYOUT_MORTON) ? GRID_MORTON_TILE_SIZE : GRID_TILE_SIZE;
+		int size = 1;
+		while(size < _tileSize and size < (1 << 15)) size *= 2;
+		if(_layout == GRID_LAYOUT_ROWS) size = 1;
+
+		mNode *moved = new mNode[this->gridSize];
+		int oldLayout = this->layout;
+		int oldTileSize = this->tileSize;
+		this->layout = _layout;
+		this->tileSize = size;
+		this->tileMask = size - 1;
+		(*this).buildOffsets();
+		#pragma omp parallel for
+		for(int cell = 0; cell < this->gridSize; cell++)
+		{
+			mNode &node = moved[(*this).getNodeIdx(this->nodes[cell].x, this->nodes[cell].y)];
+			node.set(this->nodes[cell].x, this->nodes[cell].y, this->nodes[cell].walkable);
+		}
+
+		delete [] this->nodes;
+		this->nodes = moved;
+		if(oldLayout != this->layout or oldTileSize != this->tileSize) (*this).markAllChanged();
+	}
+
+	// index parts of the rows and columns covered by full tiles
+	void buildOffsets()
+	{
+		this->rowOffsets.clear();
+		this->columnOffsets.clear();
+		if(this->layout == GRID_LAYOUT_ROWS) return;
+
+		bool morton = (this->layout == GRID_LAYOUT_MORTON);
+		for(int y = 0; y < (this->gridDimY & ~this->tileMask); y++)
+		{
+			int inside = y & this->tileMask;
+			this->rowOffsets.push_back((y & ~this->tileMask) * this->gridDimX + (morton ? (int) mGrid::interleaveBits(0, inside) : inside * this->tileSize));
+		}
+		for(int x = 0; x < (this->gridDimX & ~this->tileMask); x++)
+		{
+			int inside = x & this->tileMask;
+			this->columnOffsets.push_back((x & ~this->tileMask) * this->tileSize + (morton ? (int) mGrid::interleaveBits(inside, 0) : inside));
+		}
+	}
+
+	// row-major position of a cell, independent of the layout (e.g. for files and seeds)
+	int getRowMajorIdx(int cell)
+	{
+		return this->nodes[cell].y * this->gridDimX + this->nodes[cell].x;
+	}
+
+	static string layoutName(int layout)
+	{
+		if(layout == GRID_LAYOUT_TILED) return "tiled";
+		if(layout == GRID_LAYOUT_MORTON) return "morton";
+		return "rows";
 	}
 
 	mNode * getNode(int x, int y)
@@ -62,6 +208,167 @@ public:
 		return &this->nodes[getNodeIdx(x,y)];
 	}
 
+	// edits go through here so that derived data (e.g. mPathCache) sees a new grid version
+	void setWalkable(int x, int y, bool walkable)
+	{
+		mNode *node = (*this).getNode(x, y);
+		if(node->walkable != walkable)
+		{
+			node->walkable = walkable;
+			JournalEntry entry;
+			entry.version = ++this->version;
+			entry.opened = walkable;
+			entry.tiles.push_back((*this).getJournalTile(x, y));
+			(*this).addJournalEntry(entry);
+		}
+	}
+
+	// every cell of the rectangle set to 'walkable', as one batch; returns the number of changed cells
+	long fillRect(int x0, int y0, int width, int height, bool walkable)
+	{
+		return (*this).applyBatch(x0, y0, x0 + width, y0 + height, [walkable](int x, int y) -> int
+		{
+			return walkable ? 1 : 0;
+		});
+	}
+
+	// cells of the rectangle whose entry of 'mask' (row-major, width x height) is non-zero set to 'walkable'
+	long applyMask(int x0, int y0, int width, int height, const vector<uint8_t> &mask, bool walkable)
+	{
+		return (*this).applyBatch(x0, y0, x0 + width, y0 + height, [&mask, x0, y0, width, walkable](int x, int y) -> int
+		{
+			return mask[(long) (y - y0) * width + (x - x0)] ? (walkable ? 1 : 0) : -1;
+		});
+	}
+
+	// walkability read again from an image of the same size (see buildGridOfNodesFromImage), only the differences are written
+	long applyImageDiff(cv::Mat *image)
+	{
+		if(image->rows != this->gridDimX or image->cols != this->gridDimY)
+		{
+			cout << "image size does not match the grid." << endl;
+			return 0;
+		}
+		int channels = image->channels();
+		return (*this).applyBatch(0, 0, this->gridDimX, this->gridDimY, [image, channels](int x, int y) -> int
+		{
+			return (image->ptr<uchar>(y)[x*channels] == GRID_WALKABLE_COLOR) ? 1 : 0;
+		});
+	}
+
+	/*
+		Batched edit of the cells [x0, x1) x [y0, y1): 'target(x, y)' gives the
+		new walkability of a cell (1 or 0, -1 to leave it). Bands of journal
+		tiles are edited in parallel and a cell is only written if it changes.
+		The whole batch is one version and one journal entry with the tiles
+		that actually changed. Returns the number of changed cells.
+	*/
+	template<class Target>
+	long applyBatch(int x0, int y0, int x1, int y1, Target target)
+	{
+		x0 = max(x0, 0);
+		y0 = max(y0, 0);
+		x1 = min(x1, this->gridDimX);
+		y1 = min(y1, this->gridDimY);
+		if(x0 >= x1 or y0 >= y1) return 0;
+
+		int size = GRID_JOURNAL_TILE_SIZE;
+		int tilesX = (*this).getJournalTilesX();
+		int firstBand = y0 / size;
+		int lastBand = (y1 - 1) / size;
+		vector<uint8_t> dirty((long) (lastBand - firstBand + 1) * tilesX, 0);
+		long changed = 0;
+		int opened = 0;
+		#pragma omp parallel for schedule(dynamic, 1) reduction(+:changed) reduction(max:opened)
+		for(int band = firstBand; band <= lastBand; band++)
+		{
+			uint8_t *bandDirty = &dirty[(long) (band - firstBand) * tilesX];
+			for(int y = max(y0, band * size); y < min(y1, (band + 1) * size); y++)
+			{
+				for(int x = x0; x < x1; x++)
+				{
+					int value = target(x, y);
+					if(value < 0) continue;
+					mNode &node = this->nodes[(*this).getNodeIdx(x, y)];
+					if(node.walkable == (value > 0)) continue;
+					node.walkable = (value > 0);
+					bandDirty[x / size] = 1;
+					changed++;
+					opened = max(opened, value);
+				}
+			}
+		}
+		if(changed == 0) return 0;
+
+		JournalEntry entry;
+		entry.version = ++this->version;
+		entry.opened = (opened > 0);
+		for(long tile = 0; tile < dirty.size(); tile++)
+		{
+			if(dirty[tile]) entry.tiles.push_back(firstBand * tilesX + tile);
+		}
+		(*this).addJournalEntry(entry);
+		return changed;
+	}
+
+	int getJournalTilesX()
+	{
+		return (this->gridDimX + GRID_JOURNAL_TILE_SIZE - 1) / GRID_JOURNAL_TILE_SIZE;
+	}
+
+	int getJournalTile(int x, int y)
+	{
+		return (y / GRID_JOURNAL_TILE_SIZE) * (*this).getJournalTilesX() + x / GRID_JOURNAL_TILE_SIZE;
+	}
+
+	// cells [x0, x1) x [y0, y1) of a journal tile, clipped to the grid
+	void getJournalTileRect(int tile, int &x0, int &y0, int &x1, int &y1)
+	{
+		x0 = (tile % (*this).getJournalTilesX()) * GRID_JOURNAL_TILE_SIZE;
+		y0 = (tile / (*this).getJournalTilesX()) * GRID_JOURNAL_TILE_SIZE;
+		x1 = min(x0 + GRID_JOURNAL_TILE_SIZE, this->gridDimX);
+		y1 = min(y0 + GRID_JOURNAL_TILE_SIZE, this->gridDimY);
+	}
+
+	void addJournalEntry(JournalEntry &entry)
+	{
+		this->journal.push_back(entry);
+		while(this->journal.size() > GRID_JOURNAL_SIZE)
+		{
+			this->journalBase = this->journal.front().version;
+			this->journal.pop_front();
+		}
+	}
+
+	// a change the journal cannot describe (new layout, whole map regenerated): derived data must rebuild
+	void markAllChanged()
+	{
+		this->version++;
+		this->journal.clear();
+		this->journalBase = this->version;
+	}
+
+	/*
+		Sorted journal tiles changed after version 'since', and whether any of
+		those edits made a cell walkable (edits that only block cells cannot
+		shorten a path). Returns false if the journal no longer reaches back to
+		'since'; the caller has to rebuild from scratch.
+	*/
+	bool getChanges(long since, vector<int> &tiles, bool &opened)
+	{
+		tiles.clear();
+		opened = false;
+		if(since < this->journalBase or since > this->version) return false;
+		for(deque<JournalEntry>::reverse_iterator entry = this->journal.rbegin(); entry != this->journal.rend() and entry->version > since; entry++)
+		{
+			tiles.insert(tiles.end(), entry->tiles.begin(), entry->tiles.end());
+			opened = opened or entry->opened;
+		}
+		sort(tiles.begin(), tiles.end());
+		tiles.erase(unique(tiles.begin(), tiles.end()), tiles.end());
+		return true;
+	}
+
 	void setConnectivity(int _connectivity)
 	{
 		if(_connectivity == 4) 
@@ -161,18 +468,34 @@ public:
 		return neighbors;
 	}
 
-	void buildGridOfNodes()
+	// walkable nodes on one border of the grid (e.g. inlet/outlet faces of a sample)
+	vector<mNode *> getBorderNodes(int side)
 	{
-		bool walkable;
-		int index;
+		vector<mNode *> border(0);
+		bool vertical = (side == GRID_BORDER_LEFT or side == GRID_BORDER_RIGHT);
+		int length = vertical ? this->gridDimY : this->gridDimX;
+		for(int pos = 0; pos < length; pos++)
+		{
+			mNode *node;
+			if(side == GRID_BORDER_LEFT) node = (*this).getNode(0, pos);
+			else if(side == GRID_BORDER_RIGHT) node = (*this).getNode(this->gridDimX - 1, pos);
+			else if(side == GRID_BORDER_TOP) node = (*this).getNode(pos, 0);
+			else node = (*this).getNode(pos, this->gridDimY - 1);
+			if(node->walkable) border.push_back(node);
+		}
+		return border;
+	}
+
+	// random obstacles at OBSTACLES_RATE; see mMapGenerator for seeded maps of other kinds
+	void buildGridOfNodes(uint64_t seed=mRandom::randomSeed())
+	{
+		#pragma omp parallel for
 		for(int j = 0; j < this->gridDimY; j++)
 		{
 			for(int i = 0; i < this->gridDimX; i++)
 			{
-				walkable = true;
-				if((*this).getRandomDouble() < OBSTACLES_RATE) 
-					walkable = false;
-				index = (*this).getNodeIdx(i,j);
+				int index = (*this).getNodeIdx(i,j);
+				bool walkable = (mRandom::uniform(seed, (uint64_t) j * this->gridDimX + i) >= OBSTACLES_RATE);
 				this->nodes[index].set(i, j, walkable);
 			}
 		}
@@ -202,11 +525,11 @@ public:
 
 	double getRandomDouble(double max=1.0, double min=0.0)
 	{
-	    std::random_device rd;
-	    std::default_random_engine eng(rd());
-	    std::uniform_real_distribution<double> distr(min, max);
-    	return distr(eng);
-	}	
+		// one engine per thread, seeded once (not per call)
+		static thread_local std::default_random_engine eng(mRandom::randomSeed());
+		std::uniform_real_distribution<double> distr(min, max);
+		return distr(eng);
+	}
 };
 
 #endif
\ No newline at end of file
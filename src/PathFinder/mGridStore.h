@@ -0,0 +1,307 @@
+#ifndef GRID_STORE_H
+#define GRID_STORE_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Versioned walkability of a grid that is edited while other threads search
+	it. Walkability lives in immutable snapshots made of SNAPSHOT_TILE_SIZE
+	square tiles of packed bits; an edit copies only the tiles it touches,
+	shares the others with the previous snapshot and publishes the new one
+	with a single atomic store, so readers never wait for writers (writers are
+	serialized among themselves).
+	Readers pin the current snapshot for the duration of a query (pin/unpin
+	with a reader slot). Old snapshots are freed with epoch-based reclamation:
+	a snapshot retired at epoch e is deleted once every pinned reader entered
+	after e.
+	Searches run on 'geometry', a mGrid with every cell walkable (coordinates
+	and layout only), restricted to the walkable cells of a pinned snapshot by
+	a mSnapshotFilter; its mNode scratch state is never used.
+*/
+class mGridStore
+{
+public:
+	struct Tile
+	{
+		uint64_t bits[SNAPSHOT_TILE_SIZE];
+	};
+
+	struct Snapshot
+	{
+		long version;
+		int tilesX;
+		vector<shared_ptr<Tile> > tiles;
+
+		bool isWalkable(int x, int y) const
+		{
+			const Tile *tile = this->tiles[(y / SNAPSHOT_TILE_SIZE) * this->tilesX + x / SNAPSHOT_TILE_SIZE].get();
+			return (tile->bits[y % SNAPSHOT_TILE_SIZE] >> (x % SNAPSHOT_TILE_SIZE)) & 1ULL;
+		}
+	};
+
+	struct Edit
+	{
+		int x;
+		int y;
+		bool walkable;
+	};
+
+	// padded to a cache line per reader, so that pinning does not share lines between threads
+	struct ReaderSlot
+	{
+		atomic<uint64_t> epoch;
+		atomic<bool> used;
+		char padding[64 - sizeof(atomic<uint64_t>) - sizeof(atomic<bool>)];
+	};
+
+	struct Retired
+	{
+		Snapshot *snapshot;
+		uint64_t epoch;
+	};
+
+	mGrid *geometry;
+	int gridDimX;
+	int gridDimY;
+	int tilesX;
+	int tilesY;
+	atomic<Snapshot *> current;
+	atomic<uint64_t> globalEpoch;
+	vector<ReaderSlot> readers;
+	vector<Retired> retired;
+	mutex writerMutex;
+	long publishedVersions;
+	long copiedTiles;
+	long reclaimedSnapshots;
+
+	mGridStore(mGrid *_grid) : gridDimX(_grid->gridDimX),
+							   gridDimY(_grid->gridDimY),
+							   globalEpoch(1),
+							   readers(SNAPSHOT_MAX_READERS),
+							   publishedVersions(0),
+							   copiedTiles(0),
+							   reclaimedSnapshots(0)
+	{
+		this->geometry = new mGrid(this->gridDimX, this->gridDimY, true);
+		this->geometry->setConnectivity(_grid->connectivity);
+		if(_grid->layout != GRID_LAYOUT_ROWS) this->geometry->setLayout(_grid->layout, _grid->tileSize);
+		for(int reader = 0; reader < this->readers.size(); reader++)
+		{
+			this->readers[reader].epoch.store(SNAPSHOT_IDLE);
+			this->readers[reader].used.store(false);
+		}
+
+		this->tilesX = (this->gridDimX + SNAPSHOT_TILE_SIZE - 1) / SNAPSHOT_TILE_SIZE;
+		this->tilesY = (this->gridDimY + SNAPSHOT_TILE_SIZE - 1) / SNAPSHOT_TILE_SIZE;
+		Snapshot *first = new Snapshot();
+		first->version = 0;
+		first->tilesX = this->tilesX;
+		first->tiles.resize(this->tilesX * this->tilesY);
+		#pragma omp parallel for
+		for(int tile = 0; tile < first->tiles.size(); tile++)
+		{
+			first->tiles[tile] = make_shared<Tile>();
+			Tile *bits = first->tiles[tile].get();
+			int x0 = (tile % this->tilesX) * SNAPSHOT_TILE_SIZE;
+			int y0 = (tile / this->tilesX) * SNAPSHOT_TILE_SIZE;
+			for(int row = 0; row < SNAPSHOT_TILE_SIZE; row++)
+			{
+				bits->bits[row] = 0;
+				if(y0 + row >= this->gridDimY) continue;
+				for(int column = 0; column < SNAPSHOT_TILE_SIZE and x0 + column < this->gridDimX; column++)
+				{
+					if(_grid->getNode(x0 + column, y0 + row)->walkable) bits->bits[row] |= 1ULL << column;
+				}
+			}
+		}
+		this->current.store(first);
+	}
+
+	// the atomics and the writer mutex cannot be shared: a copy starts from the current snapshot
+	mGridStore(const mGridStore &_other) : gridDimX(_other.gridDimX),
+										   gridDimY(_other.gridDimY),
+										   tilesX(_other.tilesX),
+										   tilesY(_other.tilesY),
+										   globalEpoch(1),
+										   readers(SNAPSHOT_MAX_READERS),
+										   publishedVersions(0),
+										   copiedTiles(0),
+										   reclaimedSnapshots(0)
+	{
+		this->geometry = new mGrid(this->gridDimX, this->gridDimY, true);
+		this->geometry->setConnectivity(_other.geometry->connectivity);
+		if(_other.geometry->layout != GRID_LAYOUT_ROWS) this->geometry->setLayout(_other.geometry->layout, _other.geometry->tileSize);
+		for(int reader = 0; reader < this->readers.size(); reader++)
+		{
+			this->readers[reader].epoch.store(SNAPSHOT_IDLE);
+			this->readers[reader].used.store(false);
+		}
+		this->current.store(new Snapshot(*_other.current.load()));
+	}
+
+	// no reader may still be pinned
+	virtual ~mGridStore()
+	{
+		for(int entry = 0; entry < this->retired.size(); entry++) delete this->retired[entry].snapshot;
+		this->retired.clear();
+		delete this->current.load();
+		if(this->geometry != NULL)
+		{
+			delete this->geometry;
+			this->geometry = NULL;
+		}
+	}
+
+	// claim a reader slot (one per thread), -1 if all SNAPSHOT_MAX_READERS are taken
+	int registerReader()
+	{
+		for(int reader = 0; reader < this->readers.size(); reader++)
+		{
+			bool expected = false;
+			if(this->readers[reader].used.compare_exchange_strong(expected, true)) return reader;
+		}
+		return -1;
+	}
+
+	void unregisterReader(int reader)
+	{
+		this->readers[reader].epoch.store(SNAPSHOT_IDLE);
+		this->readers[reader].used.store(false);
+	}
+
+	// the snapshot stays valid (and unchanged) until unpin()
+	const Snapshot *pin(int reader)
+	{
+		this->readers[reader].epoch.store(this->globalEpoch.load());
+		return this->current.load();
+	}
+
+	void unpin(int reader)
+	{
+		this->readers[reader].epoch.store(SNAPSHOT_IDLE, memory_order_release);
+	}
+
+	long getVersion()
+	{
+		return this->current.load()->version;
+	}
+
+	bool isWalkable(int x, int y)
+	{
+		return this->current.load()->isWalkable(x, y);
+	}
+
+	void setWalkable(int x, int y, bool walkable)
+	{
+		Edit edit = {x, y, walkable};
+		vector<Edit> edits(1, edit);
+		(*this).applyEdits(edits);
+	}
+
+	// publish one new version with every edit of the batch, copying each touched tile once
+	void applyEdits(vector<Edit> &edits)
+	{
+		lock_guard<mutex> lock(this->writerMutex);
+		Snapshot *previous = this->current.load();
+		Snapshot *next = new Snapshot(*previous);
+		next->version = previous->version + 1;
+
+		long copied = 0;
+		for(int entry = 0; entry < edits.size(); entry++)
+		{
+			Edit &edit = edits[entry];
+			if(edit.x < 0 or edit.x >= this->gridDimX or edit.y < 0 or edit.y >= this->gridDimY) continue;
+
+			int tile = (edit.y / SNAPSHOT_TILE_SIZE) * this->tilesX + edit.x / SNAPSHOT_TILE_SIZE;
+			if(next->tiles[tile] == previous->tiles[tile])
+			{
+				next->tiles[tile] = make_shared<Tile>(*previous->tiles[tile]);
+				copied++;
+			}
+			uint64_t &row = next->tiles[tile]->bits[edit.y % SNAPSHOT_TILE_SIZE];
+			uint64_t mask = 1ULL << (edit.x % SNAPSHOT_TILE_SIZE);
+			if(edit.walkable) row |= mask;
+			else row &= ~mask;
+		}
+
+		// readers that pin after the epoch moves on can only see 'next'
+		this->current.store(next);
+		Retired entry = {previous, this->globalEpoch.fetch_add(1)};
+		this->retired.push_back(entry);
+		this->publishedVersions++;
+		this->copiedTiles += copied;
+		(*this).reclaim();
+	}
+
+	// delete retired snapshots that no pinned reader can still hold
+	void reclaim()
+	{
+		uint64_t oldest = SNAPSHOT_IDLE;
+		for(int reader = 0; reader < this->readers.size(); reader++)
+			oldest = min(oldest, this->readers[reader].epoch.load());
+
+		int kept = 0;
+		for(int entry = 0; entry < this->retired.size(); entry++)
+		{
+			if(this->retired[entry].epoch < oldest)
+			{
+				delete this->retired[entry].snapshot;
+				this->reclaimedSnapshots++;
+			} else
+				this->retired[kept++] = this->retired[entry];
+		}
+		this->retired.resize(kept);
+	}
+
+	long memoryUsage()
+	{
+		// tiles of the current snapshot and the tile tables of the retired ones
+		long tiles = (long) this->tilesX * this->tilesY;
+		return tiles * sizeof(Tile) + (1 + (long) this->retired.size()) * tiles * sizeof(shared_ptr<Tile>);
+	}
+
+	void print()
+	{
+		cout << "grid store: " << this->gridDimX << "x" << this->gridDimY << ", " << this->tilesX * this->tilesY << " tiles, version " << (*this).getVersion();
+		cout << ", " << this->copiedTiles << " tiles copied, " << this->reclaimedSnapshots << " snapshots reclaimed, ";
+		cout << this->retired.size() << " waiting" << endl;
+	}
+};
+
+/*
+	Walkable cells of a pinned mGridStore snapshot, for engines that search the
+	store's geometry grid.
+*/
+class mSnapshotFilter : public mSearchFilter
+{
+public:
+	mGrid *geometry;
+	const mGridStore::Snapshot *snapshot;
+
+	mSnapshotFilter(mGridStore *_store) : geometry(_store->geometry),
+										 snapshot(NULL)
+	{}
+
+	mSnapshotFilter(const mSnapshotFilter &_other)
+	{
+		this->geometry = _other.geometry;
+		this->snapshot = _other.snapshot;
+	}
+
+	virtual ~mSnapshotFilter(){}
+
+	void setSnapshot(const mGridStore::Snapshot *_snapshot)
+	{
+		this->snapshot = _snapshot;
+	}
+
+	virtual bool allows(int cell)
+	{
+		return this->snapshot->isWalkable(this->geometry->nodes[cell].x, this->geometry->nodes[cell].y);
+	}
+};
+
+#endif
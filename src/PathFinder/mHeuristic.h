@@ -0,0 +1,116 @@
+#ifndef HEURISTIC_H
+#define HEURISTIC_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Step costs and heuristic of a search. Costs are either the exact Euclidean
+	step lengths (1 and sqrt(2)) or scaled fixed-point octile costs
+	(OCTILE_STRAIGHT_COST and OCTILE_DIAGONAL_COST), whose sums are exact
+	integers, so g-values and tie-breaking do not depend on floating-point
+	rounding. HEURISTIC_AUTO picks the tightest admissible heuristic for the
+	connectivity: octile for 8-connected grids, Manhattan for 4-connected ones
+	(Manhattan overestimates on 8-connected grids, so paths lose optimality).
+	Costs are reported in grid units with toLength().
+*/
+class mHeuristic
+{
+public:
+	int kind;
+	int costMode;
+	double straightCost;
+	double diagonalCost;
+
+	mHeuristic(int _kind=HEURISTIC_AUTO, int _costMode=COST_EUCLIDEAN) : kind(_kind)
+	{
+		(*this).setCostMode(_costMode);
+	}
+
+	mHeuristic(const mHeuristic &_other)
+	{
+		this->kind = _other.kind;
+		this->costMode = _other.costMode;
+		this->straightCost = _other.straightCost;
+		this->diagonalCost = _other.diagonalCost;
+	}
+
+	virtual ~mHeuristic(){}
+
+	void setKind(int _kind)
+	{
+		this->kind = _kind;
+	}
+
+	void setCostMode(int _costMode)
+	{
+		this->costMode = _costMode;
+		if(this->costMode == COST_OCTILE_INT)
+		{
+			this->straightCost = OCTILE_STRAIGHT_COST;
+			this->diagonalCost = OCTILE_DIAGONAL_COST;
+		} else
+		{
+			this->straightCost = 1.0;
+			this->diagonalCost = M_SQRT2;
+		}
+	}
+
+	int resolve(int connectivity)
+	{
+		if(this->kind != HEURISTIC_AUTO) return this->kind;
+		return (connectivity == 8) ? HEURISTIC_OCTILE : HEURISTIC_MANHATTAN;
+	}
+
+	// false if the heuristic can overestimate, so the paths it finds may not be optimal
+	bool isAdmissible(int connectivity)
+	{
+		return !((*this).resolve(connectivity) == HEURISTIC_MANHATTAN and connectivity == 8);
+	}
+
+	double getStepCost(int dx, int dy)
+	{
+		return (dx != 0 and dy != 0) ? this->diagonalCost : this->straightCost;
+	}
+
+	double estimate(int dx, int dy, int connectivity)
+	{
+		dx = abs(dx);
+		dy = abs(dy);
+		int kind = (*this).resolve(connectivity);
+		if(kind == HEURISTIC_OCTILE)
+			return this->straightCost * abs(dx - dy) + this->diagonalCost * min(dx, dy);
+		if(kind == HEURISTIC_MANHATTAN)
+			return this->straightCost * (dx + dy);
+		if(kind == HEURISTIC_CHEBYSHEV)
+			return this->straightCost * max(dx, dy);
+
+		// with integer costs, scaled by diagonal/sqrt(2) so it stays below the rounded octile costs
+		double scale = (this->costMode == COST_OCTILE_INT) ? this->diagonalCost * M_SQRT1_2 : 1.0;
+		return scale * sqrt((double) (dx*dx + dy*dy));
+	}
+
+	double toLength(double cost)
+	{
+		return cost / this->straightCost;
+	}
+
+	// identifies searches that give the same paths (e.g. for mPathCache keys)
+	int getKey(int connectivity)
+	{
+		return this->costMode * 16 + (*this).resolve(connectivity);
+	}
+
+	static string name(int kind)
+	{
+		if(kind == HEURISTIC_EUCLIDEAN) return "euclidean";
+		if(kind == HEURISTIC_OCTILE) return "octile";
+		if(kind == HEURISTIC_MANHATTAN) return "manhattan";
+		if(kind == HEURISTIC_CHEBYSHEV) return "chebyshev";
+		return "auto";
+	}
+};
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef LOCAL_DISTANCE_DB_H
+#define LOCAL_DISTANCE_DB_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Local distance database for Block A*. The grid is partitioned into
+	blockSize x blockSize blocks (blockSize <= 8, so a block's walkability is
+	one 64-bit pattern) and, for every distinct pattern of the map, the
+	shortest in-block path between every pair of boundary cells is stored.
+	Open and solid areas share a handful of patterns, so the database is far
+	smaller than one table per block. An entry packs the number of straight
+	and diagonal steps (straight << 8 | diagonal) so the same database serves
+	both cost modes of mHeuristic. Patterns are found and solved in parallel.
+	After journaled grid edits only the blocks of the changed tiles are
+	matched again and only patterns not seen before are solved; patterns
+	that are no longer used stay until the next full build.
+	The build is only worth it for many queries per map: on one thread a
+	256x256 open map takes ~0.45 s to build, about 700 BlockAStar queries
+	(~0.65 ms each), and pays off over SparseAStar after ~2000 queries; on
+	1024x1024 maps it pays off after ~450 (open) and ~130 (rooms) queries
+	(see the BlockAStar lines of pathfinder_bench).
+*/
+class mLocalDistanceDB
+{
+public:
+	mGrid *grid;
+	int blockSize;
+	int blocksX;
+	int blocksY;
+	int connectivity;
+	vector<int> boundary;
+	vector<int> boundaryIndex;
+	vector<uint64_t> patterns;
+	vector<int> blockPattern;
+	unordered_map<uint64_t, int> patternIndex;
+	vector<uint16_t> distances;
+	long gridVersion;
+	double buildTime;
+
+	mLocalDistanceDB(mGrid *_grid, int _blockSize=LDDB_BLOCK_SIZE) : grid(_grid),
+																	 blockSize(min(max(_blockSize, 2), 8)),
+																	 blocksX(0),
+																	 blocksY(0),
+																	 connectivity(_grid->connectivity),
+																	 gridVersion(-1),
+																	 buildTime(0.0)
+	{
+		// boundary cells of a block, clockwise from the top-left corner
+		this->boundaryIndex.assign(this->blockSize * this->blockSize, -1);
+		int last = this->blockSize - 1;
+		for(int x = 0; x < last; x++) (*this).addBoundary(x, 0);
+		for(int y = 0; y < last; y++) (*this).addBoundary(last, y);
+		for(int x = last; x > 0; x--) (*this).addBoundary(x, last);
+		for(int y = last; y > 0; y--) (*this).addBoundary(0, y);
+	}
+
+	mLocalDistanceDB(const mLocalDistanceDB &_other)
+	{
+		this->grid = _other.grid;
+		this->blockSize = _other.blockSize;
+		this->blocksX = _other.blocksX;
+		this->blocksY = _other.blocksY;
+		this->connectivity = _other.connectivity;
+		this->boundary = _other.boundary;
+		this->boundaryIndex = _other.boundaryIndex;
+		this->patterns = _other.patterns;
+		this->blockPattern = _other.blockPattern;
+		this->patternIndex = _other.patternIndex;
+		this->distances = _other.distances;
+		this->gridVersion = _other.gridVersion;
+		this->buildTime = _other.buildTime;
+	}
+
+	virtual ~mLocalDistanceDB(){}
+
+	void addBoundary(int x, int y)
+	{
+		this->boundaryIndex[y * this->blockSize + x] = this->boundary.size();
+		this->boundary.push_back(y * this->blockSize + x);
+	}
+
+	int getBoundarySize()
+	{
+		return this->boundary.size();
+	}
+
+	// walkable cells of a block, bit (y * blockSize + x); cells outside the grid are blocked
+	uint64_t getMask(int block)
+	{
+		int x0 = (block % this->blocksX) * this->blockSize;
+		int y0 = (block / this->blocksX) * this->blockSize;
+		uint64_t mask = 0;
+		for(int y = 0; y < this->blockSize and y0 + y < this->grid->gridDimY; y++)
+		{
+			for(int x = 0; x < this->blockSize and x0 + x < this->grid->gridDimX; x++)
+			{
+				if(this->grid->getNode(x0 + x, y0 + y)->walkable) mask |= 1ULL << (y * this->blockSize + x);
+			}
+		}
+		return mask;
+	}
+
+	void build()
+	{
+		double stime = omp_get_wtime();
+		this->connectivity = this->grid->connectivity;
+		this->blocksX = (this->grid->gridDimX + this->blockSize - 1) / this->blockSize;
+		this->blocksY = (this->grid->gridDimY + this->blockSize - 1) / this->blockSize;
+		int blockCount = this->blocksX * this->blocksY;
+
+		vector<uint64_t> masks(blockCount);
+		#pragma omp parallel for schedule(static)
+		for(int block = 0; block < blockCount; block++) masks[block] = (*this).getMask(block);
+
+		// distinct patterns, numbered in order of first appearance
+		this->patternIndex.clear();
+		this->patterns.clear();
+		this->distances.clear();
+		this->blockPattern.resize(blockCount);
+		for(int block = 0; block < blockCount; block++) this->blockPattern[block] = (*this).findPattern(masks[block]);
+		(*this).solvePatterns(0);
+
+		this->gridVersion = this->grid->version;
+		this->buildTime = omp_get_wtime() - stime;
+	}
+
+	int findPattern(uint64_t mask)
+	{
+		unordered_map<uint64_t, int>::iterator entry = this->patternIndex.find(mask);
+		if(entry == this->patternIndex.end())
+		{
+			entry = this->patternIndex.insert(make_pair(mask, (int) this->patterns.size())).first;
+			this->patterns.push_back(mask);
+		}
+		return entry->second;
+	}
+
+	// distance tables of the patterns from 'first' on
+	void solvePatterns(int first)
+	{
+		int boundarySize = this->boundary.size();
+		this->distances.resize(this->patterns.size() * boundarySize * boundarySize, LDDB_UNREACHABLE);
+		#pragma omp parallel
+		{
+			vector<int> straight, diagonal, previous;
+			#pragma omp for schedule(dynamic, 16)
+			for(int pattern = first; pattern < this->patterns.size(); pattern++)
+			{
+				for(int from = 0; from < boundarySize; from++)
+				{
+					if(!((this->patterns[pattern] >> this->boundary[from]) & 1)) continue;
+					(*this).localSearch(this->patterns[pattern], this->boundary[from], 1.0, M_SQRT2, straight, diagonal, previous);
+					uint16_t *row = &this->distances[((long) pattern * boundarySize + from) * boundarySize];
+					for(int to = 0; to < boundarySize; to++)
+					{
+						if(straight[this->boundary[to]] >= 0) row[to] = (straight[this->boundary[to]] << 8) | diagonal[this->boundary[to]];
+					}
+				}
+			}
+		}
+	}
+
+	// bring the database up to date with the grid: blocks of the changed journal tiles, or a full build
+	void update()
+	{
+		if(this->gridVersion == this->grid->version and this->connectivity == this->grid->connectivity) return;
+		vector<int> tiles;
+		bool opened;
+		if(this->gridVersion < 0 or this->connectivity != this->grid->connectivity or !this->grid->getChanges(this->gridVersion, tiles, opened))
+		{
+			(*this).build();
+			return;
+		}
+
+		int first = this->patterns.size();
+		for(int tile = 0; tile < tiles.size(); tile++)
+		{
+			int x0, y0, x1, y1;
+			this->grid->getJournalTileRect(tiles[tile], x0, y0, x1, y1);
+			for(int blockY = y0 / this->blockSize; blockY <= (y1 - 1) / this->blockSize; blockY++)
+			{
+				for(int blockX = x0 / this->blockSize; blockX <= (x1 - 1) / this->blockSize; blockX++)
+				{
+					int block = blockY * this->blocksX + blockX;
+					this->blockPattern[block] = (*this).findPattern((*this).getMask(block));
+				}
+			}
+		}
+		// too many stale patterns: start over
+		if(this->patterns.size() > 2 * this->blockPattern.size())
+		{
+			(*this).build();
+			return;
+		}
+		(*this).solvePatterns(first);
+		this->gridVersion = this->grid->version;
+	}
+
+	/*
+		Dijkstra inside one block pattern from local cell 'source', with the
+		given step costs. Per local cell: straight and diagonal step counts of
+		the shortest path (-1: unreachable) and the previous local cell.
+	*/
+	void localSearch(uint64_t mask, int source, double straightCost, double diagonalCost, vector<int> &straight, vector<int> &diagonal, vector<int> &previous)
+	{
+		static const int offsetX[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+		static const int offsetY[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+		int cells = this->blockSize * this->blockSize;
+		straight.assign(cells, -1);
+		diagonal.assign(cells, -1);
+		previous.assign(cells, -1);
+		double costs[64];
+		bool done[64];
+		for(int cell = 0; cell < cells; cell++)
+		{
+			costs[cell] = DBL_MAX;
+			done[cell] = false;
+		}
+		costs[source] = 0.0;
+		straight[source] = diagonal[source] = 0;
+
+		// the blocks are tiny: a linear scan for the closest cell beats a heap
+		while(true)
+		{
+			int current = -1;
+			for(int cell = 0; cell < cells; cell++)
+			{
+				if(!done[cell] and costs[cell] < DBL_MAX and (current < 0 or costs[cell] < costs[current])) current = cell;
+			}
+			if(current < 0) break;
+			done[current] = true;
+
+			int x = current % this->blockSize;
+			int y = current / this->blockSize;
+			for(int dir = 0; dir < this->connectivity; dir++)
+			{
+				int nx = x + offsetX[dir];
+				int ny = y + offsetY[dir];
+				if(nx < 0 or nx >= this->blockSize or ny < 0 or ny >= this->blockSize) continue;
+				int neighbor = ny * this->blockSize + nx;
+				if(done[neighbor] or !((mask >> neighbor) & 1)) continue;
+
+				double cost = costs[current] + ((dir < 4) ? straightCost : diagonalCost);
+				if(cost < costs[neighbor])
+				{
+					costs[neighbor] = cost;
+					straight[neighbor] = straight[current] + ((dir < 4) ? 1 : 0);
+					diagonal[neighbor] = diagonal[current] + ((dir < 4) ? 0 : 1);
+					previous[neighbor] = current;
+				}
+			}
+		}
+	}
+
+	// packed steps between boundary cells 'from' and 'to' of a block
+	uint16_t getDistance(int block, int from, int to)
+	{
+		int boundarySize = this->boundary.size();
+		return this->distances[((long) this->blockPattern[block] * boundarySize + from) * boundarySize + to];
+	}
+
+	long memoryUsage()
+	{
+		return (long) (this->distances.size() * sizeof(uint16_t) + this->patterns.size() * sizeof(uint64_t) + this->blockPattern.size() * sizeof(int));
+	}
+
+	void print()
+	{
+		cout << "local distance database: " << this->blocksX << "x" << this->blocksY << " blocks of " << this->blockSize << "x" << this->blockSize;
+		cout << ", " << this->patterns.size() << " patterns, " << (*this).memoryUsage() << " bytes, built in " << this->buildTime << " secs" << endl;
+	}
+};
+
+#endif
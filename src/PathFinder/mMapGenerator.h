@@ -0,0 +1,284 @@
+#ifndef MAP_GENERATOR_H
+#define MAP_GENERATOR_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Seeded synthetic maps at a target obstacle density (fraction of blocked
+	cells). Random numbers come from mRandom, so per-cell work runs in
+	parallel with OpenMP and a seed gives the same map on any machine and
+	number of threads.
+	  MAP_UNIFORM  independent noise per cell
+	  MAP_MAZE     depth-first maze with corridors 'featureSize' cells wide;
+	               walls are opened (or cells blocked) until the density is met
+	  MAP_ROOMS    rectangular rooms joined by L-shaped corridors, carved until
+	               the free fraction is met
+	  MAP_POROUS   overlapping circular grains of radius 'featureSize'
+	               (Boolean model), like a porous rock sample
+*/
+class mMapGenerator
+{
+public:
+	int type;
+	double density;
+	uint64_t seed;
+	int featureSize;
+	double generationTime;
+
+	mMapGenerator(int _type=MAP_UNIFORM, double _density=OBSTACLES_RATE, uint64_t _seed=MAP_DEFAULT_SEED, int _featureSize=4) : type(_type),
+																															 density(_density),
+																															 seed(_seed),
+																															 featureSize(max(1, _featureSize)),
+																															 generationTime(0.0)
+	{}
+
+	mMapGenerator(const mMapGenerator &_other)
+	{
+		this->type = _other.type;
+		this->density = _other.density;
+		this->seed = _other.seed;
+		this->featureSize = _other.featureSize;
+		this->generationTime = _other.generationTime;
+	}
+
+	virtual ~mMapGenerator(){}
+
+	void setSeed(uint64_t _seed)
+	{
+		this->seed = _seed;
+	}
+
+	void setDensity(double _density)
+	{
+		this->density = _density;
+	}
+
+	void setFeatureSize(int _size)
+	{
+		this->featureSize = max(1, _size);
+	}
+
+	mGrid *generate(int dimX, int dimY)
+	{
+		mGrid *grid = new mGrid(dimX, dimY, true);
+		(*this).fill(grid);
+		return grid;
+	}
+
+	// overwrite the walkability of every cell of 'grid'
+	void fill(mGrid *grid)
+	{
+		double stime = omp_get_wtime();
+		if(this->type == MAP_MAZE) (*this).fillMaze(grid);
+		else if(this->type == MAP_ROOMS) (*this).fillRooms(grid);
+		else if(this->type == MAP_POROUS) (*this).fillPorous(grid);
+		else (*this).fillUniform(grid, this->seed, this->density);
+		grid->markAllChanged();
+		this->generationTime = omp_get_wtime() - stime;
+	}
+
+	// random numbers are drawn by row-major position, so a seed gives the same map in any grid layout
+	void fillUniform(mGrid *grid, uint64_t streamSeed, double blockedFraction)
+	{
+		#pragma omp parallel for
+		for(int cell = 0; cell < grid->gridSize; cell++)
+			grid->nodes[cell].walkable = (mRandom::uniform(streamSeed, grid->getRowMajorIdx(cell)) >= blockedFraction);
+	}
+
+	void fillMaze(mGrid *grid)
+	{
+		(*this).setAll(grid, false);
+
+		// maze over a lattice of rooms 'featureSize' wide separated by 1-cell walls
+		int pitch = this->featureSize + 1;
+		int roomsX = max(1, (grid->gridDimX - 1) / pitch);
+		int roomsY = max(1, (grid->gridDimY - 1) / pitch);
+		vector<char> visited(roomsX * roomsY, 0);
+		vector<int> stack;
+		uint64_t walkSeed = mRandom::stream(this->seed, 1);
+		uint64_t counter = 0;
+
+		stack.push_back(0);
+		visited[0] = 1;
+		(*this).carve(grid, 1, 1, this->featureSize, this->featureSize);
+		while(stack.size() > 0)
+		{
+			int room = stack.back();
+			int rx = room % roomsX;
+			int ry = room / roomsX;
+			int candidates[4];
+			int count = 0;
+			if(rx > 0 and !visited[room - 1]) candidates[count++] = room - 1;
+			if(rx + 1 < roomsX and !visited[room + 1]) candidates[count++] = room + 1;
+			if(ry > 0 and !visited[room - roomsX]) candidates[count++] = room - roomsX;
+			if(ry + 1 < roomsY and !visited[room + roomsX]) candidates[count++] = room + roomsX;
+			if(count == 0)
+			{
+				stack.pop_back();
+				continue;
+			}
+
+			int next = candidates[mRandom::uniformInt(walkSeed, counter++, count)];
+			int nx = next % roomsX;
+			int ny = next / roomsX;
+			visited[next] = 1;
+			stack.push_back(next);
+
+			// the next room and the wall between both rooms
+			(*this).carve(grid, 1 + nx * pitch, 1 + ny * pitch, this->featureSize, this->featureSize);
+			(*this).carve(grid, 1 + min(rx, nx) * pitch, 1 + min(ry, ny) * pitch,
+						  (nx != rx) ? 2 * this->featureSize + 1 : this->featureSize,
+						  (ny != ry) ? 2 * this->featureSize + 1 : this->featureSize);
+		}
+
+		(*this).adjustDensity(grid, mRandom::stream(this->seed, 2));
+	}
+
+	void fillRooms(mGrid *grid)
+	{
+		(*this).setAll(grid, false);
+		uint64_t roomSeed = mRandom::stream(this->seed, 3);
+		uint64_t counter = 0;
+		long freeTarget = (long) ((1.0 - this->density) * grid->gridSize);
+		long freeCells = 0;
+		int minSide = max(2, this->featureSize);
+		int maxSide = max(minSide + 1, 4 * this->featureSize);
+		int lastX = -1, lastY = -1;
+
+		for(int attempt = 0; attempt < MAP_MAX_ROOMS and freeCells < freeTarget; attempt++)
+		{
+			int width = min(grid->gridDimX, minSide + mRandom::uniformInt(roomSeed, counter++, maxSide - minSide));
+			int height = min(grid->gridDimY, minSide + mRandom::uniformInt(roomSeed, counter++, maxSide - minSide));
+			int x = mRandom::uniformInt(roomSeed, counter++, grid->gridDimX - width + 1);
+			int y = mRandom::uniformInt(roomSeed, counter++, grid->gridDimY - height + 1);
+			freeCells += (*this).carve(grid, x, y, width, height);
+
+			// L-shaped corridor from the previous room's center
+			int centerX = x + width / 2;
+			int centerY = y + height / 2;
+			if(lastX >= 0)
+			{
+				freeCells += (*this).carve(grid, min(lastX, centerX), lastY, abs(centerX - lastX) + 1, 1);
+				freeCells += (*this).carve(grid, centerX, min(lastY, centerY), 1, abs(centerY - lastY) + 1);
+			}
+			lastX = centerX;
+			lastY = centerY;
+		}
+	}
+
+	void fillPorous(mGrid *grid)
+	{
+		(*this).setAll(grid, true);
+		int radius = this->featureSize;
+		if(this->density <= 0.0) return;
+
+		// Boolean model: coverage = 1 - exp(-grains * area of a grain / area of the map)
+		double coverage = min(this->density, 0.999);
+		long grains = (long) ceil(-log(1.0 - coverage) * grid->gridSize / (M_PI * radius * radius));
+		uint64_t grainSeed = mRandom::stream(this->seed, 4);
+
+		// grains sorted into bands of rows, so that each row only tests nearby grains
+		int bandHeight = 2 * radius + 1;
+		int bands = grid->gridDimY / bandHeight + 1;
+		vector<vector<int> > bandGrains(bands);
+		vector<int> centersX(grains), centersY(grains);
+		for(long grain = 0; grain < grains; grain++)
+		{
+			centersX[grain] = mRandom::uniformInt(grainSeed, 2*grain, grid->gridDimX);
+			centersY[grain] = mRandom::uniformInt(grainSeed, 2*grain + 1, grid->gridDimY);
+			bandGrains[centersY[grain] / bandHeight].push_back(grain);
+		}
+
+		#pragma omp parallel for schedule(dynamic, 4)
+		for(int y = 0; y < grid->gridDimY; y++)
+		{
+			int firstBand = max(0, (y - radius) / bandHeight);
+			int lastBand = min(bands - 1, (y + radius) / bandHeight);
+			for(int band = firstBand; band <= lastBand; band++)
+			{
+				for(int entry = 0; entry < bandGrains[band].size(); entry++)
+				{
+					int grain = bandGrains[band][entry];
+					int dy = y - centersY[grain];
+					if(abs(dy) > radius) continue;
+					int halfWidth = (int) sqrt((double) (radius * radius - dy * dy));
+					for(int x = max(0, centersX[grain] - halfWidth); x <= min(grid->gridDimX - 1, centersX[grain] + halfWidth); x++)
+						grid->nodes[grid->getNodeIdx(x, y)].walkable = false;
+				}
+			}
+		}
+	}
+
+	// open random blocked cells (or block random free ones) to get close to the target density
+	void adjustDensity(mGrid *grid, uint64_t streamSeed)
+	{
+		double current = (*this).getDensity(grid);
+		if(current > this->density)
+		{
+			double openRate = (current - this->density) / current;
+			#pragma omp parallel for
+			for(int cell = 0; cell < grid->gridSize; cell++)
+			{
+				if(!grid->nodes[cell].walkable and mRandom::uniform(streamSeed, grid->getRowMajorIdx(cell)) < openRate)
+					grid->nodes[cell].walkable = true;
+			}
+		} else
+		if(current < this->density)
+		{
+			double blockRate = (this->density - current) / (1.0 - current);
+			#pragma omp parallel for
+			for(int cell = 0; cell < grid->gridSize; cell++)
+			{
+				if(grid->nodes[cell].walkable and mRandom::uniform(streamSeed, grid->getRowMajorIdx(cell)) < blockRate)
+					grid->nodes[cell].walkable = false;
+			}
+		}
+	}
+
+	// free a rectangle (clipped to the grid), returns the number of newly freed cells
+	long carve(mGrid *grid, int x, int y, int width, int height)
+	{
+		long freed = 0;
+		for(int cy = max(0, y); cy < min(grid->gridDimY, y + height); cy++)
+		{
+			for(int cx = max(0, x); cx < min(grid->gridDimX, x + width); cx++)
+			{
+				mNode &node = grid->nodes[grid->getNodeIdx(cx, cy)];
+				if(!node.walkable) freed++;
+				node.walkable = true;
+			}
+		}
+		return freed;
+	}
+
+	void setAll(mGrid *grid, bool walkable)
+	{
+		#pragma omp parallel for
+		for(int cell = 0; cell < grid->gridSize; cell++)
+			grid->nodes[cell].walkable = walkable;
+	}
+
+	double getDensity(mGrid *grid)
+	{
+		long blocked = 0;
+		#pragma omp parallel for reduction(+:blocked)
+		for(int cell = 0; cell < grid->gridSize; cell++)
+		{
+			if(!grid->nodes[cell].walkable) blocked++;
+		}
+		return (double) blocked / grid->gridSize;
+	}
+
+	static string typeName(int type)
+	{
+		if(type == MAP_MAZE) return "maze";
+		if(type == MAP_ROOMS) return "rooms";
+		if(type == MAP_POROUS) return "porous";
+		return "uniform";
+	}
+};
+
+#endif
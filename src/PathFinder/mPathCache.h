@@ -0,0 +1,336 @@
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Bounded LRU cache of optimal paths on one mGrid, keyed by (start, goal,
+	connectivity, heuristic and cost mode, grid version). Any sub-path of an
+	optimal path is optimal too, so a query whose endpoints both lie on a
+	cached path (in either order, moves are symmetric) is answered from it.
+	Entries are checked against the grid version before every lookup. If the
+	edits since the last check only blocked cells, paths that stay clear of
+	the changed journal tiles keep their cost and are still optimal, so only
+	the entries crossing those tiles are dropped; an edit that opened a cell
+	(or one the mGrid journal no longer covers) drops the whole cache.
+*/
+class mPathCache
+{
+public:
+	struct CacheEntry
+	{
+		int start;
+		int goal;
+		int connectivity;
+		int heuristic;
+		vector<int> cells;
+		list<int>::iterator lruPosition;
+		bool used;
+	};
+
+	struct CellRef
+	{
+		int entry;
+		int position;
+	};
+
+	mGrid *grid;
+	int capacity;
+	long cachedVersion;
+	vector<CacheEntry> entries;
+	vector<int> freeEntries;
+	list<int> lruOrder;
+	map<pair<pair<int, int>, pair<int, int> >, int> keyIndex;
+	unordered_map<int, vector<CellRef> > cellIndex;
+	vector<int> scratch;
+	long hits;
+	long subPathHits;
+	long misses;
+	long evictions;
+	long invalidations;
+	long storedCells;
+
+	mPathCache(mGrid *_grid, int _capacity=PATH_CACHE_SIZE) : grid(_grid),
+															  capacity(_capacity),
+															  cachedVersion(_grid->version),
+															  hits(0),
+															  subPathHits(0),
+															  misses(0),
+															  evictions(0),
+															  invalidations(0),
+															  storedCells(0)
+	{
+		this->entries.resize(this->capacity);
+		for(int entry = this->capacity - 1; entry >= 0; entry--)
+		{
+			this->entries[entry].used = false;
+			this->freeEntries.push_back(entry);
+		}
+	}
+
+	mPathCache(const mPathCache &_other)
+	{
+		this->grid = _other.grid;
+		this->capacity = _other.capacity;
+		this->cachedVersion = _other.cachedVersion;
+		this->entries = _other.entries;
+		this->freeEntries = _other.freeEntries;
+		this->keyIndex = _other.keyIndex;
+		this->cellIndex = _other.cellIndex;
+		this->hits = _other.hits;
+		this->subPathHits = _other.subPathHits;
+		this->misses = _other.misses;
+		this->evictions = _other.evictions;
+		this->invalidations = _other.invalidations;
+		this->storedCells = _other.storedCells;
+
+		// list iterators can not be copied across lists, rebuild the LRU order
+		list<int>::const_iterator it;
+		for(it = _other.lruOrder.begin(); it != _other.lruOrder.end(); it++)
+		{
+			this->lruOrder.push_back(*it);
+			this->entries[*it].lruPosition = --this->lruOrder.end();
+		}
+	}
+
+	virtual ~mPathCache(){}
+
+	/*
+		Answer a query from the cache, or run the engine and store its path.
+		Returns false if there is no path. Partial results of a search stopped
+		by mSearchLimits are returned but never cached, and searches confined
+		to a bounding box or a mSearchFilter, or run with an inadmissible
+		heuristic, bypass the cache altogether: their paths are not the
+		optimal ones the cache promises. The AStar is run
+		without its verbose output, which would stop on the canvas.
+	*/
+	bool findPath(AStar *aStar, int startX, int startY, int endX, int endY, mPathResult &result)
+	{
+		int heuristic = aStar->heuristic.getKey(this->grid->connectivity);
+		bool cacheable = (!aStar->limits.useBox and aStar->heuristic.isAdmissible(this->grid->connectivity));
+		result.setCostMode(aStar->heuristic.costMode);
+		if(cacheable and (*this).lookup(startX, startY, endX, endY, heuristic, result)) return true;
+
+		bool verbose = aStar->verbose;
+		aStar->setVerbose(false);
+		aStar->setStartNode(startX, startY);
+		aStar->setEndNode(endX, endY);
+		aStar->findPath();
+		aStar->setVerbose(verbose);
+		return (*this).storeResult(aStar, startX, startY, endX, endY, heuristic, cacheable, result);
+	}
+
+	bool findPath(SparseAStar *sparseAStar, int startX, int startY, int endX, int endY, mPathResult &result)
+	{
+		int heuristic = sparseAStar->heuristic.getKey(this->grid->connectivity);
+		bool cacheable = (!sparseAStar->limits.useBox and sparseAStar->filter == NULL and sparseAStar->heuristic.isAdmissible(this->grid->connectivity));
+		result.setCostMode(sparseAStar->heuristic.costMode);
+		if(cacheable and (*this).lookup(startX, startY, endX, endY, heuristic, result)) return true;
+
+		sparseAStar->findPath(startX, startY, endX, endY);
+		return (*this).storeResult(sparseAStar, startX, startY, endX, endY, heuristic, cacheable, result);
+	}
+
+	template<class Engine>
+	bool storeResult(Engine *engine, int startX, int startY, int endX, int endY, int heuristic, bool cacheable, mPathResult &result)
+	{
+		if(engine->status != SEARCH_FOUND or !cacheable)
+		{
+			engine->extractPath(result);
+			return result.found;
+		}
+
+		// extract the full path into the cache's own buffer, then copy it out
+		if(this->scratch.size() == 0) this->scratch.resize(1024);
+		mPathResult full(this->scratch.data(), this->scratch.size(), PATH_CELLS);
+		engine->extractPath(full);
+		if(full.truncated)
+		{
+			this->scratch.resize(full.length);
+			full = mPathResult(this->scratch.data(), this->scratch.size(), PATH_CELLS);
+			engine->extractPath(full);
+		}
+
+		(*this).insert(this->grid->getNodeIdx(startX, startY), this->grid->getNodeIdx(endX, endY), heuristic, this->scratch.data(), full.length);
+		result.assign(this->grid, this->scratch.data(), full.length);
+		return true;
+	}
+
+	bool lookup(int startX, int startY, int endX, int endY, int heuristic, mPathResult &result)
+	{
+		(*this).checkVersion();
+		int start = this->grid->getNodeIdx(startX, startY);
+		int goal = this->grid->getNodeIdx(endX, endY);
+
+		// exact hit
+		map<pair<pair<int, int>, pair<int, int> >, int>::iterator found = this->keyIndex.find((*this).makeKey(start, goal, heuristic));
+		if(found != this->keyIndex.end())
+		{
+			CacheEntry &entry = this->entries[found->second];
+			(*this).touch(found->second);
+			result.assign(this->grid, entry.cells.data(), entry.cells.size());
+			this->hits++;
+			return true;
+		}
+
+		// sub-path hit: both endpoints on one cached path of the same kind
+		unordered_map<int, vector<CellRef> >::iterator startRefs = this->cellIndex.find(start);
+		unordered_map<int, vector<CellRef> >::iterator goalRefs = this->cellIndex.find(goal);
+		if(startRefs != this->cellIndex.end() and goalRefs != this->cellIndex.end())
+		{
+			for(int refA = 0; refA < startRefs->second.size(); refA++)
+			{
+				CellRef &startRef = startRefs->second[refA];
+				CacheEntry &entry = this->entries[startRef.entry];
+				if(entry.connectivity != this->grid->connectivity or entry.heuristic != heuristic) continue;
+
+				for(int refB = 0; refB < goalRefs->second.size(); refB++)
+				{
+					CellRef &goalRef = goalRefs->second[refB];
+					if(goalRef.entry != startRef.entry) continue;
+
+					int first = min(startRef.position, goalRef.position);
+					int last = max(startRef.position, goalRef.position);
+					(*this).touch(startRef.entry);
+					result.assign(this->grid, entry.cells.data() + first, last - first + 1, startRef.position > goalRef.position);
+					this->subPathHits++;
+					return true;
+				}
+			}
+		}
+
+		this->misses++;
+		return false;
+	}
+
+	void insert(int start, int goal, int heuristic, const int *cells, int count)
+	{
+		pair<pair<int, int>, pair<int, int> > key = (*this).makeKey(start, goal, heuristic);
+		if(this->keyIndex.find(key) != this->keyIndex.end()) return;
+		if(this->freeEntries.size() == 0) (*this).evict(this->lruOrder.back());
+
+		int slot = this->freeEntries.back();
+		this->freeEntries.pop_back();
+		CacheEntry &entry = this->entries[slot];
+		entry.start = start;
+		entry.goal = goal;
+		entry.connectivity = this->grid->connectivity;
+		entry.heuristic = heuristic;
+		entry.cells.assign(cells, cells + count);
+		entry.used = true;
+		this->lruOrder.push_front(slot);
+		entry.lruPosition = this->lruOrder.begin();
+		this->keyIndex[key] = slot;
+		this->storedCells += count;
+
+		for(int position = 0; position < count; position++)
+		{
+			CellRef ref = {slot, position};
+			this->cellIndex[cells[position]].push_back(ref);
+		}
+	}
+
+	void evict(int slot, bool countEviction=true)
+	{
+		CacheEntry &entry = this->entries[slot];
+		for(int position = 0; position < entry.cells.size(); position++)
+		{
+			vector<CellRef> &refs = this->cellIndex[entry.cells[position]];
+			for(int ref = 0; ref < refs.size(); ref++)
+			{
+				if(refs[ref].entry == slot)
+				{
+					refs[ref] = refs.back();
+					refs.pop_back();
+					break;
+				}
+			}
+			if(refs.size() == 0) this->cellIndex.erase(entry.cells[position]);
+		}
+
+		this->keyIndex.erase((*this).makeKey(entry.start, entry.goal, entry.heuristic));
+		this->lruOrder.erase(entry.lruPosition);
+		this->storedCells -= entry.cells.size();
+		vector<int>().swap(entry.cells);
+		entry.used = false;
+		this->freeEntries.push_back(slot);
+		if(countEviction) this->evictions++;
+	}
+
+	// drop the entries the grid edits since the last check may have made wrong or suboptimal
+	void checkVersion()
+	{
+		if(this->grid->version == this->cachedVersion) return;
+		vector<int> tiles;
+		bool opened;
+		if(!this->grid->getChanges(this->cachedVersion, tiles, opened) or opened)
+		{
+			(*this).clear();
+		} else
+		{
+			vector<uint8_t> dirty((long) this->grid->getJournalTilesX() * ((this->grid->gridDimY + GRID_JOURNAL_TILE_SIZE - 1) / GRID_JOURNAL_TILE_SIZE), 0);
+			for(int tile = 0; tile < tiles.size(); tile++) dirty[tiles[tile]] = 1;
+			for(int slot = 0; slot < this->capacity; slot++)
+			{
+				if(!this->entries[slot].used) continue;
+				vector<int> &cells = this->entries[slot].cells;
+				for(int position = 0; position < cells.size(); position++)
+				{
+					if(dirty[this->grid->getJournalTile(this->grid->nodes[cells[position]].x, this->grid->nodes[cells[position]].y)])
+					{
+						(*this).evict(slot, false);
+						break;
+					}
+				}
+			}
+		}
+		this->cachedVersion = this->grid->version;
+		this->invalidations++;
+	}
+
+	void clear()
+	{
+		for(int slot = 0; slot < this->capacity; slot++)
+		{
+			if(this->entries[slot].used) (*this).evict(slot, false);
+		}
+	}
+
+	void touch(int slot)
+	{
+		this->lruOrder.splice(this->lruOrder.begin(), this->lruOrder, this->entries[slot].lruPosition);
+	}
+
+	pair<pair<int, int>, pair<int, int> > makeKey(int start, int goal, int heuristic)
+	{
+		return make_pair(make_pair(start, goal), make_pair(this->grid->connectivity, heuristic));
+	}
+
+	double hitRate()
+	{
+		long queries = this->hits + this->subPathHits + this->misses;
+		if(queries == 0) return 0.0;
+		return (double) (this->hits + this->subPathHits) / queries;
+	}
+
+	// approximate bytes held by cached paths and the cell index
+	long memoryUsage()
+	{
+		return this->storedCells * (sizeof(int) + sizeof(CellRef)) +
+			   (long) this->cellIndex.size() * (sizeof(int) + sizeof(vector<CellRef>)) +
+			   (long) this->entries.size() * sizeof(CacheEntry);
+	}
+
+	void print()
+	{
+		cout << "path cache: " << this->lruOrder.size() << "/" << this->capacity << " entries, ";
+		cout << this->hits << " hits, " << this->subPathHits << " sub-path hits, " << this->misses << " misses ";
+		cout << "(hit rate " << (*this).hitRate() << "), " << this->evictions << " evictions, ";
+		cout << this->invalidations << " invalidations, " << (*this).memoryUsage() << " bytes" << endl;
+	}
+};
+
+#endif
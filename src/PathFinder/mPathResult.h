@@ -0,0 +1,312 @@
+#ifndef PATH_RESULT_H
+#define PATH_RESULT_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Path of a query written into a caller-supplied buffer of cell indices
+	(mGrid::getNodeIdx), so it stays valid after the next search reuses the
+	grid nodes. Extraction walks the parent chain twice (count, then fill
+	from the back) and never allocates. Encodings:
+	  PATH_CELLS      every cell from start to end
+	  PATH_WAYPOINTS  start, every cell where the direction changes, and end
+	  PATH_RUN_LENGTH start cell followed by (direction << 24 | run) entries,
+	                  where direction = (dy+1)*3 + (dx+1)
+	Waypoints and run-length assume consecutive cells are grid neighbors.
+	The cost is summed with the step costs of the engine's cost model, so it
+	is the value getPathCost() reports.
+*/
+class mPathResult
+{
+public:
+	int *buffer;
+	int capacity;
+	int encoding;
+	int length;
+	int steps;
+	double cost;
+	int costMode;
+	bool found;
+	bool partial;
+	bool truncated;
+
+	mPathResult(int *_buffer, int _capacity, int _encoding=PATH_CELLS) : buffer(_buffer),
+																		capacity(_capacity),
+																		encoding(_encoding),
+																		length(0),
+																		steps(0),
+																		cost(0.0),
+																		costMode(COST_EUCLIDEAN),
+																		found(false),
+																		partial(false),
+																		truncated(false)
+	{}
+
+	mPathResult(const mPathResult &_other)
+	{
+		this->buffer = _other.buffer;
+		this->capacity = _other.capacity;
+		this->encoding = _other.encoding;
+		this->length = _other.length;
+		this->steps = _other.steps;
+		this->cost = _other.cost;
+		this->costMode = _other.costMode;
+		this->found = _other.found;
+		this->partial = _other.partial;
+		this->truncated = _other.truncated;
+	}
+
+	virtual ~mPathResult(){}
+
+	void clear()
+	{
+		this->length = 0;
+		this->steps = 0;
+		this->cost = 0.0;
+		this->found = false;
+		this->partial = false;
+		this->truncated = false;
+	}
+
+	// cost model of 'cost' (COST_EUCLIDEAN or COST_OCTILE_INT); engines set theirs when extracting
+	void setCostMode(int _costMode)
+	{
+		this->costMode = _costMode;
+	}
+
+	// extract the chain of mNode::previous pointers ending at 'endNode'
+	int extract(mGrid *grid, mNode *endNode)
+	{
+		if(endNode == NULL)
+		{
+			(*this).clear();
+			return 0;
+		}
+
+		return (*this).extractChain(grid, grid->getNodeIdx(endNode->x, endNode->y), [grid](int index) -> int
+		{
+			mNode *previous = grid->nodes[index].getPrevious();
+			if(previous == NULL) return -1;
+			return grid->getNodeIdx(previous->x, previous->y);
+		});
+	}
+
+	// extract any parent chain, given as a function from cell index to parent index (-1 at the start)
+	template<class PreviousFunction>
+	int extractChain(mGrid *grid, int endIdx, PreviousFunction previous)
+	{
+		(*this).clear();
+		if(endIdx < 0) return 0;
+
+		// first pass: count entries of the chosen encoding and sum the exact cost
+		int entries = 1;
+		int lastDir = -1;
+		int current = endIdx;
+		int next = previous(current);
+		while(next >= 0)
+		{
+			int dir = (*this).getDirection(grid, next, current);
+			this->cost += (*this).getStepCost(grid, next, current);
+			this->steps++;
+			if(this->encoding == PATH_CELLS) entries++;
+			else if(dir != lastDir) entries++;
+			lastDir = dir;
+			current = next;
+			next = previous(current);
+		}
+		this->found = true;
+		this->length = entries;
+		if(entries > this->capacity)
+		{
+			// report the required size and leave the buffer untouched
+			this->truncated = true;
+			return entries;
+		}
+
+		// second pass: fill the buffer from the back
+		int position = entries - 1;
+		int run = 0;
+		lastDir = -1;
+		current = endIdx;
+		next = previous(current);
+		while(next >= 0)
+		{
+			int dir = (*this).getDirection(grid, next, current);
+			if(this->encoding == PATH_CELLS)
+			{
+				this->buffer[position--] = current;
+			} else
+			if(this->encoding == PATH_WAYPOINTS)
+			{
+				if(dir != lastDir) this->buffer[position--] = current;
+			} else
+			{
+				if(dir != lastDir and run > 0)
+				{
+					this->buffer[position--] = (lastDir << 24) | run;
+					run = 0;
+				}
+				run++;
+			}
+			lastDir = dir;
+			current = next;
+			next = previous(current);
+		}
+		if(this->encoding == PATH_RUN_LENGTH and run > 0) this->buffer[position--] = (lastDir << 24) | run;
+		this->buffer[position] = current;
+
+		return entries;
+	}
+
+	// store a path given as a forward array of cells, walked backwards if 'reversed'
+	int assign(mGrid *grid, const int *cells, int count, bool reversed=false)
+	{
+		(*this).clear();
+		if(count <= 0) return 0;
+
+		// first pass: count entries of the chosen encoding and sum the exact cost
+		int entries = 1;
+		int lastDir = -1;
+		for(int step = 1; step < count; step++)
+		{
+			int from = reversed ? cells[count - step] : cells[step - 1];
+			int to = reversed ? cells[count - step - 1] : cells[step];
+			int dir = (*this).getDirection(grid, from, to);
+			this->cost += (*this).getStepCost(grid, from, to);
+			if(this->encoding == PATH_CELLS or dir != lastDir) entries++;
+			lastDir = dir;
+		}
+		this->steps = count - 1;
+		this->found = true;
+		this->length = entries;
+		if(entries > this->capacity)
+		{
+			this->truncated = true;
+			return entries;
+		}
+
+		// second pass: fill the buffer from the front
+		int position = 0;
+		int run = 0;
+		lastDir = -1;
+		this->buffer[position++] = reversed ? cells[count - 1] : cells[0];
+		for(int step = 1; step < count; step++)
+		{
+			int from = reversed ? cells[count - step] : cells[step - 1];
+			int to = reversed ? cells[count - step - 1] : cells[step];
+			int dir = (*this).getDirection(grid, from, to);
+			if(this->encoding == PATH_CELLS)
+			{
+				this->buffer[position++] = to;
+			} else
+			if(this->encoding == PATH_WAYPOINTS)
+			{
+				if(dir != lastDir and lastDir >= 0) this->buffer[position++] = from;
+			} else
+			{
+				if(dir != lastDir and run > 0)
+				{
+					this->buffer[position++] = (lastDir << 24) | run;
+					run = 0;
+				}
+				run++;
+			}
+			lastDir = dir;
+		}
+		if(this->encoding == PATH_WAYPOINTS and count > 1) this->buffer[position++] = reversed ? cells[0] : cells[count - 1];
+		if(this->encoding == PATH_RUN_LENGTH and run > 0) this->buffer[position++] = (lastDir << 24) | run;
+
+		return entries;
+	}
+
+	// decode the stored path into every cell from start to end
+	int expand(mGrid *grid, int *cells, int _capacity)
+	{
+		if(!this->found or this->truncated) return 0;
+		if(this->encoding == PATH_CELLS)
+		{
+			if(this->length > _capacity) return 0;
+			copy(this->buffer, this->buffer + this->length, cells);
+			return this->length;
+		}
+
+		if(this->steps + 1 > _capacity) return 0;
+		int count = 0;
+		cells[count++] = this->buffer[0];
+		for(int entry = 1; entry < this->length; entry++)
+		{
+			int x = grid->nodes[cells[count - 1]].x;
+			int y = grid->nodes[cells[count - 1]].y;
+			if(this->encoding == PATH_WAYPOINTS)
+			{
+				int targetX = grid->nodes[this->buffer[entry]].x;
+				int targetY = grid->nodes[this->buffer[entry]].y;
+				int dx = (targetX > x) - (targetX < x);
+				int dy = (targetY > y) - (targetY < y);
+				while(x != targetX or y != targetY)
+				{
+					x += dx;
+					y += dy;
+					cells[count++] = grid->getNodeIdx(x, y);
+				}
+			} else
+			{
+				int dir = this->buffer[entry] >> 24;
+				int run = this->buffer[entry] & 0xFFFFFF;
+				for(int step = 0; step < run; step++)
+				{
+					x += dir % 3 - 1;
+					y += dir / 3 - 1;
+					cells[count++] = grid->getNodeIdx(x, y);
+				}
+			}
+		}
+		return count;
+	}
+
+	int getDirection(mGrid *grid, int fromIdx, int toIdx)
+	{
+		int dx = grid->nodes[toIdx].x - grid->nodes[fromIdx].x;
+		int dy = grid->nodes[toIdx].y - grid->nodes[fromIdx].y;
+		return (dy + 1) * 3 + (dx + 1);
+	}
+
+	// cost in the units of the engine's getPathCost (see mHeuristic::toLength)
+	double getStepCost(mGrid *grid, int fromIdx, int toIdx)
+	{
+		double dx = abs(grid->nodes[toIdx].x - grid->nodes[fromIdx].x);
+		double dy = abs(grid->nodes[toIdx].y - grid->nodes[fromIdx].y);
+		if(this->costMode == COST_OCTILE_INT)
+			return fabs(dx - dy) + min(dx, dy) * OCTILE_DIAGONAL_COST / OCTILE_STRAIGHT_COST;
+		return sqrt(dx*dx + dy*dy);
+	}
+
+	void print(mGrid *grid)
+	{
+		if(!this->found)
+		{
+			cout << "no path" << endl;
+			return;
+		}
+		if(this->partial) cout << "partial path, ";
+		cout << "steps: " << this->steps << ", cost: " << this->cost << ", entries: " << this->length;
+		if(this->truncated)
+		{
+			cout << " (buffer too small: " << this->capacity << ")" << endl;
+			return;
+		}
+		cout << endl;
+		for(int entry = 0; entry < this->length; entry++)
+		{
+			if(this->encoding == PATH_RUN_LENGTH and entry > 0)
+				cout << "dir " << (this->buffer[entry] >> 24) << " x" << (this->buffer[entry] & 0xFFFFFF) << endl;
+			else
+				cout << "(" << grid->nodes[this->buffer[entry]].x << ", " << grid->nodes[this->buffer[entry]].y << ")" << endl;
+		}
+	}
+};
+
+#endif
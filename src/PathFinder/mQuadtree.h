@@ -0,0 +1,340 @@
+#ifndef QUADTREE_H
+#define QUADTREE_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Region quadtree of a walkability map, for maps made of large uniform free
+	or blocked areas. The root covers the smallest power-of-two square around
+	the map (cells outside the map are blocked) and a square is split into
+	four only if it is mixed, which is read in O(1) from a summed-area table
+	of walkable cells that only exists while building. The tree can be built
+	from an mGrid or directly from an image, without creating an mNode per
+	pixel. A tree built from an mGrid remembers the grid version it was built
+	from and update() rebuilds it after edits (the quadtree shape can change
+	anywhere up to the root, so it is not repaired tile by tile); a tree
+	built from an image has no grid and never changes.
+
+	For searches (see QuadtreeAStar) every free leaf numbers its perimeter
+	cells clockwise from its top-left corner, and all perimeter cells of all
+	free leaves share one global numbering ('boundaryOffsets'). Inside a free
+	square the shortest path between two cells is a straight octile line, so
+	the perimeter cells that touch another free leaf ('portals') are the only
+	places a path changes leaves. The portals of every free leaf are also
+	listed once ('portalOffsets', 'portalPositions'), so crossing a leaf
+	does not scan its whole perimeter.
+*/
+class mQuadtree
+{
+public:
+	struct Node
+	{
+		int x;
+		int y;
+		int size;
+		int firstChild;
+		bool walkable;
+	};
+
+	mGrid *grid;
+	int gridDimX;
+	int gridDimY;
+	int rootSize;
+	int connectivity;
+	vector<Node> nodes;
+	vector<int> freeLeaves;
+	vector<int> leafSlot;
+	vector<long> boundaryOffsets;
+	vector<long> portalOffsets;
+	vector<int> portalPositions;
+	long freeCells;
+	long gridVersion;
+	double buildTime;
+
+	mQuadtree(mGrid *_grid) : grid(_grid),
+							  gridDimX(_grid->gridDimX),
+							  gridDimY(_grid->gridDimY),
+							  rootSize(1),
+							  connectivity(_grid->connectivity),
+							  freeCells(0),
+							  gridVersion(-1),
+							  buildTime(0.0)
+	{
+		(*this).update();
+	}
+
+	// the pixels of 'image' are read like mGrid::buildGridOfNodesFromImage reads them
+	mQuadtree(cv::Mat *image, int _connectivity=4) : grid(NULL),
+													 gridDimX(image->rows),
+													 gridDimY(image->cols),
+													 rootSize(1),
+													 connectivity(_connectivity),
+													 freeCells(0),
+													 gridVersion(-1),
+													 buildTime(0.0)
+	{
+		int channels = image->channels();
+		(*this).build([image, channels](int x, int y) -> bool
+		{
+			return image->ptr<uchar>(y)[x*channels] == GRID_WALKABLE_COLOR;
+		});
+	}
+
+	mQuadtree(const mQuadtree &_other)
+	{
+		this->grid = _other.grid;
+		this->gridDimX = _other.gridDimX;
+		this->gridDimY = _other.gridDimY;
+		this->rootSize = _other.rootSize;
+		this->connectivity = _other.connectivity;
+		this->nodes = _other.nodes;
+		this->freeLeaves = _other.freeLeaves;
+		this->leafSlot = _other.leafSlot;
+		this->boundaryOffsets = _other.boundaryOffsets;
+		this->portalOffsets = _other.portalOffsets;
+		this->portalPositions = _other.portalPositions;
+		this->freeCells = _other.freeCells;
+		this->gridVersion = _other.gridVersion;
+		this->buildTime = _other.buildTime;
+	}
+
+	virtual ~mQuadtree(){}
+
+	// rebuild from the grid after edits; a connectivity change only renumbers the portals
+	void update()
+	{
+		if(this->grid == NULL) return;
+		if(this->gridVersion == this->grid->version)
+		{
+			if(this->connectivity == this->grid->connectivity) return;
+			this->connectivity = this->grid->connectivity;
+			(*this).buildBoundaries();
+			return;
+		}
+
+		mGrid *source = this->grid;
+		this->gridDimX = source->gridDimX;
+		this->gridDimY = source->gridDimY;
+		this->connectivity = source->connectivity;
+		(*this).build([source](int x, int y) -> bool
+		{
+			return source->getNode(x, y)->walkable;
+		});
+		this->gridVersion = source->version;
+	}
+
+	template<class Walkable>
+	void build(Walkable walkable)
+	{
+		double stime = omp_get_wtime();
+		int dimX = this->gridDimX;
+		int dimY = this->gridDimY;
+		this->rootSize = 1;
+		while(this->rootSize < max(dimX, dimY)) this->rootSize *= 2;
+
+		// summed-area table: sums[(y + 1) * (dimX + 1) + x + 1] = walkable cells in [0, x] x [0, y]
+		vector<int> sums((long) (dimX + 1) * (dimY + 1), 0);
+		#pragma omp parallel for schedule(static)
+		for(int y = 0; y < dimY; y++)
+		{
+			int *row = &sums[(long) (y + 1) * (dimX + 1)];
+			for(int x = 0; x < dimX; x++) row[x + 1] = row[x] + (walkable(x, y) ? 1 : 0);
+		}
+		#pragma omp parallel for schedule(static)
+		for(int x = 1; x <= dimX; x++)
+		{
+			for(int y = 1; y <= dimY; y++) sums[(long) y * (dimX + 1) + x] += sums[(long) (y - 1) * (dimX + 1) + x];
+		}
+
+		// top-down, breadth first, so the four children of a node are consecutive
+		this->nodes.clear();
+		Node root = {0, 0, this->rootSize, -1, false};
+		this->nodes.push_back(root);
+		for(int index = 0; index < this->nodes.size(); index++)
+		{
+			Node node = this->nodes[index];
+			int x1 = min(node.x + node.size, dimX);
+			int y1 = min(node.y + node.size, dimY);
+			long count = 0;
+			if(node.x < dimX and node.y < dimY)
+			{
+				count = (long) sums[(long) y1 * (dimX + 1) + x1] - sums[(long) node.y * (dimX + 1) + x1] -
+						sums[(long) y1 * (dimX + 1) + node.x] + sums[(long) node.y * (dimX + 1) + node.x];
+			}
+			bool inside = (node.x + node.size <= dimX and node.y + node.size <= dimY);
+			if(count == 0 or (inside and count == (long) node.size * node.size))
+			{
+				this->nodes[index].walkable = (count > 0);
+				continue;
+			}
+
+			int half = node.size / 2;
+			this->nodes[index].firstChild = this->nodes.size();
+			for(int child = 0; child < 4; child++)
+			{
+				Node next = {node.x + (child & 1) * half, node.y + (child >> 1) * half, half, -1, false};
+				this->nodes.push_back(next);
+			}
+		}
+		this->nodes.shrink_to_fit();
+		(*this).buildBoundaries();
+		this->buildTime = omp_get_wtime() - stime;
+	}
+
+	// global numbering of the perimeter cells of free leaves, and the portals of every free leaf
+	void buildBoundaries()
+	{
+		this->freeLeaves.clear();
+		this->leafSlot.assign(this->nodes.size(), -1);
+		this->boundaryOffsets.assign(1, 0);
+		this->freeCells = 0;
+		for(int index = 0; index < this->nodes.size(); index++)
+		{
+			if(this->nodes[index].firstChild >= 0 or !this->nodes[index].walkable) continue;
+			this->leafSlot[index] = this->freeLeaves.size();
+			this->freeLeaves.push_back(index);
+			this->boundaryOffsets.push_back(this->boundaryOffsets.back() + mQuadtree::getPerimeter(this->nodes[index].size));
+			this->freeCells += (long) this->nodes[index].size * this->nodes[index].size;
+		}
+
+		static const int offsetX[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+		static const int offsetY[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+		vector<uint8_t> portals(this->boundaryOffsets.back(), 0);
+		this->portalOffsets.assign(this->freeLeaves.size() + 1, 0);
+		#pragma omp parallel for schedule(dynamic, 64)
+		for(int slot = 0; slot < this->freeLeaves.size(); slot++)
+		{
+			Node &leaf = this->nodes[this->freeLeaves[slot]];
+			int perimeter = mQuadtree::getPerimeter(leaf.size);
+			for(int position = 0; position < perimeter; position++)
+			{
+				int x, y;
+				(*this).getPerimeterCell(leaf, position, x, y);
+				for(int dir = 0; dir < this->connectivity; dir++)
+				{
+					int nx = x + offsetX[dir];
+					int ny = y + offsetY[dir];
+					if(nx >= leaf.x and nx < leaf.x + leaf.size and ny >= leaf.y and ny < leaf.y + leaf.size) continue;
+					if((*this).isWalkable(nx, ny))
+					{
+						portals[this->boundaryOffsets[slot] + position] = 1;
+						this->portalOffsets[slot + 1]++;
+						break;
+					}
+				}
+			}
+		}
+
+		// portal lists, as perimeter positions in clockwise order
+		for(int slot = 0; slot < this->freeLeaves.size(); slot++) this->portalOffsets[slot + 1] += this->portalOffsets[slot];
+		this->portalPositions.resize(this->portalOffsets.back());
+		#pragma omp parallel for schedule(dynamic, 64)
+		for(int slot = 0; slot < this->freeLeaves.size(); slot++)
+		{
+			long next = this->portalOffsets[slot];
+			for(long state = this->boundaryOffsets[slot]; state < this->boundaryOffsets[slot + 1]; state++)
+			{
+				if(portals[state]) this->portalPositions[next++] = state - this->boundaryOffsets[slot];
+			}
+		}
+	}
+
+	static int getPerimeter(int size)
+	{
+		return (size == 1) ? 1 : 4 * (size - 1);
+	}
+
+	// cell of perimeter position 'position' of a leaf, clockwise from the top-left corner
+	void getPerimeterCell(Node &leaf, int position, int &x, int &y)
+	{
+		int side = leaf.size - 1;
+		if(side == 0 or position < side)
+		{
+			x = leaf.x + position;
+			y = leaf.y;
+		} else
+		if(position < 2 * side)
+		{
+			x = leaf.x + side;
+			y = leaf.y + position - side;
+		} else
+		if(position < 3 * side)
+		{
+			x = leaf.x + 3 * side - position;
+			y = leaf.y + side;
+		} else
+		{
+			x = leaf.x;
+			y = leaf.y + 4 * side - position;
+		}
+	}
+
+	// perimeter position of a cell of a leaf (-1 for inner cells)
+	int getPerimeterPosition(Node &leaf, int x, int y)
+	{
+		int side = leaf.size - 1;
+		int dx = x - leaf.x;
+		int dy = y - leaf.y;
+		if(side == 0) return 0;
+		if(dy == 0 and dx < side) return dx;
+		if(dx == side and dy < side) return side + dy;
+		if(dy == side and dx > 0) return 3 * side - dx;
+		if(dx == 0 and dy > 0) return 4 * side - dy;
+		return -1;
+	}
+
+	// leaf holding a cell, found from the root (-1 outside the map)
+	int findLeaf(int x, int y)
+	{
+		if(x < 0 or x >= this->gridDimX or y < 0 or y >= this->gridDimY) return -1;
+		int index = 0;
+		while(this->nodes[index].firstChild >= 0)
+		{
+			int half = this->nodes[index].size / 2;
+			int child = ((x - this->nodes[index].x) >= half ? 1 : 0) + ((y - this->nodes[index].y) >= half ? 2 : 0);
+			index = this->nodes[index].firstChild + child;
+		}
+		return index;
+	}
+
+	bool contains(int index, int x, int y)
+	{
+		Node &node = this->nodes[index];
+		return (x >= node.x and x < node.x + node.size and y >= node.y and y < node.y + node.size);
+	}
+
+	bool isWalkable(int x, int y)
+	{
+		int leaf = (*this).findLeaf(x, y);
+		return (leaf >= 0 and this->nodes[leaf].walkable);
+	}
+
+	long countLeaves()
+	{
+		long leaves = 0;
+		for(int index = 0; index < this->nodes.size(); index++)
+		{
+			if(this->nodes[index].firstChild < 0) leaves++;
+		}
+		return leaves;
+	}
+
+	long memoryUsage()
+	{
+		return (long) (this->nodes.size() * (sizeof(Node) + sizeof(int)) + this->freeLeaves.size() * (sizeof(int) + 2 * sizeof(long)) +
+					   this->portalPositions.size() * sizeof(int));
+	}
+
+	void print()
+	{
+		cout << "quadtree: " << this->gridDimX << "x" << this->gridDimY << ", " << this->nodes.size() << " nodes, " << (*this).countLeaves() << " leaves (";
+		cout << this->freeLeaves.size() << " free, " << this->freeCells << " free cells), " << this->boundaryOffsets.back() << " perimeter cells (";
+		cout << this->portalPositions.size() << " portals), ";
+		cout << (*this).memoryUsage() << " bytes, built in " << this->buildTime << " secs" << endl;
+	}
+};
+
+#endif
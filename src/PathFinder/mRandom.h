@@ -0,0 +1,52 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Counter-based random numbers: the value for (seed, counter) is a hash of
+	both (SplitMix64 finalizer), with no state to share or advance. Threads
+	can draw the numbers of any cell in any order and a seed always gives the
+	same map, whatever the number of OpenMP threads.
+*/
+class mRandom
+{
+public:
+	static uint64_t hash(uint64_t seed, uint64_t counter)
+	{
+		uint64_t z = seed + 0x9E3779B97F4A7C15ull * (counter + 1);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	// uniform double in [0, 1)
+	static double uniform(uint64_t seed, uint64_t counter)
+	{
+		return (mRandom::hash(seed, counter) >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	// uniform integer in [0, range)
+	static int uniformInt(uint64_t seed, uint64_t counter, int range)
+	{
+		return (int) (mRandom::uniform(seed, counter) * range);
+	}
+
+	// independent stream of a seed (e.g. one per generation step)
+	static uint64_t stream(uint64_t seed, uint64_t id)
+	{
+		return mRandom::hash(seed ^ 0x5851F42D4C957F2Dull, id);
+	}
+
+	// nondeterministic seed, for callers that do not pass one
+	static uint64_t randomSeed()
+	{
+		random_device device;
+		return ((uint64_t) device() << 32) ^ device();
+	}
+};
+
+#endif
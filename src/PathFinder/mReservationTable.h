@@ -0,0 +1,185 @@
+#ifndef RESERVATION_TABLE_H
+#define RESERVATION_TABLE_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Space-time reservations of a shared mGrid: which agent occupies a cell at a
+	timestep. Entries live in an open-addressing hash table keyed on
+	(timestep << 32 | cell). Released entries keep their key (with agent -1)
+	so probe chains stay intact, and entries before the current time expire:
+	advance() drops them when they make up too much of the table, so its size
+	follows the reservations of the active window, not the whole history.
+*/
+class mReservationTable
+{
+public:
+	struct Reservation
+	{
+		uint64_t key;
+		int agent;
+	};
+
+	vector<Reservation> slots;
+	uint64_t mask;
+	long usedSlots;
+	long liveReservations;
+	int currentTime;
+
+	mReservationTable() : usedSlots(0),
+						  liveReservations(0),
+						  currentTime(0)
+	{
+		(*this).resize(RESERVATION_TABLE_MIN_SIZE);
+	}
+
+	mReservationTable(const mReservationTable &_other)
+	{
+		this->slots = _other.slots;
+		this->mask = _other.mask;
+		this->usedSlots = _other.usedSlots;
+		this->liveReservations = _other.liveReservations;
+		this->currentTime = _other.currentTime;
+	}
+
+	virtual ~mReservationTable(){}
+
+	static uint64_t makeKey(int cell, int time)
+	{
+		return ((uint64_t) (uint32_t) time << 32) | (uint32_t) cell;
+	}
+
+	static int keyTime(uint64_t key)
+	{
+		return (int) (key >> 32);
+	}
+
+	uint64_t hashKey(uint64_t key)
+	{
+		key ^= key >> 29;
+		key *= 0xBF58476D1CE4E5B9ull;
+		key ^= key >> 32;
+		return key & this->mask;
+	}
+
+	// agent holding (cell, time), or -1
+	int getOwner(int cell, int time)
+	{
+		uint64_t key = makeKey(cell, time);
+		uint64_t slot = (*this).hashKey(key);
+		while(this->slots[slot].key != RESERVATION_EMPTY_KEY)
+		{
+			if(this->slots[slot].key == key) return this->slots[slot].agent;
+			slot = (slot + 1) & this->mask;
+		}
+		return -1;
+	}
+
+	bool isFree(int cell, int time, int agent)
+	{
+		int owner = (*this).getOwner(cell, time);
+		return (owner < 0 or owner == agent);
+	}
+
+	// false if another agent already holds (cell, time)
+	bool reserve(int cell, int time, int agent)
+	{
+		uint64_t key = makeKey(cell, time);
+		uint64_t slot = (*this).hashKey(key);
+		while(this->slots[slot].key != RESERVATION_EMPTY_KEY)
+		{
+			if(this->slots[slot].key == key)
+			{
+				if(this->slots[slot].agent >= 0 and this->slots[slot].agent != agent) return false;
+				if(this->slots[slot].agent < 0) this->liveReservations++;
+				this->slots[slot].agent = agent;
+				return true;
+			}
+			slot = (slot + 1) & this->mask;
+		}
+
+		this->slots[slot].key = key;
+		this->slots[slot].agent = agent;
+		this->usedSlots++;
+		this->liveReservations++;
+		if(2 * this->usedSlots > (long) this->slots.size()) (*this).rebuild();
+		return true;
+	}
+
+	void release(int cell, int time, int agent)
+	{
+		uint64_t key = makeKey(cell, time);
+		uint64_t slot = (*this).hashKey(key);
+		while(this->slots[slot].key != RESERVATION_EMPTY_KEY)
+		{
+			if(this->slots[slot].key == key)
+			{
+				if(this->slots[slot].agent == agent)
+				{
+					this->slots[slot].agent = -1;
+					this->liveReservations--;
+				}
+				return;
+			}
+			slot = (slot + 1) & this->mask;
+		}
+	}
+
+	// move the window start: reservations before 'time' expire
+	void advance(int time)
+	{
+		this->currentTime = time;
+		if(4 * this->usedSlots > (long) this->slots.size()) (*this).rebuild();
+	}
+
+	// rehash the live reservations of the current window, growing the table if needed
+	void rebuild()
+	{
+		vector<Reservation> old;
+		old.swap(this->slots);
+
+		long live = 0;
+		for(int slot = 0; slot < old.size(); slot++)
+		{
+			if(old[slot].key != RESERVATION_EMPTY_KEY and old[slot].agent >= 0 and keyTime(old[slot].key) >= this->currentTime) live++;
+		}
+
+		long size = RESERVATION_TABLE_MIN_SIZE;
+		while(size < 4 * live) size *= 2;
+		(*this).resize(size);
+		for(int slot = 0; slot < old.size(); slot++)
+		{
+			if(old[slot].key == RESERVATION_EMPTY_KEY or old[slot].agent < 0 or keyTime(old[slot].key) < this->currentTime) continue;
+
+			uint64_t index = (*this).hashKey(old[slot].key);
+			while(this->slots[index].key != RESERVATION_EMPTY_KEY) index = (index + 1) & this->mask;
+			this->slots[index] = old[slot];
+			this->usedSlots++;
+			this->liveReservations++;
+		}
+	}
+
+	void resize(long size)
+	{
+		Reservation empty = {RESERVATION_EMPTY_KEY, -1};
+		this->slots.assign(size, empty);
+		this->mask = size - 1;
+		this->usedSlots = 0;
+		this->liveReservations = 0;
+	}
+
+	void clear()
+	{
+		(*this).resize(RESERVATION_TABLE_MIN_SIZE);
+	}
+
+	long memoryUsage()
+	{
+		return (long) (this->slots.size() * sizeof(Reservation));
+	}
+};
+
+#endif
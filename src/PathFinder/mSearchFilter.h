@@ -0,0 +1,86 @@
+#ifndef SEARCH_FILTER_H
+#define SEARCH_FILTER_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Restricts the cells a search may enter on top of grid walkability, e.g. a
+	corridor around a coarse route. Engines call allows() on every neighbor
+	before touching its search state.
+*/
+class mSearchFilter
+{
+public:
+	mSearchFilter(){}
+	virtual ~mSearchFilter(){}
+
+	virtual bool allows(int cell) = 0;
+};
+
+/*
+	Cells of a fine grid whose block of 'scale' x 'scale' cells is marked on a
+	coarse grid (one mark per coarse cell).
+*/
+class mCorridorFilter : public mSearchFilter
+{
+public:
+	mGrid *grid;
+	int coarseDimX;
+	int coarseDimY;
+	int scale;
+	vector<char> marks;
+	long markedCells;
+
+	mCorridorFilter(mGrid *_grid, int _scale) : grid(_grid),
+												scale(_scale),
+												markedCells(0)
+	{
+		this->coarseDimX = (_grid->gridDimX + _scale - 1) / _scale;
+		this->coarseDimY = (_grid->gridDimY + _scale - 1) / _scale;
+		this->marks.assign(this->coarseDimX * this->coarseDimY, 0);
+	}
+
+	mCorridorFilter(const mCorridorFilter &_other)
+	{
+		this->grid = _other.grid;
+		this->coarseDimX = _other.coarseDimX;
+		this->coarseDimY = _other.coarseDimY;
+		this->scale = _other.scale;
+		this->marks = _other.marks;
+		this->markedCells = _other.markedCells;
+	}
+
+	virtual ~mCorridorFilter(){}
+
+	void clear()
+	{
+		fill(this->marks.begin(), this->marks.end(), 0);
+		this->markedCells = 0;
+	}
+
+	// mark every coarse cell within 'width' cells (Chebyshev distance) of (x, y)
+	void mark(int x, int y, int width=0)
+	{
+		for(int cy = max(0, y - width); cy <= min(this->coarseDimY - 1, y + width); cy++)
+		{
+			for(int cx = max(0, x - width); cx <= min(this->coarseDimX - 1, x + width); cx++)
+			{
+				char &mark = this->marks[cy * this->coarseDimX + cx];
+				if(!mark) this->markedCells++;
+				mark = 1;
+			}
+		}
+	}
+
+	virtual bool allows(int cell)
+	{
+		int x = this->grid->nodes[cell].x / this->scale;
+		int y = this->grid->nodes[cell].y / this->scale;
+		return this->marks[y * this->coarseDimX + x] != 0;
+	}
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef SEARCH_LIMITS_H
+#define SEARCH_LIMITS_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	Query options that bound a search. A limit that is hit stops the search
+	right away with one of the SEARCH_* status codes, and the engine keeps the
+	best node found so far (lowest h) as a partial result.
+	  maxExpansions  number of expanded nodes (-1: no limit)
+	  maxCost        f-value above which the goal is considered out of reach
+	  box            cells outside [minX, maxX] x [minY, maxY] are not entered
+	  maxSeconds     wall-clock budget, measured from the start of the search
+*/
+class mSearchLimits
+{
+public:
+	long maxExpansions;
+	double maxCost;
+	bool useBox;
+	int boxMinX;
+	int boxMinY;
+	int boxMaxX;
+	int boxMaxY;
+	double maxSeconds;
+
+	mSearchLimits() : maxExpansions(-1),
+					  maxCost(DBL_MAX),
+					  useBox(false),
+					  boxMinX(0),
+					  boxMinY(0),
+					  boxMaxX(0),
+					  boxMaxY(0),
+					  maxSeconds(-1.0)
+	{}
+
+	mSearchLimits(const mSearchLimits &_other)
+	{
+		this->maxExpansions = _other.maxExpansions;
+		this->maxCost = _other.maxCost;
+		this->useBox = _other.useBox;
+		this->boxMinX = _other.boxMinX;
+		this->boxMinY = _other.boxMinY;
+		this->boxMaxX = _other.boxMaxX;
+		this->boxMaxY = _other.boxMaxY;
+		this->maxSeconds = _other.maxSeconds;
+	}
+
+	virtual ~mSearchLimits(){}
+
+	void setMaxExpansions(long _expansions)
+	{
+		this->maxExpansions = _expansions;
+	}
+
+	void setMaxCost(double _cost)
+	{
+		this->maxCost = _cost;
+	}
+
+	void setBoundingBox(int minX, int minY, int maxX, int maxY)
+	{
+		this->useBox = true;
+		this->boxMinX = minX;
+		this->boxMinY = minY;
+		this->boxMaxX = maxX;
+		this->boxMaxY = maxY;
+	}
+
+	// bounding box of all cells within 'radius' of (x, y)
+	void setRadius(int x, int y, int radius)
+	{
+		(*this).setBoundingBox(x - radius, y - radius, x + radius, y + radius);
+	}
+
+	void setDeadline(double seconds)
+	{
+		this->maxSeconds = seconds;
+	}
+
+	void clear()
+	{
+		this->maxExpansions = -1;
+		this->maxCost = DBL_MAX;
+		this->useBox = false;
+		this->maxSeconds = -1.0;
+	}
+
+	bool insideBox(int x, int y)
+	{
+		if(!this->useBox) return true;
+		return (x >= this->boxMinX and x <= this->boxMaxX and y >= this->boxMinY and y <= this->boxMaxY);
+	}
+
+	// status to stop with before expanding a node with the given f-value, or SEARCH_IN_PROGRESS
+	int check(long expansions, double fValue, double startTime)
+	{
+		if(this->maxExpansions >= 0 and expansions >= this->maxExpansions) return SEARCH_EXPANSION_LIMIT;
+		if(fValue > this->maxCost) return SEARCH_COST_LIMIT;
+
+		// reading the clock is cheap, but not free: check it every few expansions
+		if(this->maxSeconds >= 0.0 and (expansions & 15) == 0 and omp_get_wtime() - startTime > this->maxSeconds)
+			return SEARCH_DEADLINE;
+		return SEARCH_IN_PROGRESS;
+	}
+
+	static string statusName(int status)
+	{
+		if(status == SEARCH_FOUND) return "found";
+		if(status == SEARCH_NO_PATH) return "no path";
+		if(status == SEARCH_EXPANSION_LIMIT) return "expansion limit";
+		if(status == SEARCH_COST_LIMIT) return "cost limit";
+		if(status == SEARCH_BOX_LIMIT) return "bounding box";
+		if(status == SEARCH_DEADLINE) return "deadline";
+		if(status == SEARCH_MEMORY_LIMIT) return "memory limit";
+		return "in progress";
+	}
+};
+
+#endif
@@ -0,0 +1,289 @@
+#ifndef VOXELGRID_H
+#define VOXELGRID_H
+
+// include Configuration file
+#include "PathFinder.h"
+
+using namespace std;
+
+/*
+	3D grid of voxels for volumetric images (e.g. a stack of 2D slices).
+	Walkability is bit-packed (1 bit per voxel) so that 512^3 volumes fit in
+	memory; search state lives in the engine (see VoxelAStar), not here.
+*/
+class mVoxelGrid
+{
+public:
+	int gridDimX;
+	int gridDimY;
+	int gridDimZ;
+	long gridSize;
+	int connectivity;
+	vector<uint64_t> walkableBits;
+	int neighborOffsets[26][3];
+	double neighborCosts[26];
+
+	mVoxelGrid(int _dimX, int _dimY, int _dimZ) : gridDimX(_dimX),
+												  gridDimY(_dimY),
+												  gridDimZ(_dimZ),
+												  connectivity(6)
+	{
+		(*this).allocate();
+		(*this).buildNeighborTable();
+		(*this).buildGridOfVoxels();
+	}
+
+	mVoxelGrid(vector<string> &slicePaths) : gridDimX(0),
+											 gridDimY(0),
+											 gridDimZ(0),
+											 gridSize(0),
+											 connectivity(6)
+	{
+		(*this).buildNeighborTable();
+		(*this).buildGridOfVoxelsFromImages(slicePaths);
+	}
+
+	mVoxelGrid(string rawPath, int _dimX, int _dimY, int _dimZ, int walkableValue=GRID_WALKABLE_COLOR) : gridDimX(_dimX),
+																									   gridDimY(_dimY),
+																									   gridDimZ(_dimZ),
+																									   connectivity(6)
+	{
+		(*this).allocate();
+		(*this).buildNeighborTable();
+		(*this).buildGridOfVoxelsFromRaw(rawPath, walkableValue);
+	}
+
+	mVoxelGrid(const mVoxelGrid &otherGrid)
+	{
+		this->gridDimX = otherGrid.gridDimX;
+		this->gridDimY = otherGrid.gridDimY;
+		this->gridDimZ = otherGrid.gridDimZ;
+		this->gridSize = otherGrid.gridSize;
+		this->connectivity = otherGrid.connectivity;
+		this->walkableBits = otherGrid.walkableBits;
+		(*this).buildNeighborTable();
+	}
+
+	virtual ~mVoxelGrid(){}
+
+	void allocate()
+	{
+		this->gridSize = (long) this->gridDimX * (long) this->gridDimY * (long) this->gridDimZ;
+		this->walkableBits.assign((this->gridSize + 63) / 64, 0);
+	}
+
+	long getNodeIdx(int x, int y, int z)
+	{
+		return ((long) z * this->gridDimY + y) * this->gridDimX + x;
+	}
+
+	void getNodeCoords(long index, int &x, int &y, int &z)
+	{
+		x = (int) (index % this->gridDimX);
+		index /= this->gridDimX;
+		y = (int) (index % this->gridDimY);
+		z = (int) (index / this->gridDimY);
+	}
+
+	bool isWalkable(long index)
+	{
+		return (this->walkableBits[index >> 6] >> (index & 63)) & 1ULL;
+	}
+
+	bool isWalkable(int x, int y, int z)
+	{
+		return (*this).isWalkable((*this).getNodeIdx(x, y, z));
+	}
+
+	void setWalkable(long index, bool walkable)
+	{
+		if(walkable) this->walkableBits[index >> 6] |= (1ULL << (index & 63));
+		else this->walkableBits[index >> 6] &= ~(1ULL << (index & 63));
+	}
+
+	long countWalkable()
+	{
+		long count = 0;
+		for(size_t word = 0; word < this->walkableBits.size(); word++)
+			count += __builtin_popcountll(this->walkableBits[word]);
+		return count;
+	}
+
+	long memoryUsage()
+	{
+		return (long) (this->walkableBits.size() * sizeof(uint64_t));
+	}
+
+	void setConnectivity(int _connectivity)
+	{
+		if(_connectivity == 6 or _connectivity == 18 or _connectivity == 26)
+		{
+			this->connectivity = _connectivity;
+		} else
+		{
+			cout << "Assigned connectivity is not valid (only accept 6, 18 or 26)." << endl;
+			cout << "Current connectivity is " << this->connectivity << endl;
+		}
+	}
+
+	// neighbor table is sorted as 6 faces, 12 edges and 8 corners,
+	// so that a connectivity of N simply uses the first N entries
+	void buildNeighborTable()
+	{
+		int count = 0;
+		for(int nonZero = 1; nonZero <= 3; nonZero++)
+		{
+			for(int dz = -1; dz <= 1; dz++)
+			{
+				for(int dy = -1; dy <= 1; dy++)
+				{
+					for(int dx = -1; dx <= 1; dx++)
+					{
+						if(abs(dx) + abs(dy) + abs(dz) != nonZero) continue;
+						this->neighborOffsets[count][0] = dx;
+						this->neighborOffsets[count][1] = dy;
+						this->neighborOffsets[count][2] = dz;
+						this->neighborCosts[count] = sqrt((double) nonZero);
+						count++;
+					}
+				}
+			}
+		}
+	}
+
+	// fills 'neighbors' and 'directions' (entries of the neighbor table) without allocating
+	int getConnectedNeighbors(int _x, int _y, int _z, long *neighbors, int *directions)
+	{
+		int count = 0;
+		for(int dir = 0; dir < this->connectivity; dir++)
+		{
+			int nx = _x + this->neighborOffsets[dir][0];
+			int ny = _y + this->neighborOffsets[dir][1];
+			int nz = _z + this->neighborOffsets[dir][2];
+			if(nx < 0 or nx >= this->gridDimX or
+			   ny < 0 or ny >= this->gridDimY or
+			   nz < 0 or nz >= this->gridDimZ) continue;
+
+			long index = (*this).getNodeIdx(nx, ny, nz);
+			if((*this).isWalkable(index))
+			{
+				neighbors[count] = index;
+				directions[count] = dir;
+				count++;
+			}
+		}
+		return count;
+	}
+
+	// random obstacles at OBSTACLES_RATE, drawn by voxel index like mGrid::buildGridOfNodes
+	void buildGridOfVoxels(uint64_t seed=mRandom::randomSeed())
+	{
+		for(long index = 0; index < this->gridSize; index++)
+		{
+			(*this).setWalkable(index, mRandom::uniform(seed, (uint64_t) index) >= OBSTACLES_RATE);
+		}
+	}
+
+	// all slices are read into a scratch bit array first, so a missing or
+	// mismatched slice returns false and leaves the current volume unchanged
+	bool buildGridOfVoxelsFromImages(vector<string> &slicePaths)
+	{
+		if(slicePaths.size() == 0)
+		{
+			cout << "no slices to read." << endl;
+			return false;
+		}
+
+		int dimX = 0;
+		int dimY = 0;
+		int dimZ = (int) slicePaths.size();
+		vector<uint64_t> bits;
+		for(int z = 0; z < dimZ; z++)
+		{
+			cv::Mat slice = cv::imread(slicePaths[z]);
+			if(slice.empty())
+			{
+				cout << "could not read slice " << slicePaths[z] << endl;
+				return false;
+			}
+
+			if(z == 0)
+			{
+				dimX = slice.cols;
+				dimY = slice.rows;
+				bits.assign(((long) dimX * dimY * dimZ + 63) / 64, 0);
+			} else
+			if(slice.cols != dimX or slice.rows != dimY)
+			{
+				cout << "slice " << slicePaths[z] << " does not match the volume dimensions." << endl;
+				return false;
+			}
+
+			int channels = slice.channels();
+			for(int y = 0; y < dimY; y++)
+			{
+				uchar *currentPixel = slice.ptr<uchar>(y);
+				long index = ((long) z * dimY + y) * dimX;
+				for(int x = 0; x < dimX; x++)
+				{
+					if(currentPixel[x*channels] == GRID_WALKABLE_COLOR)
+						bits[(index + x) >> 6] |= (1ULL << ((index + x) & 63));
+				}
+			}
+		}
+
+		this->gridDimX = dimX;
+		this->gridDimY = dimY;
+		this->gridDimZ = dimZ;
+		this->gridSize = (long) dimX * dimY * dimZ;
+		this->walkableBits.swap(bits);
+		return true;
+	}
+
+	// same as above: a short file returns false and leaves the volume unchanged
+	bool buildGridOfVoxelsFromRaw(string rawPath, int walkableValue)
+	{
+		ifstream input(rawPath.c_str(), ios::binary);
+		if(!input)
+		{
+			cout << "could not open raw volume " << rawPath << endl;
+			return false;
+		}
+
+		// read one slice at a time to keep the loading buffer small
+		long sliceSize = (long) this->gridDimX * this->gridDimY;
+		vector<unsigned char> slice(sliceSize);
+		vector<uint64_t> bits(this->walkableBits.size(), 0);
+		for(int z = 0; z < this->gridDimZ; z++)
+		{
+			input.read((char *) slice.data(), sliceSize);
+			if(input.gcount() != sliceSize)
+			{
+				cout << "raw volume " << rawPath << " is smaller than the given dimensions." << endl;
+				return false;
+			}
+
+			long offset = (long) z * sliceSize;
+			for(long voxel = 0; voxel < sliceSize; voxel++)
+			{
+				if(slice[voxel] == walkableValue)
+					bits[(offset + voxel) >> 6] |= (1ULL << ((offset + voxel) & 63));
+			}
+		}
+
+		this->walkableBits.swap(bits);
+		return true;
+	}
+
+	// list the slices of an image stack, e.g. "tiny_3D/imgs/*.png"
+	static vector<string> listSlices(string pattern)
+	{
+		vector<cv::String> files;
+		cv::glob(pattern, files, false);
+		vector<string> slicePaths(files.begin(), files.end());
+		sort(slicePaths.begin(), slicePaths.end());
+		return slicePaths;
+	}
+};
+
+#endif
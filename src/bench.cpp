@@ -0,0 +1,1581 @@
+// include CMake Configuration file
+#include "pathfinder_config.h"
+
+// include built-in PathFinder library
+#include "PathFinder.h"
+
+/*
+	Component microbenchmarks: mHeap, mGrid neighbor generation, mNode
+	comparison, AStar::findPath on seeded random grids and Canvas rendering.
+	Lazy Theta* is compared with SparseAStar plus greedy path smoothing, and
+	its paths are checked for line of sight and length bounds.
+	VoxelAStar is checked against a 3D Dijkstra in 6, 18 and 26 connectivity.
+	The layout benchmarks run SparseAStar on wide maps in every mGrid cell
+	layout and report hardware cache misses per expansion (from
+	perf_event_open, "n/a" where the kernel does not allow it).
+	The sliced benchmark interleaves many time-sliced queries on one thread
+	and checks that they do the same work as uninterrupted ones.
+	BitBFS is compared with SparseAStar on unit-cost 4-connected queries.
+	IDAStar is compared with SparseAStar for time, expansions and peak memory.
+	BlockAStar is compared with SparseAStar on open and room maps, including
+	the build time and size of its mLocalDistanceDB and the number of queries
+	after which the build pays off.
+	mDistanceMatrix is compared with one SparseAStar query per waypoint pair.
+	QuadtreeAStar is compared with SparseAStar on blocky maps, with the size
+	of the mQuadtree against the mGrid it replaces.
+	mPathCache is compared with uncached SparseAStar on repeated queries, and
+	checked not to answer unrestricted queries with filtered or boxed paths.
+	Dead-end pruning is measured on porous maps (expansions saved per query).
+	The snapshot benchmark measures query throughput on a mGridStore with and
+	without a concurrent stream of edits.
+	The edit benchmark times batched mGrid edits and compares rebuilding the
+	clearance map and local distance database with repairing the changed tiles.
+	CooperativeAStar runs agents through a contended corridor and a crowded
+	map; their executed steps must not collide.
+	Every benchmark runs a warm-up pass and BENCH_REPEATS timed passes and
+	reports the median time per operation. AStar and SparseAStar (the
+	baseline of the engine benchmarks) path costs are checked against a
+	reference Dijkstra; the program exits with 1 on a mismatch.
+
+	usage: pathfinder_bench [name filter] [--quick]
+*/
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#define BENCH_REPEATS 5
+#define BENCH_SEED 2021
+#define BENCH_SLICE_EXPANSIONS 256
+#define BENCH_EDIT_BATCH 16
+
+struct BenchSettings
+{
+	string filter;
+	bool quick;
+};
+
+// median seconds per operation of 'body', which performs 'operations' operations per call
+template<class Body>
+double runBenchmark(BenchSettings &settings, string name, long operations, Body body)
+{
+	if(settings.filter.size() > 0 and name.find(settings.filter) == string::npos) return -1.0;
+
+	body();
+	vector<double> times;
+	for(int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+	{
+		double stime = omp_get_wtime();
+		body();
+		times.push_back(omp_get_wtime() - stime);
+	}
+	sort(times.begin(), times.end());
+	double perOperation = times[times.size() / 2] / operations;
+
+	char line[256];
+	snprintf(line, sizeof(line), "%-36s %12.1f ns/op %12ld ops", name.c_str(), perOperation * 1.0e9, operations);
+	cout << line << endl;
+	return perOperation;
+}
+
+// square grid with seeded obstacles (OBSTACLES_RATE) and 8-connectivity
+mGrid *buildSeededGrid(int size, unsigned int seed)
+{
+	mMapGenerator generator(MAP_UNIFORM, OBSTACLES_RATE, seed);
+	mGrid *grid = generator.generate(size, size);
+	grid->setConnectivity(8);
+	return grid;
+}
+
+// reference single-pair Dijkstra with the exact Euclidean step costs (-1 if unreachable)
+double referenceDijkstra(mGrid *grid, int startX, int startY, int endX, int endY)
+{
+	vector<double> distances(grid->gridSize, DBL_MAX);
+	priority_queue<pair<double, int>, vector<pair<double, int> >, greater<pair<double, int> > > openSet;
+	int start = grid->getNodeIdx(startX, startY);
+	int end = grid->getNodeIdx(endX, endY);
+	distances[start] = 0.0;
+	openSet.push(make_pair(0.0, start));
+	while(openSet.size() > 0)
+	{
+		pair<double, int> current = openSet.top();
+		openSet.pop();
+		if(current.second == end) return current.first;
+		if(current.first > distances[current.second]) continue;
+
+		mNode &node = grid->nodes[current.second];
+		vector<mNode *> neighbors = grid->getConnectedNeighbors(node.x, node.y);
+		for(int neighbor = 0; neighbor < (int) neighbors.size(); neighbor++)
+		{
+			int index = grid->getNodeIdx(neighbors[neighbor]->x, neighbors[neighbor]->y);
+			double step = (neighbors[neighbor]->x != node.x and neighbors[neighbor]->y != node.y) ? M_SQRT2 : 1.0;
+			if(current.first + step < distances[index])
+			{
+				distances[index] = current.first + step;
+				openSet.push(make_pair(distances[index], index));
+			}
+		}
+	}
+	return -1.0;
+}
+
+// 'queries' seeded (startX, startY, endX, endY) quadruples on walkable cells of a square grid of side 'size'
+vector<int> sampleEndpoints(mGrid *grid, int size, int queries)
+{
+	vector<int> endpoints;
+	uint64_t counter = 0;
+	while((int) endpoints.size() < 4 * queries)
+	{
+		int coordinates[4];
+		for(int coordinate = 0; coordinate < 4; coordinate++) coordinates[coordinate] = mRandom::uniformInt(BENCH_SEED, counter++, size);
+		if(!grid->getNode(coordinates[0], coordinates[1])->walkable or !grid->getNode(coordinates[2], coordinates[3])->walkable) continue;
+		endpoints.insert(endpoints.end(), coordinates, coordinates + 4);
+	}
+	return endpoints;
+}
+
+// SparseAStar reference of an engine benchmark, NAN costs (and a negative time per query) if it was filtered out
+struct BenchBaseline
+{
+	vector<double> costs;
+	long expansions;
+	long peakMemory;
+	double perQuery;
+};
+
+BenchBaseline runBaseline(BenchSettings &settings, string name, SparseAStar *search, vector<int> &endpoints)
+{
+	int queries = endpoints.size() / 4;
+	BenchBaseline baseline;
+	baseline.costs.assign(queries, NAN);
+	baseline.expansions = baseline.peakMemory = 0;
+	baseline.perQuery = runBenchmark(settings, name, queries, [&]()
+	{
+		baseline.expansions = baseline.peakMemory = 0;
+		for(int query = 0; query < queries; query++)
+		{
+			search->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+			baseline.costs[query] = search->getPathCost();
+			baseline.expansions += search->expansions;
+			baseline.peakMemory = max(baseline.peakMemory, search->peakMemory);
+		}
+	});
+	if(baseline.perQuery >= 0.0) cout << "  " << baseline.expansions << " expansions, peak memory " << baseline.peakMemory << " bytes" << endl;
+	return baseline;
+}
+
+// number of queries where 'engine' found another cost than the baseline; NAN on either side (filtered out, gave up) is skipped
+int compareWithBaseline(BenchBaseline &baseline, vector<double> &costs, double tolerance, string engine)
+{
+	int differ = 0;
+	for(int query = 0; query < (int) costs.size(); query++)
+	{
+		if(std::isnan(costs[query]) or std::isnan(baseline.costs[query])) continue;
+		if(fabs(costs[query] - baseline.costs[query]) > tolerance) differ++;
+	}
+	if(differ > 0) cout << "  " << differ << " " << engine << " path costs differ from SparseAStar" << endl;
+	return differ;
+}
+
+void benchHeap(BenchSettings &settings)
+{
+	int size = settings.quick ? 10000 : 200000;
+	mGrid *grid = new mGrid(size, 1, true);
+	mt19937 engine(BENCH_SEED);
+	uniform_real_distribution<double> uniform(0.0, 1000.0);
+	vector<double> gValues(size);
+	for(int node = 0; node < size; node++) gValues[node] = uniform(engine);
+	mHeap *heap = new mHeap(size);
+
+	runBenchmark(settings, "mHeap/add+remove", 2L * size, [&]()
+	{
+		for(int node = 0; node < size; node++)
+		{
+			grid->nodes[node].setGValue(gValues[node]);
+			grid->nodes[node].setHValue(0.0);
+			heap->add(&grid->nodes[node]);
+		}
+		while(heap->size() > 0) heap->remove();
+	});
+
+	runBenchmark(settings, "mHeap/update", size, [&]()
+	{
+		for(int node = 0; node < size; node++)
+		{
+			grid->nodes[node].setGValue(gValues[node]);
+			heap->add(&grid->nodes[node]);
+		}
+		for(int node = 0; node < size; node++)
+		{
+			grid->nodes[node].setGValue(grid->nodes[node].getGValue() * 0.5);
+			heap->update(&grid->nodes[node]);
+		}
+		heap->currentSize = 0;
+	});
+
+	delete heap;
+	delete grid;
+}
+
+void benchNeighbors(BenchSettings &settings)
+{
+	int size = settings.quick ? 128 : 512;
+	mGrid *grid = buildSeededGrid(size, BENCH_SEED);
+	long total = 0;
+	for(int connectivity = 4; connectivity <= 8; connectivity += 4)
+	{
+		grid->setConnectivity(connectivity);
+		string name = (connectivity == 4) ? "mGrid/getConnectedNeighbors/4" : "mGrid/getConnectedNeighbors/8";
+		runBenchmark(settings, name, grid->gridSize, [&]()
+		{
+			for(int y = 0; y < grid->gridDimY; y++)
+			{
+				for(int x = 0; x < grid->gridDimX; x++)
+					total += grid->getConnectedNeighbors(x, y).size();
+			}
+		});
+	}
+	if(total < 0) cout << total << endl;
+	delete grid;
+}
+
+void benchNodeCompare(BenchSettings &settings)
+{
+	int size = settings.quick ? 10000 : 1000000;
+	vector<mNode> nodes(size);
+	mt19937 engine(BENCH_SEED);
+	uniform_int_distribution<int> uniform(0, 100);
+	for(int node = 0; node < size; node++)
+	{
+		nodes[node].setGValue(uniform(engine));
+		nodes[node].setHValue(uniform(engine));
+	}
+
+	long total = 0;
+	runBenchmark(settings, "mNode/isGreater", size - 1, [&]()
+	{
+		for(int node = 0; node + 1 < size; node++) total += nodes[node].isGreater(&nodes[node + 1]);
+	});
+	if(total == LONG_MIN) cout << total << endl;
+}
+
+// returns the number of path costs that differ from the reference Dijkstra
+int benchAStar(BenchSettings &settings)
+{
+	int mismatches = 0;
+	int maxSize = settings.quick ? 128 : 512;
+	for(int size = 64; size <= maxSize; size *= 2)
+	{
+		// the canvas of AStar owns its grid
+		mGrid *grid = buildSeededGrid(size, BENCH_SEED + size);
+		AStar *aStar = new AStar(grid);
+		aStar->setVerbose(false);
+
+		int queries = settings.quick ? 8 : 32;
+		vector<int> endpoints;
+		mt19937 engine(BENCH_SEED);
+		uniform_int_distribution<int> pick(0, size - 1);
+		while((int) endpoints.size() < 4 * queries)
+		{
+			int x = pick(engine), y = pick(engine);
+			if(grid->getNode(x, y)->walkable)
+			{
+				endpoints.push_back(x);
+				endpoints.push_back(y);
+			}
+		}
+
+		string name = "AStar/findPath/" + to_string(size) + "x" + to_string(size);
+		double aStarTime = runBenchmark(settings, name, queries, [&]()
+		{
+			for(int query = 0; query < queries; query++)
+			{
+				aStar->setStartNode(endpoints[4*query], endpoints[4*query + 1]);
+				aStar->setEndNode(endpoints[4*query + 2], endpoints[4*query + 3]);
+				aStar->findPath();
+			}
+		});
+
+		// SparseAStar is the baseline of the engine benchmarks below, so it answers to the oracle too
+		SparseAStar *search = new SparseAStar(grid);
+		search->setVerbose(false);
+		string sparseName = "SparseAStar/findPath/" + to_string(size) + "x" + to_string(size);
+		double sparseTime = runBenchmark(settings, sparseName, queries, [&]()
+		{
+			for(int query = 0; query < queries; query++) search->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+		});
+
+		// correctness oracle
+		for(int query = 0; query < queries and (aStarTime >= 0.0 or sparseTime >= 0.0); query++)
+		{
+			double reference = referenceDijkstra(grid, endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+			if(aStarTime >= 0.0)
+			{
+				aStar->setStartNode(endpoints[4*query], endpoints[4*query + 1]);
+				aStar->setEndNode(endpoints[4*query + 2], endpoints[4*query + 3]);
+				aStar->findPath();
+				double cost = (aStar->status == SEARCH_FOUND) ? aStar->getPathCost() : -1.0;
+				if(fabs(cost - reference) > 1.0e-6)
+				{
+					cout << "  cost mismatch on " << name << " query " << query << ": " << cost << " (reference " << reference << ")" << endl;
+					mismatches++;
+				}
+			}
+			if(sparseTime >= 0.0)
+			{
+				search->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+				double cost = (search->status == SEARCH_FOUND) ? search->getPathCost() : -1.0;
+				if(fabs(cost - reference) > 1.0e-6)
+				{
+					cout << "  cost mismatch on " << sparseName << " query " << query << ": " << cost << " (reference " << reference << ")" << endl;
+					mismatches++;
+				}
+			}
+		}
+		delete search;
+		delete aStar;
+	}
+	return mismatches;
+}
+
+// line of sight tested cell by cell on mNode::walkable: every cell whose interior the segment crosses must be walkable
+bool cellLineOfSight(mGrid *grid, int x0, int y0, int x1, int y1, long &cellChecks)
+{
+	if(x0 > x1)
+	{
+		swap(x0, x1);
+		swap(y0, y1);
+	}
+	long dx = x1 - x0;
+	long dy = y1 - y0;
+	for(int x = x0; x <= x1; x++)
+	{
+		// y range of the segment inside column x, doubled and scaled by dx (the whole column if vertical)
+		int first = min(y0, y1);
+		int last = max(y0, y1);
+		if(dx > 0 and dy != 0)
+		{
+			long xLow = max(2L * x - 1, 2L * x0);
+			long xHigh = min(2L * x + 1, 2L * x1);
+			long yLow = 2L * y0 * dx + (xLow - 2L * x0) * dy;
+			long yHigh = 2L * y0 * dx + (xHigh - 2L * x0) * dy;
+			if(yLow > yHigh) swap(yLow, yHigh);
+			while((2L * first + 1) * dx <= yLow) first++;
+			while((2L * last - 1) * dx >= yHigh) last--;
+		} else
+		if(dx > 0)
+		{
+			first = last = y0;
+		}
+		for(int y = first; y <= last; y++)
+		{
+			cellChecks++;
+			if(!grid->getNode(x, y)->walkable) return false;
+		}
+	}
+	return true;
+}
+
+/*
+	Lazy Theta* (line of sight on the packed words of its mBitGrid) against
+	SparseAStar followed by greedy smoothing with cell-by-cell line-of-sight
+	checks, on the same queries: time per query, expansions, path length and
+	waypoints. Every Lazy Theta* path must start and end at the query cells,
+	have line of sight between consecutive waypoints (checked cell by cell),
+	report its own length and be no shorter than the straight line nor than
+	the octile-optimal cost divided by the largest octile/Euclidean ratio
+	(sqrt(4 - 2 sqrt(2))). Returns the number of invalid paths.
+*/
+int benchAnyAngle(BenchSettings &settings)
+{
+	int size = settings.quick ? 128 : 512;
+	int queries = settings.quick ? 8 : 32;
+	mGrid *grid = buildSeededGrid(size, BENCH_SEED);
+	LazyThetaStar *theta = new LazyThetaStar(grid);
+	theta->setVerbose(false);
+	SparseAStar *search = new SparseAStar(grid);
+	search->setVerbose(false);
+	vector<int> endpoints = sampleEndpoints(grid, size, queries);
+	vector<int> cells(grid->gridSize);
+	mPathResult result(cells.data(), cells.size(), PATH_CELLS);
+
+	string suffix = to_string(size) + "x" + to_string(size);
+	long thetaExpansions = 0, losChecks = 0, wordChecks = 0, thetaWaypoints = 0;
+	double thetaLength = 0.0;
+	double thetaTime = runBenchmark(settings, "LazyThetaStar/" + suffix, queries, [&]()
+	{
+		thetaExpansions = losChecks = wordChecks = thetaWaypoints = 0;
+		thetaLength = 0.0;
+		for(int query = 0; query < queries; query++)
+		{
+			theta->setStartNode(endpoints[4*query], endpoints[4*query + 1]);
+			theta->setEndNode(endpoints[4*query + 2], endpoints[4*query + 3]);
+			if(theta->findPath())
+			{
+				thetaLength += theta->pathLength;
+				thetaWaypoints += theta->path.size();
+			}
+			thetaExpansions += theta->expansions;
+			losChecks += theta->bitGrid->losChecks;
+			wordChecks += theta->bitGrid->wordChecks;
+		}
+	});
+	if(thetaTime >= 0.0)
+	{
+		cout << "  " << thetaExpansions << " expansions, " << losChecks << " line of sight checks (" << wordChecks << " word checks), ";
+		cout << "length " << thetaLength << ", " << thetaWaypoints << " waypoints" << endl;
+	}
+
+	long expansions = 0, cellChecks = 0, smoothWaypoints = 0;
+	double gridLength = 0.0, smoothLength = 0.0;
+	vector<double> octileCosts(queries, -1.0);
+	double smoothTime = runBenchmark(settings, "SparseAStar/smoothed/" + suffix, queries, [&]()
+	{
+		expansions = cellChecks = smoothWaypoints = 0;
+		gridLength = smoothLength = 0.0;
+		for(int query = 0; query < queries; query++)
+		{
+			search->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+			expansions += search->expansions;
+			octileCosts[query] = search->getPathCost();
+			if(search->status != SEARCH_FOUND or search->extractPath(result) <= 0) continue;
+			gridLength += octileCosts[query];
+
+			// greedy string pulling: from each anchor, the furthest path cell still in sight
+			int anchor = 0;
+			smoothWaypoints++;
+			while(anchor < result.length - 1)
+			{
+				mNode &from = grid->nodes[cells[anchor]];
+				int next = anchor + 1;
+				while(next + 1 < result.length and cellLineOfSight(grid, from.x, from.y, grid->nodes[cells[next + 1]].x, grid->nodes[cells[next + 1]].y, cellChecks)) next++;
+				mNode &to = grid->nodes[cells[next]];
+				smoothLength += sqrt((double) (to.x - from.x) * (to.x - from.x) + (double) (to.y - from.y) * (to.y - from.y));
+				smoothWaypoints++;
+				anchor = next;
+			}
+		}
+	});
+	if(smoothTime >= 0.0)
+	{
+		cout << "  " << expansions << " expansions, " << cellChecks << " cell checks, length " << gridLength << " -> " << smoothLength;
+		cout << " smoothed, " << smoothWaypoints << " waypoints" << endl;
+	}
+
+	int invalid = 0;
+	if(thetaTime >= 0.0 and smoothTime >= 0.0)
+	{
+		double ratio = sqrt(4.0 - 2.0 * sqrt(2.0));
+		for(int query = 0; query < queries; query++)
+		{
+			int startX = endpoints[4*query], startY = endpoints[4*query + 1];
+			int endX = endpoints[4*query + 2], endY = endpoints[4*query + 3];
+			theta->setStartNode(startX, startY);
+			theta->setEndNode(endX, endY);
+			bool found = theta->findPath();
+			bool valid = (found == (octileCosts[query] >= 0.0));
+			if(found)
+			{
+				vector<mNode *> &path = theta->path;
+				double length = 0.0;
+				valid = valid and path.front()->x == startX and path.front()->y == startY and path.back()->x == endX and path.back()->y == endY;
+				for(int waypoint = 1; waypoint < (int) path.size(); waypoint++)
+				{
+					valid = valid and cellLineOfSight(grid, path[waypoint - 1]->x, path[waypoint - 1]->y, path[waypoint]->x, path[waypoint]->y, cellChecks);
+					length += theta->EuclideanDistance(path[waypoint - 1], path[waypoint]);
+				}
+				double straight = sqrt((double) (endX - startX) * (endX - startX) + (double) (endY - startY) * (endY - startY));
+				valid = valid and fabs(length - theta->pathLength) < 1.0e-6 and length >= straight - 1.0e-6 and length >= octileCosts[query] / ratio - 1.0e-6;
+			}
+			if(!valid)
+			{
+				cout << "  invalid LazyThetaStar path on query " << query << ": length " << theta->pathLength << " (octile optimal " << octileCosts[query] << ")" << endl;
+				invalid++;
+			}
+		}
+	}
+	delete search;
+	delete theta;
+	delete grid;
+	return invalid;
+}
+
+// reference single-pair Dijkstra over a mVoxelGrid with its neighbor table costs (-1 if unreachable)
+double referenceVoxelDijkstra(mVoxelGrid *grid, long start, long end)
+{
+	vector<double> distances(grid->gridSize, DBL_MAX);
+	priority_queue<pair<double, long>, vector<pair<double, long> >, greater<pair<double, long> > > openSet;
+	distances[start] = 0.0;
+	openSet.push(make_pair(0.0, start));
+	long neighbors[26];
+	int directions[26];
+	while(openSet.size() > 0)
+	{
+		pair<double, long> current = openSet.top();
+		openSet.pop();
+		if(current.second == end) return current.first;
+		if(current.first > distances[current.second]) continue;
+
+		int x, y, z;
+		grid->getNodeCoords(current.second, x, y, z);
+		int count = grid->getConnectedNeighbors(x, y, z, neighbors, directions);
+		for(int neighbor = 0; neighbor < count; neighbor++)
+		{
+			double distance = current.first + grid->neighborCosts[directions[neighbor]];
+			if(distance < distances[neighbors[neighbor]])
+			{
+				distances[neighbors[neighbor]] = distance;
+				openSet.push(make_pair(distance, neighbors[neighbor]));
+			}
+		}
+	}
+	return -1.0;
+}
+
+/*
+	VoxelAStar on a seeded random volume in 6, 18 and 26 connectivity. Path
+	lengths are checked against a reference Dijkstra (VoxelAStar keeps float
+	g-values, hence the relative tolerance) and every path must be a chain of
+	walkable neighbors from the start to the end voxel. Returns the number of
+	mismatches.
+*/
+int benchVoxels(BenchSettings &settings)
+{
+	int mismatches = 0;
+	int size = settings.quick ? 32 : 96;
+	int queries = settings.quick ? 8 : 32;
+	mVoxelGrid *grid = new mVoxelGrid(size, size, size);
+	grid->buildGridOfVoxels(BENCH_SEED);
+	VoxelAStar *search = new VoxelAStar(grid);
+	search->setVerbose(false);
+
+	vector<long> endpoints;
+	uint64_t counter = 0;
+	while((int) endpoints.size() < 2 * queries)
+	{
+		long index = mRandom::uniformInt(BENCH_SEED, counter++, (int) grid->gridSize);
+		if(grid->isWalkable(index)) endpoints.push_back(index);
+	}
+
+	int connectivities[3] = {6, 18, 26};
+	for(int option = 0; option < 3; option++)
+	{
+		grid->setConnectivity(connectivities[option]);
+		string name = "VoxelAStar/" + to_string(connectivities[option]) + "/" + to_string(size) + "^3";
+		vector<double> lengths(queries, -1.0);
+		long expansions = 0;
+		double seconds = runBenchmark(settings, name, queries, [&]()
+		{
+			expansions = 0;
+			for(int query = 0; query < queries; query++)
+			{
+				search->startIdx = endpoints[2*query];
+				search->endIdx = endpoints[2*query + 1];
+				search->findPath();
+				lengths[query] = search->pathLength;
+				expansions += search->expansions;
+			}
+		});
+		if(seconds < 0.0) continue;
+		cout << "  " << expansions << " expansions, peak memory " << search->memoryUsage() << " bytes" << endl;
+
+		// coordinates one step may change: faces only, faces and edges, or all three
+		int maxChanged = (option == 0) ? 1 : ((option == 1) ? 2 : 3);
+		for(int query = 0; query < queries; query++)
+		{
+			search->startIdx = endpoints[2*query];
+			search->endIdx = endpoints[2*query + 1];
+			bool found = search->findPath();
+			bool valid = !found or (search->path.front() == search->startIdx and search->path.back() == search->endIdx);
+			for(int step = 1; found and step < (int) search->path.size(); step++)
+			{
+				int x0, y0, z0, x1, y1, z1;
+				grid->getNodeCoords(search->path[step - 1], x0, y0, z0);
+				grid->getNodeCoords(search->path[step], x1, y1, z1);
+				int changed = (x0 != x1) + (y0 != y1) + (z0 != z1);
+				valid = valid and grid->isWalkable(search->path[step]) and changed > 0 and changed <= maxChanged;
+				valid = valid and abs(x1 - x0) <= 1 and abs(y1 - y0) <= 1 and abs(z1 - z0) <= 1;
+			}
+			double reference = referenceVoxelDijkstra(grid, endpoints[2*query], endpoints[2*query + 1]);
+			if(!valid or fabs(lengths[query] - reference) > 1.0e-5 * max(1.0, reference))
+			{
+				cout << "  cost mismatch on " << name << " query " << query << ": " << lengths[query] << " (reference " << reference << ")" << endl;
+				mismatches++;
+			}
+		}
+	}
+	delete search;
+	delete grid;
+	return mismatches;
+}
+
+// hardware cache misses of the calling thread (all levels, as counted by the CPU)
+struct CacheMissCounter
+{
+	int fd;
+
+	CacheMissCounter()
+	{
+		struct perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.size = sizeof(attributes);
+		attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		this->fd = syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+	}
+
+	~CacheMissCounter()
+	{
+		if(this->fd >= 0) close(this->fd);
+	}
+
+	void start()
+	{
+		if(this->fd < 0) return;
+		ioctl(this->fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(this->fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	// -1 if the counter is not available
+	long stop()
+	{
+		if(this->fd < 0) return -1;
+		ioctl(this->fd, PERF_EVENT_IOC_DISABLE, 0);
+		long long count = 0;
+		if(read(this->fd, &count, sizeof(count)) != sizeof(count)) return -1;
+		return count;
+	}
+};
+
+// returns the number of path costs that differ between layouts
+int benchLayouts(BenchSettings &settings)
+{
+	int mismatches = 0;
+	int dimX = settings.quick ? 1024 : 4096;
+	int dimY = settings.quick ? 64 : 256;
+	int queries = settings.quick ? 2 : 8;
+	int layouts[3] = {GRID_LAYOUT_ROWS, GRID_LAYOUT_TILED, GRID_LAYOUT_MORTON};
+	vector<double> referenceCosts;
+
+	for(int layout = 0; layout < 3; layout++)
+	{
+		mMapGenerator generator(MAP_UNIFORM, OBSTACLES_RATE, BENCH_SEED);
+		mGrid *grid = generator.generate(dimX, dimY);
+		grid->setConnectivity(8);
+		grid->setLayout(layouts[layout]);
+		SparseAStar *search = new SparseAStar(grid);
+		search->setVerbose(false);
+
+		// long queries along the wide axis, the same in every layout
+		vector<int> endpoints;
+		uint64_t counter = 0;
+		while((int) endpoints.size() < 4 * queries)
+		{
+			int startX = mRandom::uniformInt(BENCH_SEED, counter++, dimX / 8);
+			int startY = mRandom::uniformInt(BENCH_SEED, counter++, dimY);
+			int endX = dimX - 1 - mRandom::uniformInt(BENCH_SEED, counter++, dimX / 8);
+			int endY = mRandom::uniformInt(BENCH_SEED, counter++, dimY);
+			if(!grid->getNode(startX, startY)->walkable or !grid->getNode(endX, endY)->walkable) continue;
+			endpoints.push_back(startX);
+			endpoints.push_back(startY);
+			endpoints.push_back(endX);
+			endpoints.push_back(endY);
+		}
+
+		string name = "SparseAStar/layout/" + mGrid::layoutName(layouts[layout]) + "/" + to_string(dimX) + "x" + to_string(dimY);
+		CacheMissCounter missCounter;
+		long expansions = 0;
+		long misses = -1;
+		double perQuery = runBenchmark(settings, name, queries, [&]()
+		{
+			expansions = 0;
+			missCounter.start();
+			for(int query = 0; query < queries; query++)
+			{
+				search->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+				expansions += search->expansions;
+			}
+			misses = missCounter.stop();
+		});
+		if(perQuery < 0.0)
+		{
+			delete search;
+			delete grid;
+			continue;
+		}
+
+		char line[256];
+		double nsPerExpansion = perQuery * queries * 1.0e9 / max(1L, expansions);
+		if(misses >= 0) snprintf(line, sizeof(line), "  %ld expansions, %.1f ns and %.2f cache misses per expansion", expansions, nsPerExpansion, (double) misses / max(1L, expansions));
+		else snprintf(line, sizeof(line), "  %ld expansions, %.1f ns per expansion, cache misses n/a", expansions, nsPerExpansion);
+		cout << line << endl;
+
+		// every layout must find paths of the same cost
+		for(int query = 0; query < queries; query++)
+		{
+			search->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+			double cost = (search->status == SEARCH_FOUND) ? search->getPathCost() : -1.0;
+			if(layout == 0) referenceCosts.push_back(cost);
+			else if(query < (int) referenceCosts.size() and fabs(cost - referenceCosts[query]) > 1.0e-6)
+			{
+				cout << "  cost mismatch on " << name << " query " << query << ": " << cost << " (rows " << referenceCosts[query] << ")" << endl;
+				mismatches++;
+			}
+		}
+		delete search;
+		delete grid;
+	}
+	return mismatches;
+}
+
+/*
+	Queries interleaved on one thread: every frame gives each in-flight query
+	one slice of BENCH_SLICE_EXPANSIONS expansions. Returns the number of
+	queries whose expansions or path cost differ from an uninterrupted run.
+*/
+int benchSlicedSearch(BenchSettings &settings)
+{
+	int size = settings.quick ? 256 : 1024;
+	int queries = settings.quick ? 8 : 32;
+	mGrid *grid = buildSeededGrid(size, BENCH_SEED);
+	vector<int> endpoints = sampleEndpoints(grid, size, queries);
+	vector<SparseAStar *> searches;
+	for(int query = 0; query < queries; query++)
+	{
+		searches.push_back(new SparseAStar(grid));
+		searches.back()->setVerbose(false);
+	}
+
+	string name = "SparseAStar/sliced/" + to_string(size) + "x" + to_string(size);
+	int frames = 0;
+	double longestSlice = 0.0;
+	runBenchmark(settings, name, queries, [&]()
+	{
+		frames = 0;
+		longestSlice = 0.0;
+		for(int query = 0; query < queries; query++) searches[query]->begin(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+		bool running = true;
+		while(running)
+		{
+			running = false;
+			for(int query = 0; query < queries; query++)
+			{
+				if(searches[query]->step(BENCH_SLICE_EXPANSIONS) == SEARCH_IN_PROGRESS) running = true;
+			}
+			frames++;
+		}
+		for(int query = 0; query < queries; query++) longestSlice = max(longestSlice, searches[query]->longestStep);
+	});
+	if(settings.filter.size() > 0 and name.find(settings.filter) == string::npos)
+	{
+		for(int query = 0; query < queries; query++) delete searches[query];
+		delete grid;
+		return 0;
+	}
+	cout << "  " << frames << " frames of " << BENCH_SLICE_EXPANSIONS << " expansions per query, longest slice " << longestSlice * 1.0e6 << " us" << endl;
+
+	// same work as uninterrupted searches
+	int mismatches = 0;
+	SparseAStar *whole = new SparseAStar(grid);
+	whole->setVerbose(false);
+	for(int query = 0; query < queries; query++)
+	{
+		whole->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+		SparseAStar *sliced = searches[query];
+		if(whole->expansions != sliced->expansions or whole->status != sliced->status or fabs(whole->getPathCost() - sliced->getPathCost()) > 1.0e-9)
+		{
+			cout << "  sliced query " << query << " differs: " << sliced->expansions << " expansions, cost " << sliced->getPathCost();
+			cout << " (uninterrupted " << whole->expansions << ", cost " << whole->getPathCost() << ")" << endl;
+			mismatches++;
+		}
+	}
+	delete whole;
+	for(int query = 0; query < queries; query++) delete searches[query];
+	delete grid;
+	return mismatches;
+}
+
+// BitBFS against SparseAStar on the same unit-cost 4-connected queries of a porous map
+int benchBitBFS(BenchSettings &settings)
+{
+	int size = settings.quick ? 512 : 2048;
+	int queries = settings.quick ? 4 : 16;
+	mMapGenerator generator(MAP_POROUS, 0.4, BENCH_SEED);
+	mGrid *grid = generator.generate(size, size);
+	grid->setConnectivity(4);
+	BitBFS *bfs = new BitBFS(grid);
+	bfs->setVerbose(false);
+	SparseAStar *search = new SparseAStar(grid);
+	search->setVerbose(false);
+	vector<int> endpoints = sampleEndpoints(grid, size, queries);
+
+	// both engines find the same shortest distances
+	string suffix = to_string(size) + "x" + to_string(size);
+	vector<double> distances(queries, NAN);
+	runBenchmark(settings, "BitBFS/findPath/" + suffix, queries, [&]()
+	{
+		for(int query = 0; query < queries; query++)
+		{
+			bool found = bfs->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+			distances[query] = found ? bfs->layers : -1.0;
+		}
+	});
+	runBenchmark(settings, "BitBFS/computeDistances/" + suffix, 1, [&]()
+	{
+		bfs->computeDistances(endpoints[0], endpoints[1]);
+	});
+	BenchBaseline baseline = runBaseline(settings, "SparseAStar/4-connected/" + suffix, search, endpoints);
+	int mismatches = compareWithBaseline(baseline, distances, 1.0e-9, "BitBFS");
+	delete search;
+	delete bfs;
+	delete grid;
+	return mismatches;
+}
+
+/*
+	Dead-end pruning on porous maps of several densities: build time of the
+	mDeadEndMap, then SparseAStar with and without a mDeadEndFilter on the
+	same queries. Returns the number of queries whose path costs differ.
+*/
+int benchDeadEnds(BenchSettings &settings)
+{
+	int size = settings.quick ? 256 : 1024;
+	int queries = settings.quick ? 16 : 64;
+	double densities[3] = {0.35, 0.45, 0.5};
+	int mismatches = 0;
+	for(int connectivity = 4; connectivity <= 8; connectivity += 4)
+	{
+		for(int density = 0; density < 3; density++)
+		{
+			mMapGenerator generator(MAP_POROUS, densities[density], BENCH_SEED);
+			mGrid *grid = generator.generate(size, size);
+			grid->setConnectivity(connectivity);
+			mDeadEndMap *deadEnds = new mDeadEndMap(grid);
+			SparseAStar *search = new SparseAStar(grid);
+			search->setVerbose(false);
+			mDeadEndFilter filter(deadEnds);
+			vector<int> endpoints = sampleEndpoints(grid, size, queries);
+
+			char suffix[64];
+			snprintf(suffix, sizeof(suffix), "%d-connected/%.2f/%dx%d", connectivity, densities[density], size, size);
+			runBenchmark(settings, string("mDeadEndMap/build/") + suffix, 1, [&]()
+			{
+				deadEnds->build();
+			});
+			if(deadEnds->gridVersion < 0) deadEnds->build();
+
+			BenchBaseline baseline = runBaseline(settings, string("SparseAStar/porous/") + suffix, search, endpoints);
+			long plain = baseline.expansions, pruned = 0;
+			vector<double> costs(queries, NAN);
+			runBenchmark(settings, string("SparseAStar/dead ends/") + suffix, queries, [&]()
+			{
+				pruned = 0;
+				search->setSearchFilter(&filter);
+				for(int query = 0; query < queries; query++)
+				{
+					filter.setQuery(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+					search->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+					costs[query] = search->getPathCost();
+					pruned += search->expansions;
+				}
+				search->setSearchFilter(NULL);
+			});
+			if(plain > 0 and pruned > 0)
+			{
+				cout << "  " << deadEnds->pockets.size() << " pockets, " << deadEnds->pocketCells << " pocket cells, expansions ";
+				cout << plain << " -> " << pruned << " (" << 100.0 * (plain - pruned) / plain << "% fewer)" << endl;
+			}
+			mismatches += compareWithBaseline(baseline, costs, 1.0e-9, "dead-end pruned");
+			delete search;
+			delete deadEnds;
+			delete grid;
+		}
+	}
+	return mismatches;
+}
+
+/*
+	IDAStar under two memory caps against SparseAStar on the same queries:
+	time per query, total expansions and the largest peak memory of a query.
+	Returns the number of queries whose path costs differ.
+*/
+int benchLowMemory(BenchSettings &settings)
+{
+	int size = settings.quick ? 64 : 256;
+	int queries = settings.quick ? 8 : 32;
+	mGrid *grid = buildSeededGrid(size, BENCH_SEED);
+	SparseAStar *search = new SparseAStar(grid);
+	search->setVerbose(false);
+	long caps[2] = {IDA_MEMORY_CAP, 16L * IDA_MEMORY_CAP};
+	vector<IDAStar *> lowMemory;
+	for(int cap = 0; cap < 2; cap++)
+	{
+		lowMemory.push_back(new IDAStar(grid, caps[cap]));
+		lowMemory.back()->setVerbose(false);
+	}
+
+	vector<int> endpoints = sampleEndpoints(grid, size, queries);
+	string suffix = to_string(size) + "x" + to_string(size);
+	BenchBaseline baseline = runBaseline(settings, "SparseAStar/low memory/" + suffix, search, endpoints);
+
+	int mismatches = 0;
+	for(int cap = 0; cap < 2; cap++)
+	{
+		IDAStar *engine = lowMemory[cap];
+		long expansions = 0, peakMemory = 0;
+		vector<double> costs(queries, NAN);
+		runBenchmark(settings, "IDAStar/" + to_string(caps[cap] >> 10) + "KB/" + suffix, queries, [&]()
+		{
+			expansions = peakMemory = 0;
+			for(int query = 0; query < queries; query++)
+			{
+				engine->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+				expansions += engine->expansions;
+				peakMemory = max(peakMemory, engine->peakMemory);
+				costs[query] = (engine->status == SEARCH_MEMORY_LIMIT) ? NAN : engine->getPathCost();
+			}
+		});
+		if(expansions > 0) cout << "  " << expansions << " expansions, peak memory " << peakMemory << " bytes" << endl;
+		mismatches += compareWithBaseline(baseline, costs, 1.0e-6, "IDAStar");
+		delete engine;
+	}
+	delete search;
+	delete grid;
+	return mismatches;
+}
+
+/*
+	BlockAStar against SparseAStar on an open uniform map and a rooms map,
+	with 8x8 blocks: database build time, patterns and memory, then time per
+	query, expansions and heap operations of both engines. Returns the number
+	of queries whose path costs differ.
+*/
+int benchBlockAStar(BenchSettings &settings)
+{
+	int size = settings.quick ? 256 : 1024;
+	int queries = settings.quick ? 16 : 64;
+	int mapTypes[2] = {MAP_UNIFORM, MAP_ROOMS};
+	string mapNames[2] = {"open", "rooms"};
+	int mismatches = 0;
+	for(int map = 0; map < 2; map++)
+	{
+		mMapGenerator generator(mapTypes[map], 0.1, BENCH_SEED);
+		mGrid *grid = generator.generate(size, size);
+		grid->setConnectivity(8);
+		mLocalDistanceDB *database = new mLocalDistanceDB(grid);
+		BlockAStar *blockSearch = new BlockAStar(grid, database);
+		blockSearch->setVerbose(false);
+		SparseAStar *search = new SparseAStar(grid);
+		search->setVerbose(false);
+		vector<int> endpoints = sampleEndpoints(grid, size, queries);
+
+		string suffix = mapNames[map] + "/" + to_string(size) + "x" + to_string(size);
+		double buildTime = runBenchmark(settings, "mLocalDistanceDB/build/" + suffix, 1, [&]()
+		{
+			database->build();
+		});
+		if(buildTime >= 0.0) cout << "  " << database->patterns.size() << " patterns, " << database->memoryUsage() << " bytes" << endl;
+		if(database->gridVersion < 0) database->build();
+
+		// one heap removal per SparseAStar expansion
+		BenchBaseline baseline = runBaseline(settings, "SparseAStar/blocks/" + suffix, search, endpoints);
+		long blockExpansions = 0, heapOperations = 0;
+		vector<double> costs(queries, NAN);
+		double blockTime = runBenchmark(settings, "BlockAStar/" + suffix, queries, [&]()
+		{
+			blockExpansions = heapOperations = 0;
+			for(int query = 0; query < queries; query++)
+			{
+				blockSearch->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+				blockExpansions += blockSearch->expansions;
+				heapOperations += blockSearch->heapOperations;
+				costs[query] = blockSearch->getPathCost();
+			}
+		});
+		if(blockExpansions > 0) cout << "  " << blockExpansions << " block expansions, " << heapOperations << " heap operations" << endl;
+
+		// queries it takes to win back the database build over SparseAStar
+		if(buildTime >= 0.0 and blockTime >= 0.0 and baseline.perQuery >= 0.0)
+		{
+			char line[256];
+			if(baseline.perQuery > blockTime)
+				snprintf(line, sizeof(line), "  build = %.0f BlockAStar queries, pays off after %.0f queries (%.3f ms saved per query)", buildTime / blockTime, buildTime / (baseline.perQuery - blockTime), (baseline.perQuery - blockTime) * 1.0e3);
+			else
+				snprintf(line, sizeof(line), "  build = %.0f BlockAStar queries, never pays off (not faster than SparseAStar)", buildTime / blockTime);
+			cout << line << endl;
+		}
+		mismatches += compareWithBaseline(baseline, costs, 1.0e-6, "BlockAStar");
+		delete search;
+		delete blockSearch;
+		delete database;
+		delete grid;
+	}
+	return mismatches;
+}
+
+/*
+	Batched edits of BENCH_EDIT_BATCH-cell squares on a seeded map, each
+	followed by bringing derived data up to date: full rebuilds of the
+	mClearanceMap and mLocalDistanceDB against their journal-driven repairs.
+	Every square is blocked and opened again, so the map stays the same.
+	Returns the number of cells (or blocks) where repair and rebuild differ.
+*/
+int benchEdits(BenchSettings &settings)
+{
+	int size = settings.quick ? 256 : 1024;
+	int batches = settings.quick ? 32 : 128;
+	int side = (int) sqrt((double) BENCH_EDIT_BATCH);
+	mGrid *grid = buildSeededGrid(size, BENCH_SEED);
+	mClearanceMap *clearance = new mClearanceMap(grid);
+	mLocalDistanceDB *database = new mLocalDistanceDB(grid);
+	database->build();
+
+	vector<int> corners;
+	for(int batch = 0; batch < 2 * batches; batch++) corners.push_back(mRandom::uniformInt(BENCH_SEED, batch, size - side));
+	string suffix = to_string(side) + "x" + to_string(side) + "/" + to_string(size) + "x" + to_string(size);
+
+	long changed = 0;
+	runBenchmark(settings, "mGrid/fillRect/" + suffix, 2 * batches, [&]()
+	{
+		changed = 0;
+		for(int batch = 0; batch < batches; batch++)
+		{
+			changed += grid->fillRect(corners[2*batch], corners[2*batch + 1], side, side, false);
+			changed += grid->fillRect(corners[2*batch], corners[2*batch + 1], side, side, true);
+		}
+	});
+	if(changed > 0) cout << "  " << changed << " cells changed" << endl;
+
+	// the edits above opened every square, so put the seeded map back
+	delete grid;
+	grid = buildSeededGrid(size, BENCH_SEED);
+	clearance->grid = grid;
+	clearance->build();
+	database->grid = grid;
+	database->build();
+	vector<uint8_t> blocked(BENCH_EDIT_BATCH, 1);
+	vector<uint8_t> original(BENCH_EDIT_BATCH);
+
+	// one batch blocks the square, the next one restores it from the saved cells; 'refresh' picks what follows each batch
+	auto refreshData = [&](int refresh)
+	{
+		if(refresh == 0) clearance->build();
+		else if(refresh == 1) clearance->update();
+		else if(refresh == 2) database->build();
+		else database->update();
+	};
+	auto editPair = [&](int batch, int refresh)
+	{
+		int x0 = corners[2*batch];
+		int y0 = corners[2*batch + 1];
+		for(int cell = 0; cell < BENCH_EDIT_BATCH; cell++) original[cell] = grid->getNode(x0 + cell % side, y0 + cell / side)->walkable ? 1 : 0;
+		grid->applyMask(x0, y0, side, side, blocked, false);
+		refreshData(refresh);
+		grid->applyBatch(x0, y0, x0 + side, y0 + side, [&](int x, int y) -> int
+		{
+			return original[(y - y0) * side + (x - x0)];
+		});
+		refreshData(refresh);
+	};
+
+	runBenchmark(settings, "mClearanceMap/rebuild/" + suffix, 2 * batches, [&]()
+	{
+		for(int batch = 0; batch < batches; batch++) editPair(batch, 0);
+	});
+	int differ = 0;
+	runBenchmark(settings, "mClearanceMap/repair/" + suffix, 2 * batches, [&]()
+	{
+		differ = 0;
+		for(int batch = 0; batch < batches; batch++) editPair(batch, 1);
+		mClearanceMap reference(grid);
+		for(int cell = 0; cell < grid->gridSize; cell++)
+		{
+			if(clearance->clearance[cell] != reference.clearance[cell]) differ++;
+		}
+	});
+	if(differ > 0) cout << "  " << differ << " repaired clearances differ from a rebuild" << endl;
+	int mismatches = differ;
+
+	// a full database build takes far longer than the other steps, so only a few batches are timed
+	runBenchmark(settings, "mLocalDistanceDB/rebuild/" + suffix, 4, [&]()
+	{
+		for(int batch = 0; batch < 2; batch++) editPair(batch, 2);
+	});
+	differ = 0;
+	runBenchmark(settings, "mLocalDistanceDB/update/" + suffix, 2 * batches, [&]()
+	{
+		differ = 0;
+		for(int batch = 0; batch < batches; batch++) editPair(batch, 3);
+		mLocalDistanceDB reference(grid);
+		reference.build();
+		for(int block = 0; block < (int) reference.blockPattern.size(); block++)
+		{
+			if(database->patterns[database->blockPattern[block]] != reference.patterns[reference.blockPattern[block]]) differ++;
+		}
+	});
+	if(differ > 0) cout << "  " << differ << " updated block patterns differ from a rebuild" << endl;
+	mismatches += differ;
+
+	delete database;
+	delete clearance;
+	delete grid;
+	return mismatches;
+}
+
+/*
+	Distance matrix between random waypoints: one SparseAStar query per
+	unordered pair against the one-to-many sweeps of mDistanceMatrix (with
+	and without paths). One waypoint in eight is on a blocked cell, which no
+	sweep can settle, so the sweep expansions show whether the sweeps stop at
+	the last reachable waypoint. Returns the number of pairs whose distances
+	differ.
+*/
+int benchDistanceMatrix(BenchSettings &settings)
+{
+	int size = settings.quick ? 256 : 512;
+	int count = settings.quick ? 64 : 128;
+	mGrid *grid = buildSeededGrid(size, BENCH_SEED);
+	SparseAStar *search = new SparseAStar(grid);
+	search->setVerbose(false);
+	mDistanceMatrix *matrix = new mDistanceMatrix(grid);
+	matrix->setVerbose(false);
+
+	vector<pair<int, int> > waypoints;
+	uint64_t counter = 0;
+	while((int) waypoints.size() < count)
+	{
+		int x = mRandom::uniformInt(BENCH_SEED, counter++, size);
+		int y = mRandom::uniformInt(BENCH_SEED, counter++, size);
+		bool blocked = (waypoints.size() % 8 == 7);
+		if(grid->getNode(x, y)->walkable != blocked) waypoints.push_back(make_pair(x, y));
+	}
+
+	string suffix = to_string(count) + "/" + to_string(size) + "x" + to_string(size);
+	long expansions = 0;
+	vector<double> costs((long) count * count, -1.0);
+	runBenchmark(settings, "SparseAStar/pairs/" + suffix, 1, [&]()
+	{
+		expansions = 0;
+		for(int from = 0; from < count; from++)
+		{
+			for(int to = from + 1; to < count; to++)
+			{
+				search->findPath(waypoints[from].first, waypoints[from].second, waypoints[to].first, waypoints[to].second);
+				costs[(long) from * count + to] = search->getPathCost();
+				expansions += search->expansions;
+			}
+		}
+	});
+	if(expansions > 0) cout << "  " << expansions << " expansions" << endl;
+
+	int mismatches = 0;
+	for(int keepPaths = 0; keepPaths < 2; keepPaths++)
+	{
+		int differ = 0;
+		double seconds = runBenchmark(settings, string("mDistanceMatrix/") + (keepPaths ? "paths/" : "") + suffix, 1, [&]()
+		{
+			matrix->compute(waypoints, keepPaths);
+			differ = 0;
+			for(int from = 0; from < count; from++)
+			{
+				for(int to = from + 1; to < count; to++)
+				{
+					if(expansions > 0 and fabs(matrix->getDistance(from, to) - costs[(long) from * count + to]) > 1.0e-6) differ++;
+				}
+			}
+		});
+		if(seconds >= 0.0) cout << "  " << matrix->expansions << " expansions, " << matrix->memoryUsage() << " bytes" << endl;
+		if(differ > 0) cout << "  " << differ << " distances differ from SparseAStar" << endl;
+		mismatches += differ;
+	}
+	delete matrix;
+	delete search;
+	delete grid;
+	return mismatches;
+}
+
+/*
+	QuadtreeAStar against SparseAStar on blocky maps (large rooms, coarse
+	porous grains): quadtree build time, leaves and memory against the mGrid
+	nodes, then time per query and expansions. Returns the number of queries
+	whose path costs differ.
+*/
+int benchQuadtree(BenchSettings &settings)
+{
+	int size = settings.quick ? 256 : 1024;
+	int queries = settings.quick ? 16 : 64;
+	int mapTypes[2] = {MAP_ROOMS, MAP_POROUS};
+	double densities[2] = {0.5, 0.3};
+	string mapNames[2] = {"rooms", "porous"};
+	int mismatches = 0;
+	for(int map = 0; map < 2; map++)
+	{
+		mMapGenerator generator(mapTypes[map], densities[map], BENCH_SEED, size / 32);
+		mGrid *grid = generator.generate(size, size);
+		grid->setConnectivity(8);
+		mQuadtree *tree = NULL;
+		SparseAStar *search = new SparseAStar(grid);
+		search->setVerbose(false);
+		vector<int> endpoints = sampleEndpoints(grid, size, queries);
+
+		string suffix = mapNames[map] + "/" + to_string(size) + "x" + to_string(size);
+		double buildTime = runBenchmark(settings, "mQuadtree/build/" + suffix, 1, [&]()
+		{
+			delete tree;
+			tree = new mQuadtree(grid);
+		});
+		if(tree == NULL) tree = new mQuadtree(grid);
+		if(buildTime >= 0.0)
+		{
+			cout << "  " << tree->countLeaves() << " leaves, " << tree->boundaryOffsets.back() << " perimeter cells, " << tree->memoryUsage();
+			cout << " bytes (mGrid nodes: " << (long) grid->gridSize * sizeof(mNode) << " bytes)" << endl;
+		}
+		QuadtreeAStar *treeSearch = new QuadtreeAStar(tree);
+		treeSearch->setVerbose(false);
+
+		BenchBaseline baseline = runBaseline(settings, "SparseAStar/blocky/" + suffix, search, endpoints);
+		long treeExpansions = 0;
+		vector<double> costs(queries, NAN);
+		runBenchmark(settings, "QuadtreeAStar/" + suffix, queries, [&]()
+		{
+			treeExpansions = 0;
+			for(int query = 0; query < queries; query++)
+			{
+				treeSearch->findPath(endpoints[4*query], endpoints[4*query + 1], endpoints[4*query + 2], endpoints[4*query + 3]);
+				treeExpansions += treeSearch->expansions;
+				costs[query] = treeSearch->getPathCost();
+			}
+		});
+		if(treeExpansions > 0) cout << "  " << treeExpansions << " expansions, " << treeSearch->memoryUsage() << " bytes of search state" << endl;
+		mismatches += compareWithBaseline(baseline, costs, 1.0e-6, "QuadtreeAStar");
+		delete treeSearch;
+		delete tree;
+		delete search;
+		delete grid;
+	}
+	return mismatches;
+}
+
+/*
+	mPathCache against plain SparseAStar on queries repeated from a small pool
+	of endpoint pairs. Then every pair is first searched with a restriction
+	(clearance filter for 2x2 agents, a bounding box around the endpoints)
+	and again without: the unrestricted answer must not be the cached detour.
+	Returns the number of cached path costs that differ from SparseAStar.
+*/
+int benchPathCache(BenchSettings &settings)
+{
+	int size = settings.quick ? 256 : 512;
+	int pairs = settings.quick ? 16 : 64;
+	int queries = 8 * pairs;
+	mGrid *grid = buildSeededGrid(size, BENCH_SEED);
+	SparseAStar *search = new SparseAStar(grid);
+	search->setVerbose(false);
+	mPathCache *cache = new mPathCache(grid);
+	vector<int> endpoints = sampleEndpoints(grid, size, pairs);
+
+	vector<double> costs(pairs, -1.0);
+	string suffix = to_string(size) + "x" + to_string(size);
+	runBenchmark(settings, "mPathCache/uncached/" + suffix, queries, [&]()
+	{
+		for(int query = 0; query < queries; query++)
+		{
+			int pair = query % pairs;
+			search->findPath(endpoints[4*pair], endpoints[4*pair + 1], endpoints[4*pair + 2], endpoints[4*pair + 3]);
+			costs[pair] = search->getPathCost();
+		}
+	});
+
+	vector<int> cells(grid->gridSize);
+	mPathResult result(cells.data(), cells.size(), PATH_CELLS);
+	double cachedTime = runBenchmark(settings, "mPathCache/repeated/" + suffix, queries, [&]()
+	{
+		cache->clear();
+		for(int query = 0; query < queries; query++)
+		{
+			int pair = query % pairs;
+			cache->findPath(search, endpoints[4*pair], endpoints[4*pair + 1], endpoints[4*pair + 2], endpoints[4*pair + 3], result);
+		}
+	});
+	if(cachedTime < 0.0)
+	{
+		delete cache;
+		delete search;
+		delete grid;
+		return 0;
+	}
+	cache->print();
+
+	// restricted searches first, then the same endpoints without restriction
+	mClearanceMap *clearance = new mClearanceMap(grid);
+	mClearanceFilter *wideAgents = new mClearanceFilter(clearance, 2);
+	int mismatches = 0;
+	for(int restriction = 0; restriction < 2; restriction++)
+	{
+		cache->clear();
+		for(int pair = 0; pair < pairs; pair++)
+		{
+			int *coordinates = &endpoints[4*pair];
+			if(restriction == 0)
+			{
+				search->setSearchFilter(wideAgents);
+			} else
+			{
+				mSearchLimits limits;
+				limits.setBoundingBox(min(coordinates[0], coordinates[2]), min(coordinates[1], coordinates[3]), max(coordinates[0], coordinates[2]), max(coordinates[1], coordinates[3]));
+				search->setSearchLimits(limits);
+			}
+			cache->findPath(search, coordinates[0], coordinates[1], coordinates[2], coordinates[3], result);
+			search->setSearchFilter(NULL);
+			mSearchLimits unlimited;
+			search->setSearchLimits(unlimited);
+
+			search->findPath(coordinates[0], coordinates[1], coordinates[2], coordinates[3]);
+			double expected = (search->status == SEARCH_FOUND) ? search->getPathCost() : -1.0;
+			bool found = cache->findPath(search, coordinates[0], coordinates[1], coordinates[2], coordinates[3], result);
+			if(found != (expected >= 0.0) or (found and fabs(result.cost - expected) > 1.0e-6))
+			{
+				cout << "  " << ((restriction == 0) ? "filtered" : "boxed") << " query " << pair << " left cost " << result.cost;
+				cout << " in the cache (unrestricted " << expected << ")" << endl;
+				mismatches++;
+			}
+		}
+	}
+	delete wideAgents;
+	delete clearance;
+	delete cache;
+	delete search;
+	delete grid;
+	return mismatches;
+}
+
+/*
+	Query throughput of reader threads on a mGridStore, first alone, then
+	while a writer publishes BENCH_EDIT_BATCH random cell edits per version
+	as fast as it can. Returns 1 if a reader saw a snapshot change while
+	pinned.
+*/
+int benchSnapshots(BenchSettings &settings)
+{
+	string name = "mGridStore/queries";
+	if(settings.filter.size() > 0 and name.find(settings.filter) == string::npos) return 0;
+
+	int size = settings.quick ? 256 : 1024;
+	double duration = settings.quick ? 0.2 : 1.0;
+	int readerCount = max(1, min(omp_get_max_threads(), SNAPSHOT_MAX_READERS));
+	mGrid *grid = buildSeededGrid(size, BENCH_SEED);
+	mGridStore *store = new mGridStore(grid);
+	delete grid;
+
+	int errors = 0;
+	for(int phase = 0; phase < 2; phase++)
+	{
+		atomic<bool> running(true);
+		atomic<long> queries(0);
+		atomic<int> changed(0);
+		long edits = 0;
+		vector<thread> readers;
+		for(int reader = 0; reader < readerCount; reader++)
+		{
+			readers.push_back(thread([&, reader]()
+			{
+				int slot = store->registerReader();
+				if(slot < 0) return;
+				SparseAStar search(store->geometry);
+				search.setVerbose(false);
+				mSnapshotFilter filter(store);
+				search.setSearchFilter(&filter);
+				uint64_t counter = 0;
+				while(running.load())
+				{
+					int coordinates[4];
+					for(int coordinate = 0; coordinate < 4; coordinate++) coordinates[coordinate] = mRandom::uniformInt(BENCH_SEED + reader, counter++, size);
+
+					const mGridStore::Snapshot *snapshot = store->pin(slot);
+					long version = snapshot->version;
+					bool startFree = snapshot->isWalkable(coordinates[0], coordinates[1]);
+					if(startFree and snapshot->isWalkable(coordinates[2], coordinates[3]))
+					{
+						filter.setSnapshot(snapshot);
+						search.findPath(coordinates[0], coordinates[1], coordinates[2], coordinates[3]);
+						queries++;
+					}
+					if(snapshot->version != version or snapshot->isWalkable(coordinates[0], coordinates[1]) != startFree) changed++;
+					store->unpin(slot);
+				}
+				store->unregisterReader(slot);
+			}));
+		}
+
+		double stime = omp_get_wtime();
+		uint64_t counter = 0;
+		while(omp_get_wtime() - stime < duration)
+		{
+			if(phase == 0)
+			{
+				this_thread::sleep_for(chrono::milliseconds(1));
+				continue;
+			}
+			vector<mGridStore::Edit> batch(BENCH_EDIT_BATCH);
+			for(int edit = 0; edit < BENCH_EDIT_BATCH; edit++)
+			{
+				batch[edit].x = mRandom::uniformInt(BENCH_SEED, counter++, size);
+				batch[edit].y = mRandom::uniformInt(BENCH_SEED, counter++, size);
+				batch[edit].walkable = (mRandom::uniform(BENCH_SEED, counter++) >= OBSTACLES_RATE);
+			}
+			store->applyEdits(batch);
+			edits += BENCH_EDIT_BATCH;
+		}
+		running.store(false);
+		for(int reader = 0; reader < (int) readers.size(); reader++) readers[reader].join();
+		double elapsed = omp_get_wtime() - stime;
+
+		char line[256];
+		snprintf(line, sizeof(line), "%-36s %12.1f queries/s %9.1f edits/s (%d readers)", (phase == 0) ? "mGridStore/queries/no edits" : "mGridStore/queries/edit stream",
+				 queries.load() / elapsed, edits / elapsed, readerCount);
+		cout << line << endl;
+		if(changed.load() > 0)
+		{
+			cout << "  " << changed.load() << " queries saw their pinned snapshot change" << endl;
+			errors = 1;
+		}
+	}
+	store->print();
+	delete store;
+	return errors;
+}
+
+/*
+	CooperativeAStar on contended maps: one and two pairs of agents crossing
+	a one cell wide corridor from opposite ends (passing bays every 8 cells),
+	and a crowded random map. Time per window, arrivals and failed plans; the executed
+	steps must have no vertex or swap conflicts. Returns the number of
+	conflicts.
+*/
+int benchCooperative(BenchSettings &settings)
+{
+	int length = settings.quick ? 32 : 64;
+	int size = settings.quick ? 32 : 64;
+	int conflicts = 0;
+	for(int map = 0; map < 3; map++)
+	{
+		mGrid *grid;
+		int pairs = map + 1;
+		if(map < 2)
+		{
+			grid = new mGrid(length, 3, false);
+			for(int x = 0; x < length; x++) grid->getNode(x, 1)->walkable = true;
+			for(int x = 4; x < length; x += 8) grid->getNode(x, 0)->walkable = true;
+			grid->setConnectivity(4);
+		} else
+		{
+			mMapGenerator generator(MAP_UNIFORM, 0.25, BENCH_SEED);
+			grid = generator.generate(size, size);
+			grid->setConnectivity(8);
+		}
+		string name = (map < 2) ? "CooperativeAStar/corridor/" + to_string(2 * pairs) + "/" + to_string(length) : "CooperativeAStar/crowded/" + to_string(size) + "x" + to_string(size);
+
+		int windows = 0, arrived = 0, agents = 0;
+		long failedPlans = 0, executedConflicts = 0;
+		int maxWindows = (map < 2) ? length : 2 * size;
+		double seconds = runBenchmark(settings, name, 1, [&]()
+		{
+			CooperativeAStar cooperative(grid, WHCA_WINDOW);
+			cooperative.setVerbose(false);
+			if(map < 2)
+			{
+				for(int pair = 0; pair < pairs; pair++)
+				{
+					cooperative.addAgent(pair, 1, length - 1 - pair, 1);
+					cooperative.addAgent(length - 1 - pair, 1, pair, 1);
+				}
+			} else
+			{
+				set<int> goals;
+				uint64_t counter = 0;
+				for(int attempt = 0; attempt < 100 * size and (int) cooperative.agents.size() < size * size / 16; attempt++)
+				{
+					int startX = mRandom::uniformInt(BENCH_SEED, counter++, size);
+					int startY = mRandom::uniformInt(BENCH_SEED, counter++, size);
+					int goalX = mRandom::uniformInt(BENCH_SEED, counter++, size);
+					int goalY = mRandom::uniformInt(BENCH_SEED, counter++, size);
+					if(goals.count(grid->getNodeIdx(goalX, goalY))) continue;
+					if(cooperative.addAgent(startX, startY, goalX, goalY) >= 0) goals.insert(grid->getNodeIdx(goalX, goalY));
+				}
+			}
+			windows = cooperative.run(maxWindows);
+			agents = cooperative.agents.size();
+			arrived = cooperative.countArrived();
+			failedPlans = cooperative.failedPlans;
+			executedConflicts = cooperative.countConflicts();
+		});
+		if(seconds >= 0.0)
+		{
+			cout << "  " << agents << " agents, " << arrived << " arrived in " << windows << " windows, " << failedPlans << " failed plans" << endl;
+			if(executedConflicts > 0) cout << "  " << executedConflicts << " conflicts in the executed steps" << endl;
+			conflicts += executedConflicts;
+		}
+		delete grid;
+	}
+	return conflicts;
+}
+
+void benchCanvas(BenchSettings &settings)
+{
+	mGrid *grid = buildSeededGrid(64, BENCH_SEED);
+	Canvas *canvas = new Canvas(grid);
+	int rectangles = settings.quick ? 1000 : 20000;
+	runBenchmark(settings, "Canvas/drawRectangle", rectangles, [&]()
+	{
+		for(int rectangle = 0; rectangle < rectangles; rectangle++)
+		{
+			int node = rectangle % grid->gridSize;
+			int posX = grid->nodes[node].x * (canvas->nodeSizeX + canvas->gridLinewidth);
+			int posY = grid->nodes[node].y * (canvas->nodeSizeY + canvas->gridLinewidth);
+			canvas->drawRectangle(posX, posY, PATH_COLOR, canvas->nodeSizeX, canvas->nodeSizeY);
+		}
+	});
+	delete canvas;
+}
+
+int main(int argc, char *argv[])
+{
+	BenchSettings settings;
+	settings.quick = false;
+	for(int arg = 1; arg < argc; arg++)
+	{
+		if(string(argv[arg]) == "--quick") settings.quick = true;
+		else settings.filter = argv[arg];
+	}
+
+	cout << "pathfinder component benchmarks (" << omp_get_max_threads() << " threads, median of " << BENCH_REPEATS << " runs)" << endl;
+	benchHeap(settings);
+	benchNeighbors(settings);
+	benchNodeCompare(settings);
+	int mismatches = benchAStar(settings);
+	mismatches += benchAnyAngle(settings);
+	mismatches += benchVoxels(settings);
+	mismatches += benchLayouts(settings);
+	mismatches += benchSlicedSearch(settings);
+	mismatches += benchBitBFS(settings);
+	mismatches += benchLowMemory(settings);
+	mismatches += benchBlockAStar(settings);
+	mismatches += benchDistanceMatrix(settings);
+	mismatches += benchQuadtree(settings);
+	mismatches += benchPathCache(settings);
+	mismatches += benchDeadEnds(settings);
+	mismatches += benchSnapshots(settings);
+	mismatches += benchEdits(settings);
+	mismatches += benchCooperative(settings);
+	benchCanvas(settings);
+
+	if(mismatches > 0)
+	{
+		cout << mismatches << " path costs differ from the reference." << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -5,8 +5,165 @@
 #include "PathFinder.h"
 
 // Main Program
+//   pathfinder                                              interactive demo
+//   pathfinder --server <socket|-> [--workers N] image...  query server
+//   pathfinder --loadgen <socket> <image> [queries] [inflight] [batch]
+//   pathfinder --cpd <image> [file]                        build a first-move table
+//   pathfinder --deadends <image> [file]                   find dead-end pockets
+//   pathfinder --generate <uniform|maze|rooms|porous> <width> <height> <density> <seed> <image>
+//   pathfinder --agents <image> [agents] [window] [seed]   cooperative multi-agent planning
 int main(int argc, char *argv[])
 {        
+    if(argc > 2 and string(argv[1]) == "--server")
+    {
+        string socketPath = argv[2];
+        int workers = 0;
+        vector<string> images;
+        for(int arg = 3; arg < argc; arg++)
+        {
+            if(string(argv[arg]) == "--workers" and arg + 1 < argc) workers = atoi(argv[++arg]);
+            else images.push_back(argv[arg]);
+        }
+        if(images.size() == 0) images.push_back(IMAGEPATH);
+
+        // in stdio mode stdout only carries answers, log lines (e.g. of mGrid) go to stderr
+        streambuf *coutBuffer = cout.rdbuf();
+        if(socketPath == "-") cout.rdbuf(cerr.rdbuf());
+
+        PathServer *server = new PathServer(images, workers);
+        if(socketPath == "-") server->runStdio();
+        else server->runSocket(socketPath);
+
+        delete server;
+        server = NULL;
+        cout.rdbuf(coutBuffer);
+        return 0;
+    }
+
+    if(argc > 3 and string(argv[1]) == "--loadgen")
+    {
+        int queries = (argc > 4) ? atoi(argv[4]) : 10000;
+        int inflight = (argc > 5) ? atoi(argv[5]) : 64;
+        int batch = (argc > 6) ? atoi(argv[6]) : 1;
+        LoadGenerator *loadGenerator = new LoadGenerator(argv[2], argv[3], queries, inflight, batch);
+        loadGenerator->run();
+
+        delete loadGenerator;
+        loadGenerator = NULL;
+        return 0;
+    }
+
+    if(argc > 2 and string(argv[1]) == "--cpd")
+    {
+        cv::Mat image = cv::imread(argv[2]);
+        if(image.empty())
+        {
+            cout << "could not read image " << argv[2] << endl;
+            return 1;
+        }
+        mGrid *grid = new mGrid(&image);
+        if(ALLOW_DIAGONAL_MOVEMENT) grid->setConnectivity(8);
+
+        // build time versus size for both node orderings
+        mFirstMoveTable *rowTable = new mFirstMoveTable(grid, FIRST_MOVE_ORDER_ROWS);
+        rowTable->build();
+        rowTable->print();
+        delete rowTable;
+
+        mFirstMoveTable *table = new mFirstMoveTable(grid, FIRST_MOVE_ORDER_DFS);
+        table->build();
+        table->print();
+        if(argc > 3) table->save(argv[3]);
+
+        delete table;
+        delete grid;
+        return 0;
+    }
+
+    if(argc > 2 and string(argv[1]) == "--deadends")
+    {
+        cv::Mat image = cv::imread(argv[2]);
+        if(image.empty())
+        {
+            cout << "could not read image " << argv[2] << endl;
+            return 1;
+        }
+        mGrid *grid = new mGrid(&image);
+        if(ALLOW_DIAGONAL_MOVEMENT) grid->setConnectivity(8);
+
+        mDeadEndMap *deadEnds = new mDeadEndMap(grid);
+        deadEnds->build();
+        deadEnds->print();
+        if(argc > 3) deadEnds->save(argv[3]);
+
+        delete deadEnds;
+        delete grid;
+        return 0;
+    }
+
+    if(argc > 7 and string(argv[1]) == "--generate")
+    {
+        string typeName = argv[2];
+        int type = MAP_UNIFORM;
+        if(typeName == "maze") type = MAP_MAZE;
+        else if(typeName == "rooms") type = MAP_ROOMS;
+        else if(typeName == "porous") type = MAP_POROUS;
+
+        mMapGenerator generator(type, atof(argv[5]), strtoull(argv[6], NULL, 10));
+        mGrid *grid = generator.generate(atoi(argv[3]), atoi(argv[4]));
+        cout << mMapGenerator::typeName(type) << " map " << grid->gridDimX << "x" << grid->gridDimY;
+        cout << ", density " << generator.getDensity(grid) << ", generated in " << generator.generationTime << " secs" << endl;
+
+        cv::Mat image(grid->gridDimY, grid->gridDimX, CV_8UC1, cv::Scalar(0));
+        for(int y = 0; y < grid->gridDimY; y++)
+        {
+            uchar *row = image.ptr<uchar>(y);
+            for(int x = 0; x < grid->gridDimX; x++)
+                row[x] = grid->getNode(x, y)->walkable ? GRID_WALKABLE_COLOR : 0;
+        }
+        cv::imwrite(argv[7], image);
+
+        delete grid;
+        return 0;
+    }
+
+    if(argc > 2 and string(argv[1]) == "--agents")
+    {
+        cv::Mat image = cv::imread(argv[2]);
+        if(image.empty())
+        {
+            cout << "could not read image " << argv[2] << endl;
+            return 1;
+        }
+        int agents = (argc > 3) ? atoi(argv[3]) : 200;
+        int window = (argc > 4) ? atoi(argv[4]) : WHCA_WINDOW;
+        uint64_t seed = (argc > 5) ? strtoull(argv[5], NULL, 10) : MAP_DEFAULT_SEED;
+        mGrid *grid = new mGrid(&image);
+        if(ALLOW_DIAGONAL_MOVEMENT) grid->setConnectivity(8);
+
+        // random distinct starts and goals on walkable cells
+        CooperativeAStar *cooperative = new CooperativeAStar(grid, window);
+        set<int> goals;
+        uint64_t counter = 0;
+        for(int attempt = 0; attempt < 100 * agents and cooperative->agents.size() < agents; attempt++)
+        {
+            int startX = mRandom::uniformInt(seed, counter++, grid->gridDimX);
+            int startY = mRandom::uniformInt(seed, counter++, grid->gridDimY);
+            int goalX = mRandom::uniformInt(seed, counter++, grid->gridDimX);
+            int goalY = mRandom::uniformInt(seed, counter++, grid->gridDimY);
+            int goal = grid->getNodeIdx(goalX, goalY);
+            if(goals.count(goal)) continue;
+            if(cooperative->addAgent(startX, startY, goalX, goalY) >= 0) goals.insert(goal);
+        }
+
+        cooperative->run(grid->gridDimX + grid->gridDimY);
+        cout << "collisions in executed steps: " << cooperative->countConflicts() << endl;
+
+        delete cooperative;
+        delete grid;
+        return 0;
+    }
+
     PathFinderApp *app;
     app = new PathFinderApp(IMAGEPATH);
     app->run();